@@ -0,0 +1,34 @@
+#ifndef INVICULUM_BENCH_BENCH_HPP
+#define INVICULUM_BENCH_BENCH_HPP
+
+#include <chrono>
+#include <cstdint>
+
+/**
+ * Helpers shared by the benchmarks in src/bench
+ */
+namespace bench {
+    // Where benchmarks store what they compute, so the work is not optimised away
+    inline volatile float sink = 0.0F;
+    inline volatile uint32_t raw_sink = 0;
+
+    // Time the given function, repeating it until enough time has passed to be measurable, in microseconds per call
+    template<typename F>
+    double time_us(F fn) {
+        using clock = std::chrono::steady_clock;
+        uint32_t repeats = 1;
+        while (true) {
+            auto start = clock::now();
+            for (uint32_t i = 0; i < repeats; i++) {
+                fn();
+            }
+            double us = std::chrono::duration<double, std::micro>(clock::now() - start).count();
+            if (us > 20000.0) {
+                return us / repeats;
+            }
+            repeats *= 2;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,64 @@
+#include "bench.hxx"
+
+#include <vml/planar_shadow.hxx>
+
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+/**
+ * Planar shadow benchmark, times vml::plane_project for a sweep of light counts against a projection and multiply per
+ * shadow (how the modules used to build their shadows). Five planes, as in the room of the point light modules, and a
+ * few caster counts. Reports the time per frame and per shadow matrix
+ */
+int main() {
+    const float l = -2.0F, r = 2.0F, u = 1.0F, d = -1.0F, f = -2.0F, b = -4.0F;
+    std::vector<vml::vec4> planes = {vml::plane(vml::vec3(1.0F, 0.0F, 0.0F), vml::vec3(l, 0.0F, 0.0F)),
+                                     vml::plane(vml::vec3(-1.0F, 0.0F, 0.0F), vml::vec3(r, 0.0F, 0.0F)),
+                                     vml::plane(vml::vec3(0.0F, 0.0F, 1.0F), vml::vec3(0.0F, 0.0F, b)),
+                                     vml::plane(vml::vec3(0.0F, 1.0F, 0.0F), vml::vec3(0.0F, d, 0.0F)),
+                                     vml::plane(vml::vec3(0.0F, -1.0F, 0.0F), vml::vec3(0.0F, u, 0.0F))};
+    auto plane_count = static_cast<uint32_t>(planes.size());
+    uint32_t thread_count = std::max(1U, std::thread::hardware_concurrency());
+
+    std::printf("%8s %8s %8s %14s %14s %14s %12s %12s\n", "lights", "casters", "shadows", "naive us", "batch us", "threaded us", "naive ns/sh", "batch ns/sh");
+    for (uint32_t caster_count : {1U, 16U}) {
+        std::vector<vml::mat4> casters;
+        for (uint32_t k = 0; k < caster_count; k++) {
+            float x = l + 0.5F + (r - l - 1.0F) * k / caster_count;
+            casters.push_back(vml::mat4(0.5F, 0.0F, 0.0F, 0.0F, 0.0F, 0.5F, 0.0F, 0.0F, 0.0F, 0.0F, 1.0F, 0.0F, x, 0.0F, (3.0F * b + f) / 4.0F, 1.0F));
+        }
+        for (uint32_t light_count = 1; light_count <= 1024; light_count *= 4) {
+            std::vector<vml::vec4> lights;
+            std::vector<float> offsets;
+            for (uint32_t i = 0; i < light_count; i++) {
+                lights.push_back(vml::vec4(r - (r - l) * (i + 1) / (light_count + 1), (u * 3.0F + d) / 4.0F, f, 1.0F));
+                offsets.push_back(0.0001F * (i + 1));
+            }
+            uint32_t shadow_count = light_count * plane_count * caster_count;
+            std::vector<vml::mat4> out(shadow_count);
+
+            double naive = bench::time_us([&]() {
+                for (uint32_t i = 0; i < light_count; i++) {
+                    for (uint32_t j = 0; j < plane_count; j++) {
+                        vml::vec4 plane = planes[j];
+                        plane[3] -= offsets[i];
+                        vml::mat4 projection = vml::plane_project(lights[i], plane);
+                        for (uint32_t k = 0; k < caster_count; k++) {
+                            out[(i * plane_count + j) * caster_count + k] = projection * casters[k];
+                        }
+                    }
+                }
+            });
+            double batch = bench::time_us([&]() {
+                vml::plane_project(lights.data(), offsets.data(), light_count, planes.data(), plane_count, casters.data(), caster_count, out.data());
+            });
+            double threaded = bench::time_us([&]() {
+                vml::plane_project(lights.data(), offsets.data(), light_count, planes.data(), plane_count, casters.data(), caster_count, out.data(), thread_count);
+            });
+            std::printf("%8u %8u %8u %14.2f %14.2f %14.2f %12.2f %12.2f\n", light_count, caster_count, shadow_count, naive, batch, threaded,
+                        naive * 1000.0 / shadow_count, batch * 1000.0 / shadow_count);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,65 @@
+#include "bench.hxx"
+#include "scene/scene_file.hxx"
+
+#include <cstdlib>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * Scene file benchmark, writes scenes of a few sizes (rows of walls with a light, each wall a child of its row) as
+ * binary scene files and as the text they are converted from, then times reading them back: the binary file is loaded
+ * in place and instantiated into a scene, the text is only split into numbers (a lower bound on parsing it). Reports
+ * the file sizes and the time of each step
+ */
+int main() {
+    std::printf("%9s %11s %11s %10s %16s %14s\n", "entities", "binary KiB", "text KiB", "load us", "instantiate us", "text split us");
+    for (uint32_t rows : {10U, 1000U, 20000U}) {
+        const uint32_t walls = 9;
+        scene::scene_file_writer writer;
+        std::ostringstream text;
+        for (uint32_t row = 0; row < rows; row++) {
+            float z = -static_cast<float>(row);
+            uint32_t parent = writer.add_entity("row_" + std::to_string(row));
+            writer.transforms.push_back({parent, scene::NO_ENTITY, {}, {0.0F, 0.0F, z, 1.0F}, {1.0F, 0.0F, 0.0F, 0.0F}, {1.0F, 1.0F, 1.0F, 0.0F}});
+            writer.lights.push_back({parent, {}, {0.0F, 0.5F, z, 1.0F}});
+            text << "entity row_" << row << "\ntransform translate 0 0 " << z << "\nlight point 0 0.5 " << z << "\n";
+            for (uint32_t w = 0; w < walls; w++) {
+                auto x = static_cast<float>(w);
+                uint32_t e = writer.add_entity("wall_" + std::to_string(row) + "_" + std::to_string(w));
+                writer.transforms.push_back({e, parent, {}, {x, 0.0F, 0.0F, 1.0F}, {1.0F, 0.0F, 0.0F, 0.0F}, {1.0F, 2.0F, 1.0F, 0.0F}});
+                writer.meshes.push_back({e, writer.add_string("rect_2D"), scene::MESH_STATIC, 0, {1.0F, 1.0F, 1.0F, 1.0F}});
+                writer.planes.push_back({e, {}, {0.0F, 0.0F, 1.0F, -z}});
+                text << "entity wall_" << row << "_" << w << "\ntransform parent row_" << row << " translate " << x << " 0 0 scale 1 2 1\n"
+                     << "mesh rect_2D static\nplane 0 0 1 " << -z << "\n";
+            }
+        }
+        std::vector<uint8_t> file = writer.write("multi_point", vml::vec3(-2.0F, -1.0F, -4.0F), vml::vec3(2.0F, 1.0F, -2.0F));
+        std::string source = text.str();
+
+        scene::scene_file loaded;
+        double load = bench::time_us([&]() {
+            loaded.load(file.data(), file.size());
+        });
+        double instantiate = bench::time_us([&]() {
+            scene::scene s;
+            loaded.instantiate(s, [](const char*) {
+                return 0U;
+            });
+            s.hierarchy.update(s.transforms);
+        });
+        double split = bench::time_us([&]() {
+            std::istringstream in(source);
+            std::string word;
+            float sum = 0.0F;
+            while (in >> word) {
+                sum += std::strtof(word.c_str(), nullptr);
+            }
+            bench::sink = sum;
+        });
+        std::printf("%9u %11.1f %11.1f %10.3f %16.1f %14.1f\n", loaded.get_count(scene::scene_section::entities), static_cast<double>(file.size()) / 1024.0,
+                    static_cast<double>(source.size()) / 1024.0, load, instantiate, split);
+    }
+    return 0;
+}
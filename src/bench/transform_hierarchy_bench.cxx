@@ -0,0 +1,85 @@
+#include "bench.hxx"
+#include "scene/transform_hierarchy.hxx"
+
+#include <vml/transform.hxx>
+
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+/**
+ * Transform hierarchy benchmark, builds hierarchies of a few sizes (every node with 8 children, added depth first) and
+ * times scene::transform_hierarchy::update when one small subtree moves and when the root moves (every node dirty) on
+ * one thread and on every hardware thread, against recalculating every world matrix from translate, rotate and scale
+ * each frame (how absolute transforms written by hand scale). Reports the time per update and per node updated
+ */
+namespace {
+    const uint32_t CHILDREN = 8;
+
+    // A rotation of rad about the z axis
+    vml::quaternion rotation_z(float rad) {
+        return vml::quaternion(std::cos(rad / 2.0F), 0.0F, 0.0F, std::sin(rad / 2.0F));
+    }
+
+    // Adds the node and its descendants down to the given depth, depth first, returns the next entity
+    scene::entity build(scene::transform_hierarchy& h, scene::component_array<scene::transform>& transforms, std::vector<scene::entity>& parents,
+                        scene::entity e, scene::entity parent, uint32_t depth) {
+        transforms.add(e);
+        parents.push_back(parent);
+        h.add(e, parent, vml::vec3(1.0F, 0.0F, 0.0F), rotation_z(0.1F * static_cast<float>(e % 7)), vml::vec3(0.9F, 0.9F, 0.9F));
+        scene::entity next = e + 1;
+        if (depth > 0) {
+            for (uint32_t c = 0; c < CHILDREN; c++) {
+                next = build(h, transforms, parents, next, e, depth - 1);
+            }
+        }
+        return next;
+    }
+}
+
+int main() {
+    uint32_t thread_count = std::max(1U, std::thread::hardware_concurrency());
+    std::printf("%9s %12s %12s %14s %14s %16s %12s %12s\n", "nodes", "naive us", "moved nodes", "subtree us", "root us", "root threaded us", "naive ns/n", "root ns/n");
+    for (uint32_t depth : {3U, 5U, 6U}) {
+        scene::transform_hierarchy h;
+        scene::component_array<scene::transform> transforms;
+        std::vector<scene::entity> parents;
+        auto count = static_cast<uint32_t>(build(h, transforms, parents, 0, scene::NO_ENTITY, depth));
+        h.update(transforms);
+
+        // Every world matrix recalculated from its local values, parents are added before children
+        std::vector<vml::mat4> worlds(count);
+        double naive = bench::time_us([&]() {
+            for (scene::entity e = 0; e < count; e++) {
+                vml::mat4 local = vml::translate(h.get_translation(e)) * vml::rotate(h.get_rotation(e)) * vml::mat4::extend(vml::scale(h.get_scale(e)));
+                worlds[e] = parents[e] == scene::NO_ENTITY ? local : worlds[parents[e]] * local;
+            }
+        });
+
+        // A node two levels above the leaves moves, a subtree of the same size whatever the depth. Nodes are added depth
+        // first so entity n is the first child of entity n - 1 down to the leaves
+        scene::entity moved = depth - 2;
+        uint32_t moved_nodes = 1 + CHILDREN + CHILDREN * CHILDREN;
+        float angle = 0.0F;
+        double subtree = bench::time_us([&]() {
+            angle += 0.01F;
+            h.set_rotation(moved, rotation_z(angle));
+            h.update(transforms);
+        });
+        double root = bench::time_us([&]() {
+            angle += 0.01F;
+            h.set_rotation(0, rotation_z(angle));
+            h.update(transforms);
+        });
+        double root_threaded = bench::time_us([&]() {
+            angle += 0.01F;
+            h.set_rotation(0, rotation_z(angle));
+            h.update(transforms, thread_count);
+        });
+
+        std::printf("%9u %12.1f %12u %14.2f %14.1f %16.1f %12.2f %12.2f\n", count, naive, moved_nodes, subtree, root, root_threaded,
+                    naive * 1000.0 / count, root * 1000.0 / count);
+    }
+    return 0;
+}
@@ -0,0 +1,162 @@
+#include "bench.hxx"
+#include "render/mesh_optimiser.hxx"
+#include "render/vertex.hxx"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+/**
+ * Vertex fetch benchmark, packs a rolling heightfield (positions, uvs and normals) in the full precision layout and in
+ * the compact layouts mesh_manager picks, then walks the cache optimised index buffer twice: reading the raw bytes of
+ * every vertex (the memory traffic of the GPU's vertex fetch, whose format conversion is free) and decoding every vertex
+ * on the CPU as the fixed function vertex fetch would. A few grid sizes, from one which fits in cache to one which does
+ * not, report the memory used and both rates of each layout, along with the worst position error of quantising
+ */
+namespace {
+    // Returns the float the given half precision float holds
+    float from_half(uint16_t h) {
+        uint32_t sign = (h & 0x8000U) << 16U;
+        uint32_t exponent = (h >> 10U) & 0x1FU;
+        uint32_t mantissa = h & 0x3FFU;
+        if (exponent == 0) {
+            float value = std::ldexp(static_cast<float>(mantissa), -24);
+            return sign ? -value : value;
+        }
+        uint32_t bits = sign | ((exponent == 0x1FU ? 0xFFU : exponent - 15 + 127) << 23U) | (mantissa << 13U);
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    // Read one attribute in the given format into out (up to 4 components), as the Vulkan formats mesh_manager uses
+    void fetch(render::vertex_format format, const uint8_t* src, float* out) {
+        switch (format) {
+            case render::vertex_format::float2:
+                memcpy(out, src, sizeof(float) * 2);
+                break;
+            case render::vertex_format::float3:
+                memcpy(out, src, sizeof(float) * 3);
+                break;
+            case render::vertex_format::snorm8x4:
+                for (int i = 0; i < 4; i++) {
+                    out[i] = std::fmax(static_cast<float>(static_cast<int8_t>(src[i])) / 127.0F, -1.0F);
+                }
+                break;
+            case render::vertex_format::snorm16x4:
+                for (int i = 0; i < 4; i++) {
+                    int16_t c;
+                    memcpy(&c, src + i * sizeof(int16_t), sizeof(int16_t));
+                    out[i] = std::fmax(static_cast<float>(c) / 32767.0F, -1.0F);
+                }
+                break;
+            case render::vertex_format::unorm16x2:
+                for (int i = 0; i < 2; i++) {
+                    uint16_t c;
+                    memcpy(&c, src + i * sizeof(uint16_t), sizeof(uint16_t));
+                    out[i] = static_cast<float>(c) / 65535.0F;
+                }
+                break;
+            case render::vertex_format::half2:
+                for (int i = 0; i < 2; i++) {
+                    uint16_t c;
+                    memcpy(&c, src + i * sizeof(uint16_t), sizeof(uint16_t));
+                    out[i] = from_half(c);
+                }
+                break;
+        }
+    }
+
+    // A size x size grid over 0 - 1 with rolling hills, uvs tile 4 times when tiled (needing half floats)
+    render::mesh_data make_grid(uint32_t size, bool tiled) {
+        render::mesh_data data;
+        float uv_scale = tiled ? 4.0F : 1.0F;
+        for (uint32_t y = 0; y < size; y++) {
+            for (uint32_t x = 0; x < size; x++) {
+                float u = static_cast<float>(x) / static_cast<float>(size - 1);
+                float v = static_cast<float>(y) / static_cast<float>(size - 1);
+                float height = 0.05F * std::sin(u * 20.0F) * std::cos(v * 14.0F);
+                float dx = std::cos(u * 20.0F) * std::cos(v * 14.0F);
+                float dy = -0.7F * std::sin(u * 20.0F) * std::sin(v * 14.0F);
+                vml::vec3 normal(-dx, -dy, 1.0F);
+                data.positions.emplace_back(u, v, height);
+                data.uvs.emplace_back(u * uv_scale, v * uv_scale);
+                data.normals.push_back(normal / normal.magnitude());
+            }
+        }
+        for (uint32_t y = 0; y + 1 < size; y++) {
+            for (uint32_t x = 0; x + 1 < size; x++) {
+                uint32_t i = y * size + x;
+                data.indices.insert(data.indices.end(), {i, i + 1, i + size + 1, i, i + size + 1, i + size});
+            }
+        }
+        render::mesh_optimiser::optimise_vertex_cache(data.indices, static_cast<uint32_t>(data.positions.size()));
+        render::mesh_optimiser::optimise_vertex_fetch(data);
+        return data;
+    }
+}
+
+int main() {
+    std::printf("%8s %10s %7s %11s %10s %10s %10s %11s %12s %10s\n", "vertices", "layout", "stride", "vertex MiB", "total MiB", "read us", "read GB/s", "decode us", "Mverts/s", "max error");
+    for (uint32_t size : {128U, 512U, 1024U}) {
+        for (bool tiled : {false, true}) {
+            render::mesh_data data = make_grid(size, tiled);
+            auto vertex_count = static_cast<uint32_t>(data.positions.size());
+            double index_mib = static_cast<double>(sizeof(uint32_t) * data.indices.size()) / (1024.0 * 1024.0);
+
+            render::vertex_layout compact = render::get_compact_layout(data);
+            for (const render::vertex_layout& layout : {render::vertex_layout(), compact}) {
+                render::vertex_quantisation quantisation = render::get_quantisation(data, layout);
+                const uint32_t stride = layout.get_stride();
+                const uint32_t uv_offset = layout.get_offset(render::vertex_attribute::uv);
+                const uint32_t normal_offset = layout.get_offset(render::vertex_attribute::normal);
+                std::vector<uint8_t> vertices(static_cast<size_t>(vertex_count) * stride);
+                render::pack_vertices(data, layout, quantisation, vertices.data());
+
+                // Every index reads its vertex as it is stored
+                double read_us = bench::time_us([&]() {
+                    uint32_t acc = 0;
+                    for (uint32_t index : data.indices) {
+                        const uint8_t* vertex = vertices.data() + static_cast<size_t>(index) * stride;
+                        for (uint32_t offset = 0; offset < stride; offset += sizeof(uint32_t)) {
+                            uint32_t word;
+                            memcpy(&word, vertex + offset, sizeof(word));
+                            acc += word;
+                        }
+                    }
+                    bench::raw_sink = acc;
+                });
+                // Every index fetches and decodes its vertex, dequantising the position as the model matrix would
+                double decode_us = bench::time_us([&]() {
+                    float acc = 0.0F;
+                    for (uint32_t index : data.indices) {
+                        const uint8_t* vertex = vertices.data() + static_cast<size_t>(index) * stride;
+                        float position[4], uv[4], normal[4];
+                        fetch(layout.position, vertex, position);
+                        fetch(layout.uv, vertex + uv_offset, uv);
+                        fetch(layout.normal, vertex + normal_offset, normal);
+                        acc += quantisation.offset[0] + quantisation.scale * position[0] + uv[1] + normal[2];
+                    }
+                    bench::sink = acc;
+                });
+
+                float max_error = 0.0F;
+                for (uint32_t i = 0; i < vertex_count; i++) {
+                    float position[4] = {};
+                    fetch(layout.position, vertices.data() + static_cast<size_t>(i) * stride, position);
+                    for (int c = 0; c < 3; c++) {
+                        max_error = std::fmax(max_error, std::fabs(quantisation.offset[c] + quantisation.scale * position[c] - data.positions[i][c]));
+                    }
+                }
+
+                double vertex_mib = static_cast<double>(vertices.size()) / (1024.0 * 1024.0);
+                const char* name = layout == compact ? (tiled ? "compact/h" : "compact/u") : "float";
+                double read_gbs = static_cast<double>(stride) * static_cast<double>(data.indices.size()) / (read_us * 1000.0);
+                std::printf("%8u %10s %7u %11.2f %10.2f %10.1f %10.2f %11.1f %12.1f %10.2e\n", vertex_count, name, stride, vertex_mib, vertex_mib + index_mib, read_us, read_gbs,
+                            decode_us, static_cast<double>(data.indices.size()) / decode_us, max_error);
+            }
+        }
+    }
+    return 0;
+}
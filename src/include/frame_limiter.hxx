@@ -0,0 +1,18 @@
+#ifndef INVICULUM_FRAME_LIMITER_HPP
+#define INVICULUM_FRAME_LIMITER_HPP
+
+/**
+ * This is a header file, please see source file in src/main instead
+ */
+namespace frame_limiter {
+    void init();
+
+    void set_rate(double fps);
+    double get_rate();
+
+    void wait();
+
+    void terminate();
+}
+
+#endif//INVICULUM_FRAME_LIMITER_HPP
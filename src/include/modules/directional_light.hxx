@@ -11,15 +11,17 @@ namespace modules {
     class directional_light : public module {
     public:
         directional_light(float left, float right, float up, float front, float back, float ld);
+        explicit directional_light(const scene::scene_file& file);
 
         void render() override;
         void move_player(float x, float y) override;
 
     private:
         float l, r, u, f, b;
-        vml::mat4 bw, fl, pt;
-        float light_distance, light_angle;
-        vml::mat4 bwP, flP;
+        // Direction of the light at light_angle 0, the angle swings it about the z axis
+        vml::vec3 light_base;
+        float light_angle;
+        scene::entity sun, player;
         vml::vec2 player_pos = vml::vec2(0.0F, 0.25F);
     };
 }
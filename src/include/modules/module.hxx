@@ -1,15 +1,42 @@
 #ifndef INVICULUM_MODULE_HPP
 #define INVICULUM_MODULE_HPP
 
+#include <scene/render_system.hxx>
+#include <scene/scene.hxx>
+#include <scene/scene_file.hxx>
+
 #include <cstdint>
 
 namespace modules {
+    // How a module draws its shadows: blended projected quads, projected quads marked in the stencil buffer and
+    // resolved once per receiver (falls back to blended without a stencil buffer), or shadow maps rendered from each
+    // light and sampled while lighting (falls back to blended without shadow map support)
+    enum class shadow_technique {
+        blended,
+        stencil,
+        shadow_map
+    };
+
     class module {
     public:
         virtual void render() = 0;
         virtual void move_player(float x, float y) = 0;
 
         uint32_t shader = 0;
+        shadow_technique technique = shadow_technique::blended;
+        // Texture of the surfaces (see render_manager::load_texture), 0 leaves them plain
+        uint32_t texture = 0;
+
+    protected:
+        // Everything the module draws, see scene::render_system
+        scene::scene world;
+        // Projected shadows of the last frame, only the ones which changed are projected again
+        scene::render_system::shadow_cache shadows;
+
+        scene::entity add_surface(const vml::mat4& model, const vml::vec4& plane);
+        scene::entity add_player();
+        scene::entity load_world(const scene::scene_file& file);
+        void render_world(const vml::vec3& bounds_min, const vml::vec3& bounds_max, float shadow_alpha);
     };
 }
 
@@ -12,16 +12,17 @@
 namespace modules {
     class multi_point_light : public module {
     public:
-        multi_point_light(float left, float right, float up, float down, float front, float back);
+        multi_point_light(float left, float right, float up, float down, float front, float back, uint32_t light_count = 2);
+        explicit multi_point_light(const scene::scene_file& file);
+
+        scene::entity add_light(const vml::vec3& position);
 
         void render() override;
         void move_player(float x, float y) override;
 
     private:
         float l, r, u, d, f, b;
-        vml::mat4 lw, rw, bw, fl, ce, pt;
-        vml::vec3 light0, light1;
-        vml::mat4 lwP0, rwP0, bwP0, flP0, ceP0, lwP1, rwP1, bwP1, flP1, ceP1;
+        scene::entity player;
         vml::vec2 player_pos = vml::vec2(0.0F, 0.0F);
     };
 }
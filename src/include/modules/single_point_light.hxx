@@ -13,15 +13,14 @@ namespace modules {
     class single_point_light : public module {
     public:
         single_point_light(float left, float right, float up, float down, float front, float back);
+        explicit single_point_light(const scene::scene_file& file);
 
         void render() override;
         void move_player(float x, float y) override;
 
     private:
         float l, r, u, d, f, b;
-        vml::mat4 lw, rw, bw, fl, ce, pt;
-        vml::vec3 light;
-        vml::mat4 lwP, rwP, bwP, flP, ceP;
+        scene::entity player;
         vml::vec2 player_pos = vml::vec2(0.0F, 0.0F);
     };
 }
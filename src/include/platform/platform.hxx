@@ -1,6 +1,7 @@
 #ifndef INVICULUM_PLATFORM_PLATFORM_HPP
 #define INVICULUM_PLATFORM_PLATFORM_HPP
 
+#include <cstddef>
 #include <string>
 
 /**
@@ -11,6 +12,12 @@ namespace platform {
         extern const char FILE_SEPARATOR;
         std::string get_resource_folder();
         void create_folder(const std::string& folder);
+        const void* map_file(const std::string& path, size_t& size);
+        void unmap_file(const void* data, size_t size);
+    }
+    namespace timing {
+        void begin_precise_sleep();
+        void end_precise_sleep();
     }
 }
 
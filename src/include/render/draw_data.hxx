@@ -0,0 +1,35 @@
+#ifndef INVICULUM_RENDER_DRAWDATA_HPP
+#define INVICULUM_RENDER_DRAWDATA_HPP
+
+#include <vml/mat4.hxx>
+
+#include <cstdint>
+
+namespace render {
+    /**
+     * draw_data - Draw Data structure holds everything that changes from one draw to the next: model matrix, colour
+     * multiplier matrix, flags (x = render as a shadow), a world space bounding sphere (x, y, z, radius) used for
+     * culling and the texture slot sampled (0 is plain white). One is written per draw into a storage buffer which the
+     * shaders index with gl_InstanceIndex, matches the std430 layout of DrawData in the shaders
+     */
+    struct draw_data {
+        vml::mat4 m;
+        vml::mat4 cm;
+        vml::vec4 flags;
+        vml::vec4 bounds;
+        uint32_t texture;
+        uint32_t padding[3];
+    };
+
+    /**
+     * camera_data - Camera Data structure holds the projection and view matrices of one camera, every camera used in a
+     * frame is written to a per-frame storage buffer and batches pick theirs by index so moving the camera changes no
+     * recorded command. Matches the std430 layout of Camera in the shaders
+     */
+    struct camera_data {
+        vml::mat4 p;
+        vml::mat4 v;
+    };
+}
+
+#endif//INVICULUM_RENDER_DRAWDATA_HPP
@@ -0,0 +1,46 @@
+#ifndef INVICULUM_RENDER_MESHMANAGER_HPP
+#define INVICULUM_RENDER_MESHMANAGER_HPP
+
+#include "vulkan_wrapper.hxx"
+#include "render/vertex.hxx"
+
+#include <vml/mat4.hxx>
+
+#include <cstdint>
+
+/**
+ * This is a header file, please see source file in src/main instead
+ */
+namespace render::mesh_manager {
+    // Where a registered mesh lives: the layout it is stored in (which picks the shared buffers), its range of the index
+    // buffer and the vertex offset added to each index, as used by an indexed draw. Bounds are in the space of the stored
+    // positions, which dequantise (the identity unless positions are quantised) takes back to model space
+    struct mesh {
+        uint32_t layout = 0;
+        vk::IndexType index_type = vk::IndexType::eUint16;
+        uint32_t index_count = 0;
+        uint32_t first_index = 0;
+        int32_t vertex_offset = 0;
+        vml::vec3 bounds_min;
+        vml::vec3 bounds_max;
+        vml::mat4 dequantise = vml::mat4::identity();
+        bool quantised = false;
+        bool ready = false;
+    };
+
+    void init();
+
+    uint32_t register_mesh(const mesh_data& data);
+    uint32_t register_mesh(const mesh_data& data, const vertex_layout& layout);
+    const mesh& get_mesh(uint32_t id);
+    void update();
+
+    uint32_t get_layout(const vertex_layout& layout);
+    vk::Buffer get_vertex_buffer(uint32_t layout);
+    vk::Buffer get_index_buffer(uint32_t layout);
+    uint32_t get_vertex_input(uint32_t layout, vk::VertexInputBindingDescription& binding, vk::VertexInputAttributeDescription* attributes);
+
+    void terminate();
+}
+
+#endif//INVICULUM_RENDER_MESHMANAGER_HPP
@@ -0,0 +1,21 @@
+#ifndef INVICULUM_RENDER_MESHOPTIMISER_HPP
+#define INVICULUM_RENDER_MESHOPTIMISER_HPP
+
+#include "render/vertex.hxx"
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * This is a header file, please see source file in src/main instead
+ */
+namespace render::mesh_optimiser {
+    // Number of recently transformed vertices the cache optimisation assumes the GPU keeps
+    const uint32_t VERTEX_CACHE_SIZE = 32;
+
+    void optimise_vertex_cache(std::vector<uint32_t>& indices, uint32_t vertex_count);
+    void optimise_vertex_fetch(mesh_data& data);
+    float get_cache_miss_ratio(const std::vector<uint32_t>& indices, uint32_t vertex_count, uint32_t cache_size = VERTEX_CACHE_SIZE);
+}
+
+#endif//INVICULUM_RENDER_MESHOPTIMISER_HPP
@@ -4,21 +4,35 @@
 #include <vml/mat4.hxx>
 #include <vml/vec3.hxx>
 
+#include <cstdint>
+
 namespace render {
     /**
-     * push_constants - Push Constants structure is used to send key information to the shader pipeline:
-     * projection matrix, view matrix, model matrix, colour multiplier matrix, light direction vector,
-     * light 0 position, light 1 position and whether to render as a shadow
+     * push_constants - Push Constants structure is used to send the information shared by a whole bucket of draws to
+     * the shader pipeline: light direction vector, which of the frame's cameras (see camera_data) the bucket is seen
+     * through, the range of the light list used by the bucket and where its shadow map layers start (if shadow_maps is
+     * not 0). Per-draw values live in draw_data instead
      */
     struct push_constants {
-        vml::mat4 p;
-        vml::mat4 v;
-        vml::mat4 m;
-        vml::mat4 cm;
         vml::vec4 light_dir;
-        vml::vec4 light0;
-        vml::vec4 light1;
-        bool is_shadow;
+        uint32_t camera;
+        uint32_t first_light;
+        uint32_t light_count;
+        uint32_t first_shadow_layer;
+        uint32_t shadow_maps;
+        uint32_t padding[3];
+    };
+
+    /**
+     * cull_constants - Cull Constants structure is sent to the cull compute shader once per batch: the frustum planes of
+     * the batch, the range of commands to cull and which slot of the count buffer receives the number of visible draws
+     */
+    struct cull_constants {
+        vml::vec4 planes[6];
+        uint32_t first_command;
+        uint32_t command_count;
+        uint32_t count_index;
+        uint32_t padding;
     };
 }
 
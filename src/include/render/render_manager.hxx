@@ -1,6 +1,8 @@
 #ifndef INVICULUM_RENDER_RENDERMANAGER_HPP
 #define INVICULUM_RENDER_RENDERMANAGER_HPP
 
+#include "render/vertex.hxx"
+
 #include <string>
 #include <vml/mat4.hxx>
 
@@ -8,6 +10,21 @@
  * This is a header file, please see source file in src/main instead
  */
 namespace render::render_manager {
+    // How draws outside of the view frustum are removed before rendering
+    enum class cull_mode {
+        none,
+        cpu,
+        gpu
+    };
+    // Which variant of the bound pipeline the following draws use: normal surfaces, blended shadows, shadows marked
+    // into the stencil buffer, or a receiver redrawn to darken wherever it was marked
+    enum class draw_pass {
+        normal,
+        shadow_blend,
+        shadow_mark,
+        shadow_resolve
+    };
+
     void init();
 
     bool create_graphics_pipeline(const std::string& name);
@@ -16,6 +33,8 @@ namespace render::render_manager {
     void bind_pipeline(uint32_t id);
 
     float get_aspect_ratio();
+    bool supports_stencil();
+    bool supports_shadow_maps();
 
     void reset_push_constants();
     void set_perspective(const vml::mat4& pers);
@@ -23,12 +42,22 @@ namespace render::render_manager {
     void set_model(const vml::mat4& mode);
     void set_colour_mult(const vml::mat4& cm);
     void set_light_dir(const vml::vec3& l);
-    void set_light0(const vml::vec3& l);
-    void set_light1(const vml::vec3& l);
+    void set_lights(const vml::vec4* lights, uint32_t count);
     void set_is_shadow(bool is);
+    void set_draw_pass(draw_pass pass);
+    void set_casts_shadow(bool casts);
+    void set_static(bool is);
+    void use_shadow_maps(bool use);
+    void set_shadow_bounds(const vml::vec3& min, const vml::vec3& max);
+    void set_cull_mode(cull_mode mode);
+    uint32_t load_texture(const std::string& name);
+    void set_texture(uint32_t id);
 
-    void draw(uint32_t vertex_count, uint32_t instance_count, uint32_t first_vertex, uint32_t first_instance);
+    uint32_t register_mesh(const mesh_data& data);
+    void draw_mesh(uint32_t id, uint32_t instance_count = 1);
+    uint32_t get_rect_2D();
     void draw_rect_2D();
+    void submit();
 
     bool load_shaders();
     void unload_shaders();
@@ -0,0 +1,44 @@
+#ifndef INVICULUM_RENDER_TEXTUREMANAGER_HPP
+#define INVICULUM_RENDER_TEXTUREMANAGER_HPP
+
+#include "vulkan_wrapper.hxx"
+
+#include <cstdint>
+#include <string>
+
+/**
+ * This is a header file, please see source file in src/main instead
+ */
+namespace render::texture_manager {
+    // Most texture slots in the descriptor array with descriptor indexing, and without it. Either is lowered to what
+    // the device allows, slot 0 is always plain white
+    const uint32_t MAX_TEXTURES = 4096;
+    const uint32_t FALLBACK_TEXTURES = 64;
+
+    // How a texture is filtered and addressed, textures asking for the same description share one sampler
+    struct sampler_desc {
+        vk::Filter filter = vk::Filter::eLinear;
+        vk::SamplerAddressMode address = vk::SamplerAddressMode::eRepeat;
+        bool mipmaps = true;
+
+        bool operator<(const sampler_desc& other) const;
+    };
+
+    void init(uint32_t thread_count = 2);
+
+    uint32_t load(const std::string& name, const sampler_desc& sampler = sampler_desc());
+    void use(uint32_t id);
+    void update();
+
+    vk::Sampler get_sampler(const sampler_desc& desc);
+    void set_residency_budget(vk::DeviceSize budget);
+    vk::DeviceSize get_resident_size();
+
+    uint32_t get_capacity();
+    uint32_t get_version();
+    uint32_t get_descriptors(uint32_t since, uint32_t* slots, vk::DescriptorImageInfo* infos);
+
+    void terminate();
+}
+
+#endif//INVICULUM_RENDER_TEXTUREMANAGER_HPP
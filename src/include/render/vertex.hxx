@@ -1,16 +1,73 @@
 #ifndef INVICULUM_VERTEX_HPP
 #define INVICULUM_VERTEX_HPP
 
+#include <vml/vec2.hxx>
 #include <vml/vec3.hxx>
 
+#include <cstdint>
+#include <vector>
+
 namespace render {
+    // Vertex attributes in the order they are stored, which is also their input location in the vertex shaders
+    enum class vertex_attribute : uint32_t {
+        position,
+        uv,
+        normal
+    };
+    const uint32_t VERTEX_ATTRIBUTE_COUNT = 3;
+
+    // Formats a vertex attribute may be stored in, the vertex shaders always read floats: the unused components are
+    // filled in by the fixed function vertex fetch (z = 0) and normalised components are scaled back to -1 - 1 (snorm)
+    // or 0 - 1 (unorm). Positions stored as snorm16x4 are relative to the mesh's bounds, see vertex_quantisation
+    enum class vertex_format : uint8_t {
+        float2,
+        float3,
+        snorm8x4,
+        snorm16x4,
+        unorm16x2,
+        half2
+    };
+
     /**
-     * vertex - Vertex structure used to store the key value about a vertex (position and uv)
+     * vertex_layout - Vertex Layout structure describes how the vertices of a mesh are stored, every attribute is
+     * interleaved in one vertex buffer binding in the order of vertex_attribute. Meshes sharing a layout share buffers
+     * (see mesh_manager), flat meshes can drop z with float2 positions and unit normals fit in snorm8x4. The default is
+     * the full precision layout, get_compact_layout picks the smallest one which suits a mesh
      */
-    struct vertex {
-        vml::vec2 pos;
-        vml::vec2 uv;
+    struct vertex_layout {
+        vertex_format position = vertex_format::float3;
+        vertex_format uv = vertex_format::float2;
+        vertex_format normal = vertex_format::snorm8x4;
+
+        vertex_format get_format(vertex_attribute attribute) const;
+        uint32_t get_offset(vertex_attribute attribute) const;
+        uint32_t get_stride() const;
+        bool operator==(const vertex_layout& other) const;
     };
+
+    /**
+     * mesh_data - Mesh Data structure holds a mesh as imported, one element per vertex in each attribute list and three
+     * indices per triangle. Normals and uvs may be left empty (every normal is then +z and every uv 0), as may the
+     * indices if the vertices are already a triangle list
+     */
+    struct mesh_data {
+        std::vector<vml::vec3> positions;
+        std::vector<vml::vec2> uvs;
+        std::vector<vml::vec3> normals;
+        std::vector<uint32_t> indices;
+    };
+
+    // How the positions of a mesh are stored relative to its bounds, model space position = offset + scale * stored.
+    // The scale is the same on every axis so folding it into the model matrix keeps normals pointing the same way
+    struct vertex_quantisation {
+        vml::vec3 offset;
+        float scale = 1.0F;
+    };
+
+    uint32_t get_format_size(vertex_format format);
+    vertex_layout get_compact_layout(const mesh_data& data);
+    vertex_quantisation get_quantisation(const mesh_data& data, const vertex_layout& layout);
+    void pack_vertices(const mesh_data& data, const vertex_layout& layout, const vertex_quantisation& quantisation, uint8_t* dst);
 }
 
 #endif //INVICULUM_VERTEX_HPP
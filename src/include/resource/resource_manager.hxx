@@ -1,6 +1,9 @@
 #ifndef INVICULUM_RESOURCE_RESOURCEMANAGER_HPP
 #define INVICULUM_RESOURCE_RESOURCEMANAGER_HPP
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -8,8 +11,29 @@
  * This is a header file, please see source file in src/main instead
  */
 namespace resource::resource_manager {
+    // A file mapped into memory (see map_file), unmapped when destroyed
+    class mapped_file {
+    public:
+        mapped_file() = default;
+        mapped_file(const void* data, size_t size);
+        mapped_file(mapped_file&& other) noexcept;
+        mapped_file& operator=(mapped_file&& other) noexcept;
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+        ~mapped_file();
+
+        const uint8_t* data() const;
+        size_t size() const;
+
+    private:
+        const void* address = nullptr;
+        size_t length = 0;
+    };
+
     void init(const std::string& folder, char separator);
     std::vector<uint8_t> read_binary_file(const std::string& file_name, const std::vector<std::string>& folders);
+    mapped_file map_file(const std::string& file_name, const std::vector<std::string>& folders);
+    bool read_png_file(const std::string& file_name, const std::vector<std::string>& folders, const std::function<void*(uint32_t, uint32_t)>& allocate);
 }
 
 #endif//INVICULUM_RESOURCEMANAGER_HPP
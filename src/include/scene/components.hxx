@@ -0,0 +1,118 @@
+#ifndef INVICULUM_SCENE_COMPONENTS_HPP
+#define INVICULUM_SCENE_COMPONENTS_HPP
+
+#include <vml/mat4.hxx>
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/**
+ * This is a header file, please see source file in src/main instead
+ */
+namespace scene {
+    // An entity is only an id, what it is comes from the components it has
+    using entity = uint32_t;
+    const entity NO_ENTITY = std::numeric_limits<entity>::max();
+
+    // Where an entity is, its model matrix
+    struct transform {
+        vml::mat4 model = vml::mat4::identity();
+    };
+    // A mesh drawn with the entity's transform (see render_manager::draw_mesh), static ones are replayed from the cache
+    struct renderable {
+        uint32_t mesh = 0;
+        uint32_t texture = 0;
+        vml::mat4 colour = vml::mat4::identity();
+        bool is_static = false;
+    };
+    // A light, (x, y, z, 1) for a point light at x, y, z or (x, y, z, 0) for a directional light shining along x, y, z
+    struct light {
+        vml::vec4 l;
+    };
+    // A renderable casting shadows, the bounds of its mesh (in model space) decide which receivers it can shadow
+    struct shadow_caster {
+        vml::vec3 bounds_min;
+        vml::vec3 bounds_max;
+    };
+    // A renderable lying on a plane (a, b, c, d) facing into the scene, which planar shadows are projected onto
+    struct shadow_receiver {
+        vml::vec4 plane;
+    };
+
+    /**
+     * component_array - Component Array class stores one component of any number of entities contiguously (in no
+     * particular order) so systems walk it linearly, along with the entity owning each. Finding an entity's component is
+     * a lookup through a sparse index, removing one moves the last component into its place
+     */
+    template <typename T>
+    class component_array {
+    public:
+        // Give the entity this component (replacing the one it has), returns it
+        T& add(entity e, const T& value = T()) {
+            if (has(e)) {
+                return dense[sparse[e]] = value;
+            }
+            if (e >= sparse.size()) {
+                sparse.resize(e + 1, NO_INDEX);
+            }
+            sparse[e] = static_cast<uint32_t>(dense.size());
+            dense.push_back(value);
+            owners.push_back(e);
+            return dense.back();
+        }
+        // Take this component from the entity, if it has one
+        void remove(entity e) {
+            if (!has(e)) {
+                return;
+            }
+            uint32_t index = sparse[e];
+            dense[index] = dense.back();
+            owners[index] = owners.back();
+            sparse[owners[index]] = index;
+            dense.pop_back();
+            owners.pop_back();
+            sparse[e] = NO_INDEX;
+        }
+        bool has(entity e) const {
+            return e < sparse.size() && sparse[e] != NO_INDEX;
+        }
+        // Make room for count components and entities up to max_entity without reallocating
+        void reserve(uint32_t count, entity max_entity) {
+            dense.reserve(count);
+            owners.reserve(count);
+            if (max_entity >= sparse.size()) {
+                sparse.resize(max_entity + 1, NO_INDEX);
+            }
+        }
+        // Returns the entity's component, it must have one (see has)
+        T& get(entity e) {
+            return dense[sparse[e]];
+        }
+        const T& get(entity e) const {
+            return dense[sparse[e]];
+        }
+
+        // Every component and its owner by index, 0 to size
+        uint32_t size() const {
+            return static_cast<uint32_t>(dense.size());
+        }
+        T& operator[](uint32_t index) {
+            return dense[index];
+        }
+        const T& operator[](uint32_t index) const {
+            return dense[index];
+        }
+        entity owner(uint32_t index) const {
+            return owners[index];
+        }
+
+    private:
+        static constexpr uint32_t NO_INDEX = std::numeric_limits<uint32_t>::max();
+        std::vector<T> dense;
+        std::vector<entity> owners;
+        std::vector<uint32_t> sparse;
+    };
+}
+
+#endif//INVICULUM_SCENE_COMPONENTS_HPP
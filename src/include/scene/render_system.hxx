@@ -0,0 +1,49 @@
+#ifndef INVICULUM_SCENE_RENDERSYSTEM_HPP
+#define INVICULUM_SCENE_RENDERSYSTEM_HPP
+
+#include "scene/scene.hxx"
+
+#include <vector>
+
+/**
+ * This is a header file, please see source file in src/main instead
+ */
+namespace scene::render_system {
+    /**
+     * shadow_cache - Shadow Cache structure holds the planar shadows projected last frame, kept by whoever draws the
+     * scene so a shadow is only projected again when its light, receiver or caster changes (see draw_planar_shadows)
+     */
+    struct shadow_cache {
+        // Model matrix and bounds of one caster when it was last projected
+        struct caster {
+            vml::mat4 model;
+            vml::vec3 bounds_min;
+            vml::vec3 bounds_max;
+        };
+        // The shadow of one caster from one light onto one receiver and whether it is drawn at all
+        struct shadow {
+            vml::mat4 m;
+            bool casts = false;
+        };
+
+        // Inputs of the last projection, compared against the scene to find what changed
+        std::vector<vml::vec4> lights;
+        std::vector<vml::vec4> planes;
+        std::vector<caster> casters;
+        // Every shadow, shadows[(light * receiver_count + receiver) * caster_count + caster] as vml::plane_project lays
+        // them out
+        std::vector<shadow> shadows;
+        // Casters projected again this call, their model matrices and the batch's output, kept to avoid reallocating
+        std::vector<uint32_t> changed;
+        std::vector<vml::mat4> models;
+        std::vector<vml::mat4> projected;
+        // Number of shadows projected by the last draw_planar_shadows
+        uint32_t recomputed = 0;
+    };
+
+    void apply_lights(const scene& s);
+    void draw_renderables(const scene& s);
+    void draw_planar_shadows(const scene& s, shadow_cache& cache, const vml::mat4& colour, bool stencil);
+}
+
+#endif//INVICULUM_SCENE_RENDERSYSTEM_HPP
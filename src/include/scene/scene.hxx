@@ -0,0 +1,41 @@
+#ifndef INVICULUM_SCENE_SCENE_HPP
+#define INVICULUM_SCENE_SCENE_HPP
+
+#include "scene/components.hxx"
+#include "scene/transform_hierarchy.hxx"
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * This is a header file, please see source file in src/main instead
+ */
+namespace scene {
+    /**
+     * scene - Scene class holds every entity of a scene and their components, one component_array per component. Systems
+     * (see render_system) walk the arrays to do their work instead of each object being coded by hand
+     */
+    class scene {
+    public:
+        entity create();
+        void destroy(entity e);
+        bool is_alive(entity e) const;
+        uint32_t get_entity_count() const;
+
+        component_array<transform> transforms;
+        component_array<renderable> renderables;
+        component_array<light> lights;
+        component_array<shadow_caster> casters;
+        component_array<shadow_receiver> receivers;
+        // Places entities relative to others, writing their transforms (see transform_hierarchy::update)
+        transform_hierarchy hierarchy;
+
+    private:
+        uint32_t next = 0;
+        std::vector<entity> free;
+        // Whether each id below next is in use, so destroying twice never frees an id twice
+        std::vector<bool> alive;
+    };
+}
+
+#endif//INVICULUM_SCENE_SCENE_HPP
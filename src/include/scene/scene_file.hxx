@@ -0,0 +1,145 @@
+#ifndef INVICULUM_SCENE_SCENEFILE_HPP
+#define INVICULUM_SCENE_SCENEFILE_HPP
+
+#include "scene/scene.hxx"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <string>
+#include <vector>
+
+/**
+ * This is a header file, please see source file in src/main instead
+ */
+namespace scene {
+    const char SCENE_FILE_MAGIC[4] = {'I', 'V', 'S', 'C'};
+    const uint32_t SCENE_FILE_VERSION = 1;
+    // Every section starts on this alignment
+    const uint32_t SCENE_FILE_ALIGNMENT = 16;
+    // Returned by the mesh lookup given to instantiate for a mesh which does not exist
+    const uint32_t NO_MESH = std::numeric_limits<uint32_t>::max();
+
+    enum class scene_section : uint32_t {
+        entities,
+        transforms,
+        lights,
+        planes,
+        meshes,
+        casters,
+        strings,
+        count
+    };
+
+    // Where a section is in the file, records are stride bytes apart so later versions can append fields to them
+    struct scene_file_section {
+        uint32_t offset;
+        uint32_t count;
+        uint32_t stride;
+        uint32_t reserved;
+    };
+    // Start of the file. Names are offsets into the strings section, the module names which code drives the scene and
+    // the bounds are the region shadows can fall in (and the player can move in)
+    struct scene_file_header {
+        char magic[4];
+        uint32_t version;
+        uint32_t file_size;
+        uint32_t module;
+        float bounds_min[4];
+        float bounds_max[4];
+        scene_file_section sections[static_cast<uint32_t>(scene_section::count)];
+    };
+
+    // Records of each section, entities refer to the entity's index in the entities section
+    struct entity_record {
+        uint32_t name;
+    };
+    // Local translation, rotation (laid out as vml::quaternion) and scale, a parent's record comes before its children's
+    struct transform_record {
+        uint32_t entity;
+        uint32_t parent;
+        uint32_t reserved[2];
+        float translation[4];
+        float rotation[4];
+        float scale[4];
+    };
+    struct light_record {
+        uint32_t entity;
+        uint32_t reserved[3];
+        float l[4];
+    };
+    struct plane_record {
+        uint32_t entity;
+        uint32_t reserved[3];
+        float plane[4];
+    };
+    const uint32_t MESH_STATIC = 1;
+    struct mesh_record {
+        uint32_t entity;
+        uint32_t name;
+        uint32_t flags;
+        uint32_t reserved;
+        float colour[4];
+    };
+    struct caster_record {
+        uint32_t entity;
+        uint32_t reserved[3];
+        float bounds_min[4];
+        float bounds_max[4];
+    };
+
+    /**
+     * scene_file - Scene File class reads a binary scene file in place, the file is only checked and never copied so
+     * it must stay in memory (e.g mapped, see resource_manager::map_file) while it is used
+     */
+    class scene_file {
+    public:
+        bool load(const uint8_t* data, size_t size);
+
+        const char* get_module() const;
+        vml::vec3 get_bounds_min() const;
+        vml::vec3 get_bounds_max() const;
+        uint32_t get_count(scene_section section) const;
+        const char* get_entity_name(uint32_t i) const;
+        uint32_t find_entity(const std::string& name) const;
+
+        // Record i of a section, which must hold records of this type
+        template<typename T>
+        const T& get(scene_section section, uint32_t i) const {
+            const scene_file_section& s = header->sections[static_cast<uint32_t>(section)];
+            return *reinterpret_cast<const T*>(base + s.offset + static_cast<size_t>(i) * s.stride);
+        }
+
+        std::vector<entity> instantiate(scene& s, const std::function<uint32_t(const char*)>& find_mesh) const;
+
+    private:
+        const char* get_string(uint32_t offset) const;
+
+        const uint8_t* base = nullptr;
+        const scene_file_header* header = nullptr;
+    };
+
+    /**
+     * scene_file_writer - Scene File Writer class collects records and writes them out as a binary scene file
+     */
+    class scene_file_writer {
+    public:
+        uint32_t add_string(const std::string& value);
+        uint32_t add_entity(const std::string& name);
+
+        std::vector<uint8_t> write(const std::string& module, const vml::vec3& bounds_min, const vml::vec3& bounds_max);
+
+        std::vector<entity_record> entities;
+        std::vector<transform_record> transforms;
+        std::vector<light_record> lights;
+        std::vector<plane_record> planes;
+        std::vector<mesh_record> meshes;
+        std::vector<caster_record> casters;
+
+    private:
+        std::string strings = std::string(1, '\0');
+    };
+}
+
+#endif//INVICULUM_SCENE_SCENEFILE_HPP
@@ -0,0 +1,72 @@
+#ifndef INVICULUM_SCENE_TRANSFORMHIERARCHY_HPP
+#define INVICULUM_SCENE_TRANSFORMHIERARCHY_HPP
+
+#include "scene/components.hxx"
+
+#include <vml/mat4.hxx>
+#include <vml/quaternion.hxx>
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/**
+ * This is a header file, please see source file in src/main instead
+ */
+namespace scene {
+    /**
+     * transform_hierarchy - Transform Hierarchy class places entities relative to a parent, each node has a local
+     * translation, rotation and scale and its world matrix is its parent's world matrix times its local matrix. Nodes are
+     * kept depth first, every node followed by its descendants, with each field in its own array
+     */
+    class transform_hierarchy {
+    public:
+        void add(entity e, entity parent = NO_ENTITY, const vml::vec3& translation = vml::vec3(0.0F, 0.0F, 0.0F),
+                 const vml::quaternion& rotation = vml::quaternion::identity(), const vml::vec3& scale = vml::vec3(1.0F, 1.0F, 1.0F));
+        void remove(entity e);
+        void set_parent(entity e, entity parent);
+        bool has(entity e) const;
+        entity get_parent(entity e) const;
+
+        void set_translation(entity e, const vml::vec3& translation);
+        void set_rotation(entity e, const vml::quaternion& rotation);
+        void set_scale(entity e, const vml::vec3& scale);
+        const vml::vec3& get_translation(entity e) const;
+        const vml::quaternion& get_rotation(entity e) const;
+        const vml::vec3& get_scale(entity e) const;
+        const vml::mat4& get_world(entity e) const;
+
+        void update(component_array<transform>& transforms, uint32_t thread_count = 1);
+        void reserve(uint32_t count, entity max_entity);
+        uint32_t size() const;
+
+    private:
+        static constexpr uint32_t NO_INDEX = std::numeric_limits<uint32_t>::max();
+
+        uint32_t index(entity e) const;
+        void mark_dirty(uint32_t i);
+        void move_block(std::vector<entity>& parent_entities, uint32_t first, uint32_t count, uint32_t pos);
+        void rebuild(const std::vector<entity>& parent_entities);
+        std::vector<entity> get_parent_entities() const;
+        void split(uint32_t root, uint32_t share, component_array<transform>& transforms);
+        void update_range(const uint32_t* first, const uint32_t* last, component_array<transform>& transforms);
+        void update_node(uint32_t i, component_array<transform>& transforms);
+
+        // Per node, depth first. ends holds the index after the node's last descendant, parents the index of its parent
+        std::vector<entity> entities;
+        std::vector<uint32_t> parents;
+        std::vector<uint32_t> ends;
+        std::vector<vml::vec3> translations;
+        std::vector<vml::quaternion> rotations;
+        std::vector<vml::vec3> scales;
+        std::vector<vml::mat4> worlds;
+        std::vector<uint8_t> dirty;
+
+        // Node index of each entity, the nodes changed since the last update and the subtrees each update recalculates
+        std::vector<uint32_t> sparse;
+        std::vector<uint32_t> dirty_nodes;
+        std::vector<uint32_t> roots;
+    };
+}
+
+#endif//INVICULUM_SCENE_TRANSFORMHIERARCHY_HPP
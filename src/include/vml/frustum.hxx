@@ -0,0 +1,28 @@
+#ifndef INVICULUM_VML_FRUSTUM_HPP
+#define INVICULUM_VML_FRUSTUM_HPP
+
+#include <vml/mat4.hxx>
+
+#include <cstdint>
+
+/**
+ * This is a header file, please see source file in src/main instead
+ */
+namespace vml {
+    struct alignas(16) frustum {
+        vec4 planes[6];
+
+        vec4& operator[](int i);
+        vec4 const& operator[](int i) const;
+    };
+
+    frustum extract_frustum(const mat4& m);
+
+    bool intersects_sphere(const frustum& f, const vec3& centre, float radius);
+    bool intersects_aabb(const frustum& f, const vec3& min, const vec3& max);
+    void intersects_spheres(const frustum& f, const vec4* spheres, uint32_t count, uint8_t* visible);
+
+    vec4 bounding_sphere(const mat4& m, const vec3& min, const vec3& max);
+}
+
+#endif//INVICULUM_VML_FRUSTUM_HPP
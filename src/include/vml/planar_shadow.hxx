@@ -0,0 +1,18 @@
+#ifndef INVICULUM_VML_PLANAR_SHADOW_HPP
+#define INVICULUM_VML_PLANAR_SHADOW_HPP
+
+#include <vml/mat4.hxx>
+
+#include <cstdint>
+
+/**
+ * This is a header file, please see source file in src/main instead
+ */
+namespace vml {
+    vec4 plane(const vec3& normal, const vec3& point);
+
+    mat4 plane_project(const vec4& light, const vec4& plane);
+    void plane_project(const vec4* lights, const float* offsets, uint32_t light_count, const vec4* planes, uint32_t plane_count, const mat4* casters, uint32_t caster_count, mat4* out, uint32_t thread_count = 1);
+}
+
+#endif//INVICULUM_VML_PLANAR_SHADOW_HPP
@@ -18,8 +18,9 @@ namespace vml {
     mat4 rotate_y(float rad);
     mat4 rotate_z(float rad);
 
-    mat4 ortho(float left, float right, float bottom, float top, float near, float far);
+    mat4 orthographic(float left, float right, float bottom, float top, float near, float far);
     mat4 perspective(float aspectRatio, float fov, float near, float far);
+    mat4 look_at(const vec3& eye, const vec3& centre, const vec3& up);
 
     mat4 rotate(float rad, const vec3 &axis);
     mat4 rotate(const quaternion &q);
@@ -8,35 +8,225 @@
  */
 namespace vulkan_wrapper {
 
+    // Fixed function state which differs between pipelines sharing the same shaders, the defaults give the normal
+    // depth tested, alpha blended pipeline
+    struct pipeline_state {
+        bool depth_write = true;
+        vk::CompareOp depth_compare = vk::CompareOp::eLess;
+        bool depth_bias = false;
+        float depth_bias_constant = 0.0F;
+        float depth_bias_slope = 0.0F;
+        bool colour_write = true;
+        bool stencil_test = false;
+        vk::StencilOpState stencil;
+        // Render into a depth_target instead of the swapchain, no colour attachment and the viewport is set by
+        // begin_depth_pass
+        bool depth_only = false;
+    };
+
+    // How frames are presented: low latency (Mailbox or Immediate), power saving (First-in-First-out, meant to be paired
+    // with a frame cap) or throughput (Immediate, uncapped for benchmarking)
+    enum class present_policy {
+        low_latency,
+        power_saving,
+        throughput
+    };
+
+    // Measured per frame in milliseconds: how long the CPU blocked waiting for the GPU, how long the GPU sat idle
+    // between frames and how long the GPU took for the frame
+    struct frame_timings {
+        double cpu_wait = 0.0;
+        double gpu_wait = 0.0;
+        double gpu_time = 0.0;
+    };
+
+    // Command buffers recorded by a frame and how many of them had to be allocated, zero once the pools are warm
+    struct command_stats {
+        uint32_t buffers = 0;
+        uint32_t allocations = 0;
+    };
+
+    // Secondary command buffer recorded once and replayed inside the main render pass, see begin_cached_commands
+    struct cached_commands {
+        vk::CommandBuffer buffer;
+        uint32_t render_pass_version = 0;
+        vk::Extent2D extent;
+        bool recorded = false;
+    };
+
+    // Dynamic resolution, the scene is rendered at a scale of the swapchain size (between min_scale and max_scale)
+    // chosen each frame to keep the GPU time of a frame near target_time (in milliseconds), then scaled up into the
+    // swapchain image. Disabled renders straight into the swapchain image
+    struct resolution_settings {
+        bool enabled = false;
+        float min_scale = 0.5F;
+        float max_scale = 1.0F;
+        double target_time = 1000.0 / 60.0;
+    };
+
+    // Part of the current frame's region of the ring buffer, data points at the mapped memory at offset
+    struct ring_allocation {
+        vk::Buffer buffer;
+        vk::DeviceSize offset = 0;
+        vk::DeviceSize size = 0;
+        void* data = nullptr;
+    };
+
+    // Persistently mapped host visible buffer which uploads are copied from, see acquire_staging
+    struct staging_buffer {
+        vk::Buffer buffer;
+        vk::DeviceMemory memory;
+        vk::DeviceSize size = 0;
+        void* data = nullptr;
+    };
+
+    // Sampled RGBA image with a full view of its mips, see create_texture_image
+    struct texture_image {
+        vk::Image image;
+        vk::DeviceMemory memory;
+        vk::ImageView view;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t levels = 0;
+        vk::DeviceSize size = 0;
+    };
+
+    // Layered depth image rendered by depth only passes (one framebuffer per layer) and sampled afterwards as a
+    // 2D array, e.g shadow maps
+    struct depth_target {
+        vk::Image image;
+        vk::DeviceMemory memory;
+        vk::ImageView view;
+        std::vector<vk::ImageView> layer_views;
+        std::vector<vk::Framebuffer> framebuffers;
+        uint32_t size = 0;
+        uint32_t layers = 0;
+    };
+
     bool create_instance(std::vector<const char*> extensions);
     bool create_surface(bool(*fn)(const vk::Instance&, vk::SurfaceKHR&), void (*r)(int*, int*));
     bool create_others();
     bool create_swapchain();
 
+    bool create_buffer(vk::Buffer& buffer, vk::DeviceMemory& memory, vk::DeviceSize size, const vk::BufferUsageFlags& usage, const vk::MemoryPropertyFlags& properties);
+    void map_buffer(const vk::DeviceMemory& memory, vk::DeviceSize offset, vk::DeviceSize size, const void* data);
+    void* map_memory(const vk::DeviceMemory& memory);
+    void unmap_memory(const vk::DeviceMemory& memory);
+    bool create_shared_buffer(vk::Buffer& buffer, vk::DeviceMemory& memory, vk::DeviceSize size, const vk::BufferUsageFlags& usage, const vk::MemoryPropertyFlags& properties);
+    void destroy_buffer(const vk::Buffer& buffer, const vk::DeviceMemory& memory);
+    bool has_transfer_queue();
+    bool upload_buffer(const vk::Buffer& buffer, vk::DeviceSize offset, vk::DeviceSize size, const void* data, const vk::PipelineStageFlags& dst_stage, const vk::AccessFlags& dst_access);
+    bool upload_image(const vk::Image& image, const vk::ImageSubresourceLayers& subresource, const vk::Extent3D& extent, vk::DeviceSize size, const void* data, vk::ImageLayout layout, const vk::PipelineStageFlags& dst_stage, const vk::AccessFlags& dst_access);
+    bool upload_image(const vk::Image& image, const staging_buffer& staging, uint32_t region_count, const vk::BufferImageCopy* regions, const vk::ImageSubresourceRange& range, vk::ImageLayout layout, const vk::PipelineStageFlags& dst_stage, const vk::AccessFlags& dst_access);
+    bool acquire_staging(vk::DeviceSize size, staging_buffer& staging);
+    void release_staging(const staging_buffer& staging);
+
     bool create_vertex_buffer(vk::Buffer& buffer, vk::DeviceMemory& memory, uint32_t size);
     void map_vertex_buffer(const vk::DeviceMemory& memory, uint32_t size, const void* data);
     void destroy_vertex_buffer(const vk::Buffer& buffer, const vk::DeviceMemory& memory);
 
+    bool create_depth_target(depth_target& target, uint32_t size, uint32_t layers);
+    void destroy_depth_target(const depth_target& target);
+    bool create_texture_image(texture_image& texture, uint32_t width, uint32_t height, uint32_t levels);
+    void destroy_texture_image(const texture_image& texture);
+    void generate_mipmaps(const texture_image& texture);
+    bool create_sampler(vk::Sampler& sampler, const vk::SamplerCreateInfo& sampler_create_info);
+    void destroy_sampler(const vk::Sampler& sampler);
+
+    bool create_descriptor_set_layout(vk::DescriptorSetLayout& layout, const vk::DescriptorSetLayoutCreateInfo& layout_create_info);
+    void destroy_descriptor_set_layout(const vk::DescriptorSetLayout& layout);
+    bool create_descriptor_pool(vk::DescriptorPool& pool, const vk::DescriptorPoolCreateInfo& pool_create_info);
+    void destroy_descriptor_pool(const vk::DescriptorPool& pool);
+    bool allocate_descriptor_sets(std::vector<vk::DescriptorSet>& sets, const vk::DescriptorSetAllocateInfo& allocate_info);
+    void update_descriptor_sets(uint32_t count, const vk::WriteDescriptorSet* writes);
+
     bool create_shader_module(vk::ShaderModule& shader_module, const std::vector<uint8_t>& src);
     void destroy_shader_module(const vk::ShaderModule& shader_module);
 
     bool create_pipeline_layout(vk::PipelineLayout& pipeline_layout, const vk::PipelineLayoutCreateInfo& pipeline_layout_create_info);
     void destroy_pipeline_layout(const vk::PipelineLayout& pipeline_layout);
-    bool create_pipeline(vk::Pipeline& pipeline, const vk::PipelineLayout& pipeline_layout, uint32_t shader_module_count, const vk::PipelineShaderStageCreateInfo* shader_modules, uint32_t vertex_binding_description_count, const vk::VertexInputBindingDescription* vertex_binding_descriptions, uint32_t vertex_attribute_description_count, const vk::VertexInputAttributeDescription* vertex_attribute_descriptions, float target_aspect);
+    bool create_pipeline(vk::Pipeline& pipeline, const vk::PipelineLayout& pipeline_layout, uint32_t shader_module_count, const vk::PipelineShaderStageCreateInfo* shader_modules, uint32_t vertex_binding_description_count, const vk::VertexInputBindingDescription* vertex_binding_descriptions, uint32_t vertex_attribute_description_count, const vk::VertexInputAttributeDescription* vertex_attribute_descriptions, float target_aspect, const pipeline_state& state = pipeline_state());
+    bool create_compute_pipeline(vk::Pipeline& pipeline, const vk::PipelineLayout& pipeline_layout, const vk::PipelineShaderStageCreateInfo& shader_module);
     void destroy_pipeline(const vk::Pipeline& pipeline);
 
     bool render_frame(void (*external_render)());
+    void wait_for_frame();
+    void pace_frame();
+    void begin_render_pass(bool secondary = false);
+    void begin_secondary_commands();
+    void end_secondary_commands();
+    void begin_async_compute();
+    void end_async_compute(const vk::PipelineStageFlags& wait_stages);
+    bool has_async_compute();
+    void begin_cached_commands(cached_commands& cache);
+    void end_cached_commands(cached_commands& cache);
+    bool cached_commands_valid(const cached_commands& cache);
+    void execute_cached_commands(const cached_commands& cache);
+    void free_cached_commands(cached_commands& cache);
+    void begin_depth_pass(const depth_target& target, uint32_t layer);
+    void end_depth_pass();
+
+    bool in_frame();
+    uint32_t get_frame_index();
+    uint32_t get_max_frames_in_flight();
+    uint32_t get_frames_in_flight();
+    void set_frames_in_flight(uint32_t count);
+    bool get_latency_mode();
+    void set_latency_mode(bool enabled);
+    present_policy get_present_policy();
+    bool set_present_policy(present_policy policy);
+    uint32_t get_msaa_samples();
+    uint32_t get_max_msaa_samples();
+    uint32_t set_msaa_samples(uint32_t samples);
+    uint32_t get_render_pass_version();
+    bool supports_dynamic_resolution();
+    const resolution_settings& get_resolution_settings();
+    void set_resolution_settings(const resolution_settings& settings);
+    float get_resolution_scale();
+    const frame_timings& get_frame_timings();
+    const command_stats& get_command_stats();
+    bool supports_draw_indirect_count();
+    bool supports_stencil();
+    bool supports_descriptor_indexing();
+    uint32_t get_max_sampled_images();
 
     float get_aspect_ratio();
 
     void bind_pipeline(const vk::Pipeline& pipeline);
     void bind_vertex_buffers(uint32_t count, const vk::Buffer* buffers, const vk::DeviceSize* offsets);
+    void bind_index_buffer(const vk::Buffer& buffer, vk::DeviceSize offset, vk::IndexType type);
     void push_constants(const vk::PipelineLayout& layout, const vk::ShaderStageFlags& stage, uint32_t offset, uint32_t size, const void* ptr);
+    void bind_compute_pipeline(const vk::Pipeline& pipeline);
+    void bind_compute_descriptor_sets(const vk::PipelineLayout& layout, uint32_t first_set, uint32_t count, const vk::DescriptorSet* sets);
+    void dispatch(uint32_t x, uint32_t y, uint32_t z);
+    void buffer_barrier(const vk::Buffer& buffer, const vk::PipelineStageFlags& src_stage, const vk::AccessFlags& src_access, const vk::PipelineStageFlags& dst_stage, const vk::AccessFlags& dst_access);
+    void image_barrier(const vk::Image& image, const vk::ImageSubresourceRange& range, vk::ImageLayout old_layout, vk::ImageLayout new_layout, const vk::PipelineStageFlags& src_stage, const vk::AccessFlags& src_access, const vk::PipelineStageFlags& dst_stage, const vk::AccessFlags& dst_access);
+    void bind_descriptor_sets(const vk::PipelineLayout& layout, uint32_t first_set, uint32_t count, const vk::DescriptorSet* sets);
     void draw(uint32_t vertex_count, uint32_t instance_count, uint32_t first_vertex, uint32_t first_instance);
+    void draw_indirect(const vk::Buffer& buffer, vk::DeviceSize offset, uint32_t draw_count, uint32_t stride);
+    void draw_indirect_count(const vk::Buffer& buffer, vk::DeviceSize offset, const vk::Buffer& count_buffer, vk::DeviceSize count_offset, uint32_t max_draw_count, uint32_t stride);
+    void draw_indexed_indirect(const vk::Buffer& buffer, vk::DeviceSize offset, uint32_t draw_count, uint32_t stride);
+    void draw_indexed_indirect_count(const vk::Buffer& buffer, vk::DeviceSize offset, const vk::Buffer& count_buffer, vk::DeviceSize count_offset, uint32_t max_draw_count, uint32_t stride);
 
     bool reload_swapchain();
     void destroy_swapchain();
 
+    bool ring_allocate(vk::DeviceSize size, vk::DeviceSize alignment, ring_allocation& allocation);
+    bool ring_reserve(uint32_t count, const vk::DeviceSize* sizes);
+    bool ring_upload(const void* data, vk::DeviceSize size, ring_allocation& allocation);
+    vk::DeviceSize get_ring_high_water();
+    vk::DeviceSize get_ring_region_size();
+
+    void defer_destroy(const vk::Pipeline& object);
+    void defer_destroy(const vk::PipelineLayout& object);
+    void defer_destroy(const vk::Buffer& object);
+    void defer_destroy(const vk::DeviceMemory& object);
+    void defer_destroy(const vk::Image& object);
+    void defer_destroy(const vk::ImageView& object);
+    void defer_destroy(const vk::Framebuffer& object);
+    void defer_destroy(const vk::Sampler& object);
+    void defer_destroy(const texture_image& texture);
+
     void wait_idle();
     void terminate();
 }
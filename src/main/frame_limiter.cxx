@@ -0,0 +1,83 @@
+#include "frame_limiter.hxx"
+
+#include "platform/platform.hxx"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+/**
+ * frame_limiter - Frame Limiter namespace caps the rate of the game loop on the CPU. Sleeping alone is too coarse (the
+ * OS may oversleep by a millisecond or more) so it sleeps until just before the deadline and spins for the rest. The
+ * platform's sleep resolution is raised while the limiter runs and the spin margin grows to the oversleep measured
+ */
+namespace frame_limiter {
+    namespace {
+        using clock = std::chrono::steady_clock;
+        // Least time left before the deadline where sleeping stops and spinning starts
+        const clock::duration SPIN_MARGIN = std::chrono::microseconds(1500);
+
+        struct info {
+            // 0 means uncapped
+            double rate = 0.0;
+            clock::duration period = clock::duration::zero();
+            clock::time_point next;
+            // Spin margin in use, the largest recent oversleep (decaying slowly) but never under SPIN_MARGIN
+            clock::duration margin = SPIN_MARGIN;
+        };
+        std::unique_ptr<info> info_p;
+    }
+
+    void init() {
+        info_p = std::make_unique<info>();
+        info_p->next = clock::now();
+        platform::timing::begin_precise_sleep();
+    }
+
+    /**
+     * set_rate - Set Rate function sets the most frames per second the loop may run at
+     * @param fps - frames per second, 0 (or less) removes the cap
+     */
+    void set_rate(double fps) {
+        info_p->rate = fps > 0.0 ? fps : 0.0;
+        info_p->period = fps > 0.0 ? std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / fps)) : clock::duration::zero();
+        info_p->next = clock::now() + info_p->period;
+    }
+    // Returns the current cap in frames per second, 0 if uncapped
+    double get_rate() {
+        return info_p->rate;
+    }
+
+    /**
+     * wait - Wait function blocks until the next frame is due, called once per iteration of the game loop. Deadlines
+     * follow each other by exactly one period so the rate does not drift, unless the loop fell more than a period
+     * behind in which case it restarts from now instead of rushing to catch up
+     */
+    void wait() {
+        if (info_p->rate <= 0.0) {
+            return;
+        }
+        clock::time_point now = clock::now();
+        if (info_p->next > now + info_p->margin) {
+            clock::time_point wake = info_p->next - info_p->margin;
+            std::this_thread::sleep_for(wake - now);
+            // Keep the margin above the worst oversleep seen, letting it shrink back by 1/16 each frame
+            clock::duration oversleep = clock::now() - wake;
+            info_p->margin = std::max({SPIN_MARGIN, oversleep + oversleep / 4, info_p->margin - info_p->margin / 16});
+        }
+        while (clock::now() < info_p->next) {
+            std::this_thread::yield();
+        }
+        now = clock::now();
+        info_p->next += info_p->period;
+        if (info_p->next < now) {
+            info_p->next = now + info_p->period;
+        }
+    }
+
+    void terminate() {
+        platform::timing::end_precise_sleep();
+        info_p.reset(nullptr);
+    }
+}
@@ -1,12 +1,17 @@
 #include <game.hxx>
 
+#include <frame_limiter.hxx>
 #include <modules/multi_point_light.hxx>
 #include <modules/single_point_light.hxx>
 #include <modules/directional_light.hxx>
 #include <render/render_manager.hxx>
+#include <resource/resource_manager.hxx>
+#include <scene/scene_file.hxx>
 #include <vml/transform.hxx>
+#include <vulkan_wrapper.hxx>
 
 #include <memory>
+#include <string>
 #include <GLFW/glfw3.h>
 
 /**
@@ -17,6 +22,9 @@ namespace game {
      * Anonymous namespace to hold 'private' variables
      */
     namespace {
+        // Frame cap used with the power saving present policy
+        const double POWER_SAVING_RATE = 30.0;
+
         struct info {
             uint32_t dl_shader_id;
             uint32_t spl_shader_id;
@@ -32,6 +40,23 @@ namespace game {
             modules::module* current;
         };
         std::unique_ptr<info> info_p;
+
+        /**
+         * create_module - Create Module function creates a module from its scene file (scenes/<name>.scn), mapped and
+         * used in place. Without a scene file for this module the built in scene is used
+         * @param name - name of the scene file and module
+         * @param args - arguments of the built in scene
+         * @return - the module
+         */
+        template<typename T, typename... Args>
+        T* create_module(const std::string& name, Args... args) {
+            resource::resource_manager::mapped_file mapping = resource::resource_manager::map_file(name + ".scn", {"scenes"});
+            scene::scene_file file;
+            if (file.load(mapping.data(), mapping.size()) && name == file.get_module()) {
+                return new T(file);
+            }
+            return new T(args...);
+        }
     }
     /**
      * init - Initialisation function to load all necessary graphics pipelines and setup the example modules.
@@ -50,13 +75,18 @@ namespace game {
         info_p->right = false;
         info_p->down = false;
         info_p->up = false;
-        // Create each scene and assign the correct shader pipeline to it
-        info_p->dl = new modules::directional_light(-2.0F, 2.0F, 2.0F, -2.0F, -4.0F, 20.0F);
+        // Create each scene from its scene file and assign the correct shader pipeline to it
+        info_p->dl = create_module<modules::directional_light>("directional", -2.0F, 2.0F, 2.0F, -2.0F, -4.0F, 20.0F);
         info_p->dl->shader = info_p->dl_shader_id;
-        info_p->spl = new modules::single_point_light(-2.0F, 2.0F, 1.0F, -1.0F, -2.0F, -4.0F);
+        info_p->spl = create_module<modules::single_point_light>("single_point", -2.0F, 2.0F, 1.0F, -1.0F, -2.0F, -4.0F);
         info_p->spl->shader = info_p->spl_shader_id;
-        info_p->mpl = new modules::multi_point_light(-2.0F, 2.0F, 1.0F, -1.0F, -2.0F, -4.0F);
+        info_p->mpl = create_module<modules::multi_point_light>("multi_point", -2.0F, 2.0F, 1.0F, -1.0F, -2.0F, -4.0F);
         info_p->mpl->shader = info_p->mpl_shader_id;
+        // Every scene's surfaces share one texture, streamed in while the scenes are already drawn
+        uint32_t wall = render::render_manager::load_texture("wall.png");
+        info_p->dl->texture = wall;
+        info_p->spl->texture = wall;
+        info_p->mpl->texture = wall;
 
         // Set the current scene to the Directional Light example
         info_p->current = info_p->dl;
@@ -70,7 +100,8 @@ namespace game {
         render::render_manager::reset_push_constants();
         render::render_manager::set_perspective(vml::perspective(render::render_manager::get_aspect_ratio(), 0.5F, 0.1F, 10.0F));
         info_p->current->render();
-
+        // Send every recorded draw to the GPU
+        render::render_manager::submit();
     }
 
     /**
@@ -95,6 +126,56 @@ namespace game {
                 info_p->current = info_p->mpl;
                 return;
             }
+            // Cycle every scene between blended, stencil and shadow mapped shadows with the T key
+            if (key == GLFW_KEY_T) {
+                modules::shadow_technique technique = modules::shadow_technique::blended;
+                if (info_p->current->technique == modules::shadow_technique::blended) {
+                    technique = modules::shadow_technique::stencil;
+                }
+                else if (info_p->current->technique == modules::shadow_technique::stencil) {
+                    technique = modules::shadow_technique::shadow_map;
+                }
+                info_p->dl->technique = technique;
+                info_p->spl->technique = technique;
+                info_p->mpl->technique = technique;
+                return;
+            }
+            // Cycle the number of frames in flight between 1 and the maximum with the F key
+            if (key == GLFW_KEY_F) {
+                vulkan_wrapper::set_frames_in_flight(vulkan_wrapper::get_frames_in_flight() % vulkan_wrapper::get_max_frames_in_flight() + 1);
+                return;
+            }
+            // Cycle the present policy between low latency, power saving (capped) and throughput with the P key
+            if (key == GLFW_KEY_P) {
+                vulkan_wrapper::present_policy policy = vulkan_wrapper::present_policy::low_latency;
+                if (vulkan_wrapper::get_present_policy() == vulkan_wrapper::present_policy::low_latency) {
+                    policy = vulkan_wrapper::present_policy::power_saving;
+                }
+                else if (vulkan_wrapper::get_present_policy() == vulkan_wrapper::present_policy::power_saving) {
+                    policy = vulkan_wrapper::present_policy::throughput;
+                }
+                vulkan_wrapper::set_present_policy(policy);
+                frame_limiter::set_rate(policy == vulkan_wrapper::present_policy::power_saving ? POWER_SAVING_RATE : 0.0);
+                return;
+            }
+            // Cycle multisampling between off, 2, 4 and 8 samples (as far as the device allows) with the A key
+            if (key == GLFW_KEY_A) {
+                uint32_t samples = vulkan_wrapper::get_msaa_samples();
+                vulkan_wrapper::set_msaa_samples(samples >= vulkan_wrapper::get_max_msaa_samples() ? 1 : samples * 2);
+                return;
+            }
+            // Toggle dynamic resolution with the R key
+            if (key == GLFW_KEY_R) {
+                vulkan_wrapper::resolution_settings settings = vulkan_wrapper::get_resolution_settings();
+                settings.enabled = !settings.enabled;
+                vulkan_wrapper::set_resolution_settings(settings);
+                return;
+            }
+            // Toggle waiting for the frame before input is sampled with the L key
+            if (key == GLFW_KEY_L) {
+                vulkan_wrapper::set_latency_mode(!vulkan_wrapper::get_latency_mode());
+                return;
+            }
         }
         else if (action == GLFW_RELEASE) {
             chosen = false;
@@ -1,5 +1,6 @@
 #include <modules/directional_light.hxx>
 
+#include <vml/planar_shadow.hxx>
 #include <vml/transform.hxx>
 #include <render/render_manager.hxx>
 #include <cmath>
@@ -8,7 +9,7 @@ const float PI = 3.1415926535897932384f;
 
 namespace modules {
     /**
-     * direction light - Direction Light Constructor sets up the two planes where shadows are projected onto
+     * direction light - Direction Light Constructor sets up the two planes where shadows are projected onto, the light and the player
      * @param left - left bound -x
      * @param right - right bound +x
      * @param up - upper bound +y
@@ -16,58 +17,52 @@ namespace modules {
      * @param back - back bound -z
      * @param ld - light distance
      */
-    directional_light::directional_light(float left, float right, float up, float front, float back, float ld) : l(left), r(right), u(up), f(front), b(back), light_distance(ld), light_angle(0.0F) {
+    directional_light::directional_light(float left, float right, float up, float front, float back, float ld) : l(left), r(right), u(up), f(front), b(back), light_base(0.0F, -ld, -ld * 1.5F), light_angle(0.0F) {
         // Create the back plane by transforming (0, 0, 0), (1, 0, 0), (0, 1, 0) and (1, 1, 0) to (l, 0, b), (r, 0, b), (l, u, b) and (r, u, b) respectively
-        bw = vml::mat4(r - l, 0.0F, 0.0F, 0.0F, 0.0F, u, 0.0F, 0.0F, 0.0F, 0.0F, 1.0F, 0.0F, l, 0.0F, b, 1.0F);
+        add_surface(vml::mat4(r - l, 0.0F, 0.0F, 0.0F, 0.0F, u, 0.0F, 0.0F, 0.0F, 0.0F, 1.0F, 0.0F, l, 0.0F, b, 1.0F), vml::plane(vml::vec3(0.0F, 0.0F, 1.0F), vml::vec3(0.0F, 0.0F, b)));
         // Create the floor plane by transforming (0, 0, 0), (1, 0, 0), (0, 1, 0) and (1, 1, 0) to (l, 0, f), (r, 0, f), (l, 0, b) and (r, 0, b) respectively
-        fl = vml::mat4(r - l, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F, b - f, 0.0F, 0.0F, 1.0F, 0.0F, 0.0F, l, 0.0F, f, 1.0F);
+        add_surface(vml::mat4(r - l, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F, b - f, 0.0F, 0.0F, 1.0F, 0.0F, 0.0F, l, 0.0F, f, 1.0F), vml::plane(vml::vec3(0.0F, 1.0F, 0.0F), vml::vec3(0.0F, 0.0F, 0.0F)));
+        // The light direction and player are updated every frame
+        sun = world.create();
+        world.lights.add(sun, {vml::vec4(light_base, 0.0F)});
+        player = add_player();
+    }
+    /**
+     * directional_light - Direction Light Constructor loads the scene from a scene file, the bounds of the file give
+     * the room (its lowest y is the floor) and its first directional light is swung by the player
+     * @param file - loaded scene file
+     */
+    directional_light::directional_light(const scene::scene_file& file) : l(file.get_bounds_min()[0]), r(file.get_bounds_max()[0]), u(file.get_bounds_max()[1]),
+                                                                          f(file.get_bounds_max()[2]), b(file.get_bounds_min()[2]), light_base(0.0F, -1.0F, -1.5F), light_angle(0.0F) {
+        player = load_world(file);
+        sun = scene::NO_ENTITY;
+        for (uint32_t i = 0; i < world.lights.size() && sun == scene::NO_ENTITY; i++) {
+            if (world.lights[i].l[3] == 0.0F) {
+                sun = world.lights.owner(i);
+                light_base = vml::vec3(world.lights[i].l[0], world.lights[i].l[1], world.lights[i].l[2]);
+            }
+        }
+        if (sun == scene::NO_ENTITY) {
+            sun = world.create();
+            world.lights.add(sun, {vml::vec4(light_base, 0.0F)});
+        }
     }
     /**
      * render - Render function renders all components present in this module
      */
     void directional_light::render() {
-
         // Centre on the 'player'
         render::render_manager::set_view(vml::translate(vml::vec3(-player_pos[0], -player_pos[1], 0.0F)));
 
-        // Calculate the light direction from the light_angle and light_distance and send it to the shader
-        vml::vec3 light = vml::vec3(light_distance * (float)std::sin(light_angle * PI / 2.0F), -light_distance * (float)std::cos(light_angle * PI / 2.0F), -light_distance * 1.5F);
-        render::render_manager::set_light_dir(light);
-
-        // Render the back plane
-        render::render_manager::set_model(bw);
-        render::render_manager::draw_rect_2D();
-        // Render the floor plane
-        render::render_manager::set_model(fl);
-        render::render_manager::draw_rect_2D();
-
-        // Set player colour to red
-        static vml::mat4 player = vml::mat4::identity();
-        player[0][0] = 1.0F; player[1][1] = 0.25F; player[2][2] = 0.25F;
-        render::render_manager::set_colour_mult(player);
-        // Calculate the model matrix for the player given the position and render the player
-        pt = vml::mat4(0.5F, 0.0F, 0.0F, 0.0F, 0.0F, 0.5F, 0.0F, 0.0F, 0.0F, 0.0F, 1.0F, 0.0F, player_pos[0] - 0.25F, player_pos[1] - 0.25F, (b + f) / 2.0F, 1.0F);
-        render::render_manager::set_model(pt);
-        render::render_manager::draw_rect_2D();
-
-        // Calculate the projections of the light onto each surface
-        bwP = vml::directional_project_z(light, b + 0.0001F);
-        flP = vml::directional_project_y(light, 0.0001F);
-
-        // Set shadow colour to black with partial transparency ( this value can be changed to create a different feel )
-        static vml::mat4 shadow = vml::mat4::identity();
-        shadow[0][0] = shadow[1][1] = shadow[2][2] = 0.0F;
-        shadow[3][3] = 0.2F;
-        render::render_manager::set_colour_mult(shadow);
-        render::render_manager::set_is_shadow(true);
-
-        // Draw the shadow on the back plane
-        render::render_manager::set_model(bwP * pt);
-        render::render_manager::draw_rect_2D();
+        // Calculate the light direction by swinging the base direction about the z axis by the light_angle
+        float c = (float)std::cos(light_angle * PI / 2.0F), s = (float)std::sin(light_angle * PI / 2.0F);
+        vml::vec3 light = vml::vec3(light_base[0] * c - light_base[1] * s, light_base[0] * s + light_base[1] * c, light_base[2]);
+        world.lights.get(sun).l = vml::vec4(light, 0.0F);
+        // Place the player given the position
+        world.hierarchy.set_translation(player, vml::vec3(player_pos[0] - 0.25F, player_pos[1] - 0.25F, (b + f) / 2.0F));
 
-        // Draw the shadow on the floor plane
-        render::render_manager::set_model(flP * pt);
-        render::render_manager::draw_rect_2D();
+        // Draw the scene, a shadow map of the light would cover all of it
+        render_world(vml::vec3(l, 0.0F, b), vml::vec3(r, u, f), 0.2F);
     }
 
     /**
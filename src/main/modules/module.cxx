@@ -0,0 +1,90 @@
+#include <modules/module.hxx>
+
+#include <render/render_manager.hxx>
+
+#include <string>
+#include <vector>
+
+namespace modules {
+    /**
+     * add_surface - Add Surface function adds a static surface of the room to the module's scene, a rectangle which
+     * shadows are projected onto and which is drawn with the module's texture
+     * @param model - transforms the rectangle (0, 0, 0) - (1, 1, 0) onto the surface
+     * @param plane - plane of the surface, facing into the room
+     * @return - surface entity
+     */
+    scene::entity module::add_surface(const vml::mat4& model, const vml::vec4& plane) {
+        scene::entity e = world.create();
+        world.transforms.add(e, {model});
+        world.renderables.add(e, {render::render_manager::get_rect_2D(), texture, vml::mat4::identity(), true});
+        world.receivers.add(e, {plane});
+        return e;
+    }
+    /**
+     * add_player - Add Player function adds the player to the module's scene, a red half size rectangle casting shadows.
+     * It is placed by the hierarchy, the module sets its translation as it moves
+     * @return - player entity
+     */
+    scene::entity module::add_player() {
+        vml::mat4 red = vml::mat4::identity();
+        red[0][0] = 1.0F; red[1][1] = 0.25F; red[2][2] = 0.25F;
+        scene::entity e = world.create();
+        world.transforms.add(e);
+        world.hierarchy.add(e, scene::NO_ENTITY, vml::vec3(0.0F, 0.0F, 0.0F), vml::quaternion::identity(), vml::vec3(0.5F, 0.5F, 1.0F));
+        world.renderables.add(e, {render::render_manager::get_rect_2D(), 0, red, false});
+        world.casters.add(e, {vml::vec3(0.0F, 0.0F, 0.0F), vml::vec3(1.0F, 1.0F, 0.0F)});
+        return e;
+    }
+    /**
+     * load_world - Load World function adds every entity of a scene file to the module's scene, meshes are found by
+     * name (only rect_2D exists). The entity named player is the player, without one the default player is added
+     * @param file - loaded scene file
+     * @return - player entity
+     */
+    scene::entity module::load_world(const scene::scene_file& file) {
+        std::vector<scene::entity> entities = file.instantiate(world, [](const char* mesh) {
+            return std::string(mesh) == "rect_2D" ? render::render_manager::get_rect_2D() : scene::NO_MESH;
+        });
+        uint32_t player = file.find_entity("player");
+        if (player == scene::NO_ENTITY || !world.hierarchy.has(entities[player])) {
+            return add_player();
+        }
+        return entities[player];
+    }
+
+    /**
+     * render_world - Render World function draws the module's scene with its shadow technique: with shadow maps every
+     * light gets a shadow map covering the given bounds and no shadows are projected, otherwise the shadows of every
+     * caster are projected onto every surface (see render_system::draw_planar_shadows), reusing last frame's projections
+     * where nothing moved
+     * @param bounds_min - lowest corner of the region shadows can fall in
+     * @param bounds_max - highest corner of the region shadows can fall in
+     * @param shadow_alpha - opacity of the projected shadows (this value can be changed to create a different feel)
+     */
+    void module::render_world(const vml::vec3& bounds_min, const vml::vec3& bounds_max, float shadow_alpha) {
+        bool shadow_maps = technique == shadow_technique::shadow_map && render::render_manager::supports_shadow_maps();
+        render::render_manager::use_shadow_maps(shadow_maps);
+        render::render_manager::set_shadow_bounds(bounds_min, bounds_max);
+        scene::render_system::apply_lights(world);
+        world.hierarchy.update(world.transforms);
+
+        // The surfaces take the module's texture, which may be assigned after they were added
+        for (uint32_t i = 0; i < world.receivers.size(); i++) {
+            scene::entity e = world.receivers.owner(i);
+            if (world.renderables.has(e)) {
+                world.renderables.get(e).texture = texture;
+            }
+        }
+        scene::render_system::draw_renderables(world);
+        if (shadow_maps) {
+            return;
+        }
+
+        // Set shadow colour to black with partial transparency
+        vml::mat4 shadow = vml::mat4::identity();
+        shadow[0][0] = shadow[1][1] = shadow[2][2] = 0.0F;
+        shadow[3][3] = shadow_alpha;
+        bool stencil = technique == shadow_technique::stencil && render::render_manager::supports_stencil();
+        scene::render_system::draw_planar_shadows(world, shadows, shadow, stencil);
+    }
+}
@@ -1,6 +1,10 @@
 #include "platform/platform.hxx"
 
 #include <CoreServices/CoreServices.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace platform::files {
     const char FILE_SEPARATOR = '/';
@@ -16,4 +20,42 @@ namespace platform::files {
     }
     void create_folder(const std::string& folder) {
     }
-}
\ No newline at end of file
+    /**
+     * map_file - Map File function maps a whole file read only into memory, pages are read from the file as they are
+     * first touched rather than copied up front
+     * @param path - full path of the file
+     * @param size - set to the size of the file
+     * @return - start of the file in memory, nullptr if it could not be mapped (or is empty)
+     */
+    const void* map_file(const std::string& path, size_t& size) {
+        size = 0;
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return nullptr;
+        }
+        struct stat st = {};
+        void* data = MAP_FAILED;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        // The mapping keeps the file open
+        close(fd);
+        if (data == MAP_FAILED) {
+            return nullptr;
+        }
+        size = static_cast<size_t>(st.st_size);
+        return data;
+    }
+    // Unmaps a file mapped by map_file
+    void unmap_file(const void* data, size_t size) {
+        munmap(const_cast<void*>(data), size);
+    }
+}
+
+namespace platform::timing {
+    // Sleeps are already precise to well under a millisecond, nothing to change
+    void begin_precise_sleep() {
+    }
+    void end_precise_sleep() {
+    }
+}
@@ -1,6 +1,7 @@
 #include "platform/platform.hxx"
 
 #include "windows.h"
+#include "timeapi.h"
 
 namespace platform::files {
     const char FILE_SEPARATOR = '\\';
@@ -14,4 +15,50 @@ namespace platform::files {
     }
     void create_folder(const std::string &folder) {
     }
-}
\ No newline at end of file
+    /**
+     * map_file - Map File function maps a whole file read only into memory, pages are read from the file as they are
+     * first touched rather than copied up front
+     * @param path - full path of the file
+     * @param size - set to the size of the file
+     * @return - start of the file in memory, nullptr if it could not be mapped (or is empty)
+     */
+    const void* map_file(const std::string& path, size_t& size) {
+        size = 0;
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return nullptr;
+        }
+        LARGE_INTEGER file_size = {};
+        HANDLE mapping = nullptr;
+        if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0) {
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        }
+        // The view keeps the file and mapping open
+        CloseHandle(file);
+        if (!mapping) {
+            return nullptr;
+        }
+        const void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+        if (!data) {
+            return nullptr;
+        }
+        size = static_cast<size_t>(file_size.QuadPart);
+        return data;
+    }
+    // Unmaps a file mapped by map_file
+    void unmap_file(const void* data, size_t size) {
+        UnmapViewOfFile(data);
+    }
+}
+
+namespace platform::timing {
+    // Raise the system timer resolution to 1ms for sleeps, by default they are rounded up to the ~15.6ms timer tick
+    void begin_precise_sleep() {
+        timeBeginPeriod(1);
+    }
+    // Undo begin_precise_sleep
+    void end_precise_sleep() {
+        timeEndPeriod(1);
+    }
+}
@@ -0,0 +1,322 @@
+#include "render/mesh_manager.hxx"
+
+#include "render/mesh_optimiser.hxx"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+/**
+ * render::mesh_manager - Mesh Manager namespace is the registry of every mesh drawn, meshes are optimised for the
+ * vertex cache and vertex fetch as they are registered and packed into buffers shared by every mesh of the same vertex
+ * layout, so one bind of a layout's buffers serves any number of draws of different meshes
+ */
+namespace render::mesh_manager {
+    namespace {
+        // Shared buffers are at least this size (in bytes) and double whenever a mesh does not fit
+        const vk::DeviceSize MIN_BUFFER_SIZE = 1U << 16U;
+        // Most vertices a mesh may have to use 16 bit indices, indices are relative to the mesh's vertex offset
+        const size_t MAX_SHORT_VERTICES = 1U << 16U;
+
+        // A device local buffer along with its memory and size
+        struct device_buffer {
+            vk::Buffer buffer;
+            vk::DeviceMemory memory;
+            vk::DeviceSize capacity = 0;
+        };
+
+        // Every mesh of one layout, packed one after another into the vertex buffer and the index buffer (16 and 32 bit
+        // indices side by side, each run aligned to its index size). A copy of both is kept to refill a buffer which has
+        // to grow. A buffer grown during a frame is kept aside (next) until update, the frame may draw from the old one
+        struct pool {
+            vertex_layout layout;
+            std::vector<uint8_t> vertices;
+            std::vector<uint8_t> indices;
+            device_buffer vertex;
+            device_buffer index;
+            device_buffer next_vertex;
+            device_buffer next_index;
+        };
+
+        // Structure inside of an anonymous namespace to provide a 'private' storage
+        struct info {
+            // Mesh 0 is empty and never ready, the rest are indexed by mesh id. Pools are indexed by layout id
+            std::vector<mesh> meshes;
+            std::vector<pool> pools;
+            // Meshes registered during a frame, they are drawn once the next frame has acquired their upload
+            std::vector<uint32_t> pending;
+            // Buffers replaced since the last update, and those replaced before it which are destroyed at the next. The
+            // extra frame covers uploads into a buffer which was replaced within the same frame
+            std::vector<device_buffer> retired;
+            std::vector<device_buffer> retiring;
+        };
+        std::unique_ptr<info> info_p;
+
+        // Returns the Vulkan format the vertex shaders read the given format as
+        vk::Format get_vk_format(vertex_format format) {
+            switch (format) {
+                case vertex_format::float2:
+                    return vk::Format::eR32G32Sfloat;
+                case vertex_format::float3:
+                    return vk::Format::eR32G32B32Sfloat;
+                case vertex_format::snorm16x4:
+                    return vk::Format::eR16G16B16A16Snorm;
+                case vertex_format::unorm16x2:
+                    return vk::Format::eR16G16Unorm;
+                case vertex_format::half2:
+                    return vk::Format::eR16G16Sfloat;
+                default:
+                    return vk::Format::eR8G8B8A8Snorm;
+            }
+        }
+
+        // Swap in the buffer grown during a frame (if any), the replaced one is retired
+        void promote_buffer(device_buffer& current, device_buffer& next) {
+            if (next.buffer) {
+                if (current.buffer) {
+                    info_p->retired.push_back(current);
+                }
+                current = next;
+                next = device_buffer();
+            }
+        }
+        // Swap in every buffer grown during a frame and mark the meshes registered during it as ready
+        void promote() {
+            for (pool& p : info_p->pools) {
+                promote_buffer(p.vertex, p.next_vertex);
+                promote_buffer(p.index, p.next_index);
+            }
+            for (uint32_t id : info_p->pending) {
+                info_p->meshes[id].ready = true;
+            }
+            info_p->pending.clear();
+        }
+
+        /**
+         * write - Write function uploads the end of the given contents (from offset) into the newest of the two buffers,
+         * growing it first if the contents no longer fit, in which case the grown buffer is filled with all of them.
+         * During a frame the grown buffer goes into next, otherwise it replaces current straight away
+         * @param current - buffer drawn from
+         * @param next - buffer grown during this frame, if any
+         * @param contents - the pool's copy of the buffer
+         * @param offset - offset (in bytes) of the new contents
+         * @param usage - how the buffer is used (vertex or index)
+         * @param access - how the vertex input stage reads it
+         * @return - successful or not
+         */
+        bool write(device_buffer& current, device_buffer& next, const std::vector<uint8_t>& contents, vk::DeviceSize offset, vk::BufferUsageFlags usage, vk::AccessFlags access) {
+            device_buffer& target = next.buffer ? next : current;
+            if (contents.size() <= target.capacity) {
+                return vulkan_wrapper::upload_buffer(target.buffer, offset, contents.size() - offset, contents.data() + offset, vk::PipelineStageFlagBits::eVertexInput, access);
+            }
+            device_buffer grown;
+            grown.capacity = std::max({target.capacity * 2, static_cast<vk::DeviceSize>(contents.size()), MIN_BUFFER_SIZE});
+            if (!vulkan_wrapper::create_buffer(grown.buffer, grown.memory, grown.capacity, usage | vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eDeviceLocal)) {
+                return false;
+            }
+            if (!vulkan_wrapper::upload_buffer(grown.buffer, 0, contents.size(), contents.data(), vk::PipelineStageFlagBits::eVertexInput, access)) {
+                vulkan_wrapper::destroy_buffer(grown.buffer, grown.memory);
+                return false;
+            }
+            if (&target == &next || !vulkan_wrapper::in_frame()) {
+                if (target.buffer) {
+                    info_p->retired.push_back(target);
+                }
+                target = grown;
+            }
+            else {
+                next = grown;
+            }
+            return true;
+        }
+        // Destroy the given buffer straight away, only once the device is idle
+        void destroy(const device_buffer& b) {
+            if (b.buffer) {
+                vulkan_wrapper::destroy_buffer(b.buffer, b.memory);
+            }
+        }
+    }
+
+    /**
+     * init - Init function initialises the Mesh Manager, the shared buffers are created as meshes are registered
+     */
+    void init() {
+        info_p = std::make_unique<info>();
+        info_p->meshes.emplace_back();
+    }
+
+    // Register the given mesh in the most compact layout which suits it, see get_compact_layout and register_mesh
+    uint32_t register_mesh(const mesh_data& data) {
+        return register_mesh(data, get_compact_layout(data));
+    }
+
+    /**
+     * register_mesh - Register Mesh function optimises the given mesh (see mesh_optimiser) and packs it into the shared
+     * buffers of its layout, with 16 bit indices if it has few enough vertices. Positions in a normalised format are
+     * quantised against the mesh's bounds (see get_quantisation). A mesh registered during a frame can be drawn from the
+     * next frame, until then draws of it are skipped
+     * @param data - mesh to register, without indices its vertices are a triangle list
+     * @param layout - how the vertices are stored
+     * @return - mesh id, or 0 if the mesh is empty or could not be uploaded
+     */
+    uint32_t register_mesh(const mesh_data& data, const vertex_layout& layout) {
+        // Outside of a frame everything earlier has been uploaded before the next frame begins
+        bool framed = vulkan_wrapper::in_frame();
+        if (!framed) {
+            promote();
+        }
+        mesh_data optimised = data;
+        if (optimised.indices.empty()) {
+            optimised.indices.resize(optimised.positions.size());
+            std::iota(optimised.indices.begin(), optimised.indices.end(), 0U);
+        }
+        optimised.indices.resize(optimised.indices.size() / 3 * 3);
+        if (optimised.indices.empty() || *std::max_element(optimised.indices.begin(), optimised.indices.end()) >= optimised.positions.size()) {
+            return 0;
+        }
+        mesh_optimiser::optimise_vertex_cache(optimised.indices, static_cast<uint32_t>(optimised.positions.size()));
+        mesh_optimiser::optimise_vertex_fetch(optimised);
+
+        mesh m;
+        m.layout = get_layout(layout);
+        m.index_count = static_cast<uint32_t>(optimised.indices.size());
+        m.bounds_min = m.bounds_max = optimised.positions[0];
+        for (const vml::vec3& position : optimised.positions) {
+            for (int i = 0; i < 3; i++) {
+                m.bounds_min[i] = std::min(m.bounds_min[i], position[i]);
+                m.bounds_max[i] = std::max(m.bounds_max[i], position[i]);
+            }
+        }
+        // Quantised bounds are those of the stored positions, a uniform scale then a translation takes them back
+        const vertex_quantisation quantisation = get_quantisation(optimised, layout);
+        m.quantised = quantisation.scale != 1.0F || quantisation.offset.magnitude() > 0.0F;
+        if (m.quantised) {
+            m.bounds_min = (m.bounds_min - quantisation.offset) / quantisation.scale;
+            m.bounds_max = (m.bounds_max - quantisation.offset) / quantisation.scale;
+            const float q = quantisation.scale;
+            const vml::vec3& o = quantisation.offset;
+            m.dequantise = vml::mat4(q, 0.0F, 0.0F, 0.0F, 0.0F, q, 0.0F, 0.0F, 0.0F, 0.0F, q, 0.0F, o[0], o[1], o[2], 1.0F);
+        }
+
+        // Vertices go on the end of the layout's vertex buffer, indices on the end of its index buffer
+        pool& p = info_p->pools[m.layout];
+        const uint32_t stride = layout.get_stride();
+        const size_t vertex_offset = p.vertices.size();
+        m.vertex_offset = static_cast<int32_t>(vertex_offset / stride);
+        p.vertices.resize(vertex_offset + optimised.positions.size() * stride);
+        pack_vertices(optimised, layout, quantisation, p.vertices.data() + vertex_offset);
+
+        const bool short_indices = optimised.positions.size() <= MAX_SHORT_VERTICES;
+        const size_t index_size = short_indices ? sizeof(uint16_t) : sizeof(uint32_t);
+        const size_t old_index_end = p.indices.size();
+        const size_t index_offset = (old_index_end + index_size - 1) / index_size * index_size;
+        m.index_type = short_indices ? vk::IndexType::eUint16 : vk::IndexType::eUint32;
+        m.first_index = static_cast<uint32_t>(index_offset / index_size);
+        p.indices.resize(index_offset + optimised.indices.size() * index_size);
+        if (short_indices) {
+            auto* dst = reinterpret_cast<uint16_t*>(p.indices.data() + index_offset);
+            std::transform(optimised.indices.begin(), optimised.indices.end(), dst, [](uint32_t index) { return static_cast<uint16_t>(index); });
+        }
+        else {
+            memcpy(p.indices.data() + index_offset, optimised.indices.data(), optimised.indices.size() * index_size);
+        }
+
+        if (!write(p.vertex, p.next_vertex, p.vertices, vertex_offset, vk::BufferUsageFlagBits::eVertexBuffer, vk::AccessFlagBits::eVertexAttributeRead) ||
+            !write(p.index, p.next_index, p.indices, old_index_end, vk::BufferUsageFlagBits::eIndexBuffer, vk::AccessFlagBits::eIndexRead)) {
+            p.vertices.resize(vertex_offset);
+            p.indices.resize(old_index_end);
+            return 0;
+        }
+        m.ready = !framed;
+        info_p->meshes.push_back(m);
+        uint32_t id = static_cast<uint32_t>(info_p->meshes.size() - 1);
+        if (!m.ready) {
+            info_p->pending.push_back(id);
+        }
+        return id;
+    }
+
+    // Returns the given mesh, or the empty mesh 0 (never ready) if there is no such mesh
+    const mesh& get_mesh(uint32_t id) {
+        return info_p->meshes[id < info_p->meshes.size() ? id : 0];
+    }
+
+    /**
+     * update - Update function is called once a frame has recorded its draws, meshes registered and buffers grown
+     * during it are drawn from the next frame, which acquires their uploads first. Buffers replaced two updates ago
+     * are destroyed once the frames which may use them have finished
+     */
+    void update() {
+        for (const device_buffer& b : info_p->retiring) {
+            vulkan_wrapper::defer_destroy(b.buffer);
+            vulkan_wrapper::defer_destroy(b.memory);
+        }
+        info_p->retiring.swap(info_p->retired);
+        info_p->retired.clear();
+        promote();
+    }
+
+    /**
+     * get_layout - Get Layout function returns the id of the given layout, registering it the first time it is seen.
+     * Every mesh of a layout shares its buffers and pipelines drawing them need its vertex input (see get_vertex_input)
+     * @param layout - vertex layout
+     * @return - layout id
+     */
+    uint32_t get_layout(const vertex_layout& layout) {
+        for (uint32_t i = 0; i < info_p->pools.size(); i++) {
+            if (info_p->pools[i].layout == layout) {
+                return i;
+            }
+        }
+        info_p->pools.emplace_back();
+        info_p->pools.back().layout = layout;
+        return static_cast<uint32_t>(info_p->pools.size() - 1);
+    }
+    // Returns the vertex buffer shared by the meshes of the given layout
+    vk::Buffer get_vertex_buffer(uint32_t layout) {
+        return layout < info_p->pools.size() ? info_p->pools[layout].vertex.buffer : vk::Buffer();
+    }
+    // Returns the index buffer shared by the meshes of the given layout
+    vk::Buffer get_index_buffer(uint32_t layout) {
+        return layout < info_p->pools.size() ? info_p->pools[layout].index.buffer : vk::Buffer();
+    }
+    /**
+     * get_vertex_input - Get Vertex Input function describes the vertices of the given layout to a pipeline, one
+     * binding with an attribute per vertex_attribute at the location of the same number
+     * @param layout - layout id
+     * @param binding - returns the binding
+     * @param attributes - returns the attributes, must hold VERTEX_ATTRIBUTE_COUNT, position comes first
+     * @return - number of attributes
+     */
+    uint32_t get_vertex_input(uint32_t layout, vk::VertexInputBindingDescription& binding, vk::VertexInputAttributeDescription* attributes) {
+        const vertex_layout& l = info_p->pools[layout].layout;
+        binding = vk::VertexInputBindingDescription(0, l.get_stride(), vk::VertexInputRate::eVertex);
+        for (uint32_t i = 0; i < VERTEX_ATTRIBUTE_COUNT; i++) {
+            auto attribute = static_cast<vertex_attribute>(i);
+            attributes[i] = vk::VertexInputAttributeDescription(i, 0, get_vk_format(l.get_format(attribute)), l.get_offset(attribute));
+        }
+        return VERTEX_ATTRIBUTE_COUNT;
+    }
+
+    /**
+     * terminate - Terminate function is called when the application closes, after the device is idle, destroying every
+     * shared buffer
+     */
+    void terminate() {
+        for (const pool& p : info_p->pools) {
+            destroy(p.vertex);
+            destroy(p.index);
+            destroy(p.next_vertex);
+            destroy(p.next_index);
+        }
+        for (const device_buffer& b : info_p->retired) {
+            destroy(b);
+        }
+        for (const device_buffer& b : info_p->retiring) {
+            destroy(b);
+        }
+        info_p.reset(nullptr);
+    }
+}
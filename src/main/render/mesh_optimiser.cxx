@@ -0,0 +1,215 @@
+#include "render/mesh_optimiser.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <limits>
+#include <type_traits>
+
+/**
+ * render::mesh_optimiser - Mesh Optimiser namespace reorders meshes as they are imported so the GPU does less work
+ * drawing them: triangles are reordered so recently transformed vertices are reused from the post transform cache, then
+ * vertices are reordered into the order they are first used so fetching them walks memory forwards
+ */
+namespace render::mesh_optimiser {
+    namespace {
+        // Scoring of Tom Forsyth's linear speed vertex cache optimisation, vertices score higher the more recently they
+        // were used (the last triangle's a fixed amount, so it is not immediately repeated) and the fewer triangles
+        // they have left, so lone triangles are not left behind
+        const float CACHE_DECAY_POWER = 1.5F;
+        const float LAST_TRIANGLE_SCORE = 0.75F;
+        const float VALENCE_BOOST_SCALE = 2.0F;
+        const float VALENCE_BOOST_POWER = 0.5F;
+        const uint32_t NO_TRIANGLE = std::numeric_limits<uint32_t>::max();
+
+        // Returns the score of a vertex at the given cache position (-1 if not cached) with the given triangles left
+        float vertex_score(int32_t cache_position, uint32_t remaining) {
+            if (remaining == 0) {
+                return -1.0F;
+            }
+            float score = 0.0F;
+            if (cache_position >= 0) {
+                if (cache_position < 3) {
+                    score = LAST_TRIANGLE_SCORE;
+                }
+                else {
+                    float scale = 1.0F / static_cast<float>(VERTEX_CACHE_SIZE - 3);
+                    score = std::pow(1.0F - static_cast<float>(cache_position - 3) * scale, CACHE_DECAY_POWER);
+                }
+            }
+            return score + VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remaining), -VALENCE_BOOST_POWER);
+        }
+    }
+
+    /**
+     * optimise_vertex_cache - Optimise Vertex Cache function reorders the triangles of an indexed triangle list so they
+     * reuse the vertices the GPU has recently transformed, greedily adding the best scoring triangle around the
+     * simulated cache each time (see vertex_score). The vertices themselves are not moved
+     * @param indices - three indices per triangle, reordered in place
+     * @param vertex_count - number of vertices the indices refer to
+     */
+    void optimise_vertex_cache(std::vector<uint32_t>& indices, uint32_t vertex_count) {
+        const size_t triangle_count = indices.size() / 3;
+        if (triangle_count < 2) {
+            return;
+        }
+        // The triangles using each vertex as one list, those not yet added are kept at the front of each vertex's run
+        std::vector<uint32_t> remaining(vertex_count, 0);
+        for (size_t i = 0; i < triangle_count * 3; i++) {
+            remaining[indices[i]]++;
+        }
+        std::vector<uint32_t> first(vertex_count + 1, 0);
+        for (uint32_t v = 0; v < vertex_count; v++) {
+            first[v + 1] = first[v] + remaining[v];
+        }
+        std::vector<uint32_t> adjacency(first[vertex_count]);
+        std::vector<uint32_t> fill(first.begin(), first.end() - 1);
+        for (size_t t = 0; t < triangle_count; t++) {
+            for (size_t k = 0; k < 3; k++) {
+                adjacency[fill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+            }
+        }
+
+        std::vector<int32_t> cache_position(vertex_count, -1);
+        std::vector<float> score(vertex_count);
+        for (uint32_t v = 0; v < vertex_count; v++) {
+            score[v] = vertex_score(-1, remaining[v]);
+        }
+        auto triangle_score = [&](uint32_t t) { return score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]]; };
+
+        // Start from the best triangle of the whole mesh
+        uint32_t best = 0;
+        for (uint32_t t = 1; t < triangle_count; t++) {
+            if (triangle_score(t) > triangle_score(best)) {
+                best = t;
+            }
+        }
+        std::vector<bool> added(triangle_count, false);
+        std::vector<uint32_t> result;
+        result.reserve(triangle_count * 3);
+        std::vector<uint32_t> cache;
+        cache.reserve(VERTEX_CACHE_SIZE + 3);
+        std::vector<uint32_t> next;
+        next.reserve(VERTEX_CACHE_SIZE + 3);
+        size_t cursor = 0;
+        for (size_t count = 0; count < triangle_count; count++) {
+            // Nothing around the cache is left, carry on from the first triangle not yet added
+            if (best == NO_TRIANGLE) {
+                while (added[cursor]) {
+                    cursor++;
+                }
+                best = static_cast<uint32_t>(cursor);
+            }
+            added[best] = true;
+            const uint32_t* triangle = &indices[best * 3];
+            result.insert(result.end(), triangle, triangle + 3);
+
+            // Take the triangle off its vertices' lists
+            for (size_t k = 0; k < 3; k++) {
+                uint32_t v = triangle[k];
+                uint32_t* list = &adjacency[first[v]];
+                uint32_t* found = std::find(list, list + remaining[v], best);
+                std::swap(*found, list[remaining[v] - 1]);
+                remaining[v]--;
+            }
+
+            // Its vertices move to the front of the cache, pushing the oldest out of the back
+            next.assign(triangle, triangle + 3);
+            for (uint32_t v : cache) {
+                if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+                    next.push_back(v);
+                }
+            }
+            for (size_t i = VERTEX_CACHE_SIZE; i < next.size(); i++) {
+                cache_position[next[i]] = -1;
+                score[next[i]] = vertex_score(-1, remaining[next[i]]);
+            }
+            cache.assign(next.begin(), next.begin() + std::min(next.size(), static_cast<size_t>(VERTEX_CACHE_SIZE)));
+            for (size_t i = 0; i < cache.size(); i++) {
+                cache_position[cache[i]] = static_cast<int32_t>(i);
+                score[cache[i]] = vertex_score(static_cast<int32_t>(i), remaining[cache[i]]);
+            }
+
+            // The next triangle is the best one left around the cache
+            best = NO_TRIANGLE;
+            float best_score = -1.0F;
+            for (uint32_t v : cache) {
+                for (uint32_t j = 0; j < remaining[v]; j++) {
+                    uint32_t t = adjacency[first[v] + j];
+                    float s = triangle_score(t);
+                    if (s > best_score) {
+                        best = t;
+                        best_score = s;
+                    }
+                }
+            }
+        }
+        std::copy(result.begin(), result.end(), indices.begin());
+    }
+
+    /**
+     * optimise_vertex_fetch - Optimise Vertex Fetch function reorders the vertices of an indexed mesh into the order the
+     * indices first use them, so drawing reads the vertex buffer forwards. Vertices no triangle uses are dropped
+     * @param data - mesh to reorder in place, normals and uvs must be empty or have one element per position
+     */
+    void optimise_vertex_fetch(mesh_data& data) {
+        if (data.indices.empty()) {
+            return;
+        }
+        const uint32_t unused = std::numeric_limits<uint32_t>::max();
+        std::vector<uint32_t> remap(data.positions.size(), unused);
+        uint32_t vertex_count = 0;
+        for (uint32_t& index : data.indices) {
+            if (remap[index] == unused) {
+                remap[index] = vertex_count++;
+            }
+            index = remap[index];
+        }
+        auto reorder = [&](auto& attributes) {
+            if (attributes.size() != remap.size()) {
+                return;
+            }
+            std::remove_reference_t<decltype(attributes)> reordered(vertex_count);
+            for (size_t v = 0; v < remap.size(); v++) {
+                if (remap[v] != unused) {
+                    reordered[remap[v]] = attributes[v];
+                }
+            }
+            attributes.swap(reordered);
+        };
+        reorder(data.uvs);
+        reorder(data.normals);
+        reorder(data.positions);
+    }
+
+    /**
+     * get_cache_miss_ratio - Get Cache Miss Ratio function simulates a first in first out post transform cache over the
+     * given triangles and returns the number of vertices transformed per triangle, from 3 (no reuse) down to about 0.5
+     * for a regular grid
+     * @param indices - three indices per triangle
+     * @param vertex_count - number of vertices the indices refer to
+     * @param cache_size - number of vertices the cache holds
+     * @return - transformed vertices per triangle
+     */
+    float get_cache_miss_ratio(const std::vector<uint32_t>& indices, uint32_t vertex_count, uint32_t cache_size) {
+        if (indices.size() < 3) {
+            return 0.0F;
+        }
+        std::vector<bool> cached(vertex_count, false);
+        std::deque<uint32_t> fifo;
+        size_t misses = 0;
+        for (uint32_t index : indices) {
+            if (cached[index]) {
+                continue;
+            }
+            misses++;
+            cached[index] = true;
+            fifo.push_back(index);
+            if (fifo.size() > cache_size) {
+                cached[fifo.front()] = false;
+                fifo.pop_front();
+            }
+        }
+        return static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+    }
+}
@@ -1,44 +1,612 @@
 #include "render/render_manager.hxx"
 
 #include "vulkan_wrapper.hxx"
+#include "render/draw_data.hxx"
+#include "render/mesh_manager.hxx"
 #include "render/push_constants.hxx"
+#include "render/texture_manager.hxx"
 #include "render/vertex.hxx"
 #include "resource/resource_manager.hxx"
+#include "vml/frustum.hxx"
+#include "vml/transform.hxx"
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
 #include <map>
 
 namespace render::render_manager {
         namespace {
-            // Simple structure to hold details and a render pipeline
+            // Every shadow map is a layer of one depth target, a directional light uses one layer and a point light
+            // six (one per cube face: +x, -x, +y, -y, +z, -z)
+            const uint32_t SHADOW_MAP_SIZE = 1024;
+            const uint32_t SHADOW_MAP_LAYERS = 32;
+            // Largest storage buffer offset alignment a device may require, used to pack the static buffer
+            const vk::DeviceSize STATIC_ALIGNMENT = 256;
+
+            // Simple structure to hold details and a render pipeline, graphics pipelines also hold a variant of pl for
+            // each shadow draw_pass (indexed by draw_pass - 1), the stencil variants are null without a stencil buffer
             struct pipeline {
                 vk::PipelineLayout layout;
                 vk::Pipeline pl;
+                std::array<vk::Pipeline, 3> shadow_pls;
+            };
+
+            // The shared vertex and index buffers of one vertex layout (see mesh_manager) as bound for a run of draws
+            struct geometry {
+                vk::Buffer vertex_buffer;
+                vk::Buffer index_buffer;
+                vk::IndexType index_type = vk::IndexType::eUint16;
+
+                bool operator==(const geometry& other) const {
+                    return vertex_buffer == other.vertex_buffer && index_buffer == other.index_buffer && index_type == other.index_type;
+                }
+                bool operator!=(const geometry& other) const {
+                    return !(*this == other);
+                }
+            };
+
+            // A run of draws which share a pipeline, draw pass, geometry and push constants, submitted with one indirect
+            // call
+            struct batch {
+                pipeline* pl;
+                vk::Pipeline pass_pl;
+                geometry geom;
+                push_constants pc;
+                uint32_t first_command;
+                uint32_t command_count;
+            };
+
+            // A run of shadow casting draws which share a geometry (so the shadow pipeline of its layout), drawn into
+            // every shadow map layer
+            struct shadow_batch {
+                pipeline* pl;
+                geometry geom;
+                uint32_t first_command;
+                uint32_t command_count;
+            };
+
+            // The static draws as last recorded into a frame's cached command buffer, along with the buffer (draws, commands,
+            // lights then shadow views) and descriptor set they use. Rebuilt whenever the static draws of the frame being
+            // recorded differ, each frame has its own so one is never rebuilt while the GPU may still be using it
+            struct static_cache {
+                vulkan_wrapper::cached_commands cached;
+                vk::Buffer buffer;
+                vk::DeviceMemory memory;
+                vk::DeviceSize capacity = 0;
+                vk::DescriptorSet set;
+                uint32_t version = 0;
+                uint32_t texture_version = 0;
+                std::vector<draw_data> draws;
+                std::vector<vk::DrawIndexedIndirectCommand> commands;
+                std::vector<batch> batches;
+                std::vector<vml::vec4> lights;
+                std::vector<vml::mat4> shadow_views;
+            };
+
+            // Per frame in flight resources so that a frame still being rendered is never overwritten. The draw data,
+            // commands, lights and shadow views are written into the frame's region of the ring buffer
+            // each frame, culled and counts are only written by the cull compute shader so stay in device local memory.
+            // Both are shared with the async compute queue. The cameras stay in one persistently mapped buffer, rewritten
+            // each frame, so the static cache reads the current cameras without being recorded again
+            struct frame_resources {
+                vulkan_wrapper::ring_allocation draws;
+                vulkan_wrapper::ring_allocation commands;
+                vulkan_wrapper::ring_allocation lights;
+                vulkan_wrapper::ring_allocation shadow_views;
+                vk::Buffer culled;
+                vk::DeviceMemory culled_memory;
+                uint32_t command_capacity = 0;
+                vk::Buffer counts;
+                vk::DeviceMemory counts_memory;
+                uint32_t count_capacity = 0;
+                vk::Buffer cameras;
+                vk::DeviceMemory cameras_memory;
+                void* cameras_data = nullptr;
+                uint32_t camera_capacity = 0;
+                vk::DescriptorSet set;
+                vk::DescriptorSet cull_set;
+                vk::DescriptorSet texture_set;
+                uint32_t texture_version = 0;
+                static_cache statics;
             };
 
             // Structure inside of an anonymous namespace to provide a 'private' storage
             struct info {
-                // Storage of all pipelines in maps for easy swapping
+                // Storage of all pipelines in maps for easy swapping, a pipeline is created for each vertex layout it draws
+                // (keyed by pipeline id then layout id). Layouts drawn so far are loaded with the rest, new ones on first use
                 std::map<std::string, uint32_t> name_id_map;
-                std::map<uint32_t, pipeline> id_pipeline_map;
+                std::map<std::pair<uint32_t, uint32_t>, pipeline> id_pipeline_map;
+                std::vector<uint32_t> layouts;
                 uint32_t next_id = 1;
                 bool loaded = false;
+                // Version of the main render pass the pipelines were created for
+                uint32_t render_pass_version = 0;
 
-                vk::Buffer rect_2D;
-                vk::DeviceMemory rect_2D_memory;
+                uint32_t rect_2D = 0;
                 vk::DeviceSize* offsets = nullptr;
 
+                vk::DescriptorSetLayout draw_set_layout;
+                vk::DescriptorSetLayout cull_set_layout;
+                vk::DescriptorPool descriptor_pool;
+                std::vector<frame_resources> frames;
+
+                // Textures are set 1 of every graphics pipeline, an array of texture_manager::get_capacity samplers with
+                // one set per frame in flight bound once per frame. With descriptor indexing the array is only partly
+                // written and may be updated while a frame's cached commands have it bound
+                vk::DescriptorSetLayout texture_set_layout;
+                vk::DescriptorPool texture_pool;
+                std::vector<uint32_t> texture_slots;
+                std::vector<vk::DescriptorImageInfo> texture_infos;
+
+                // Frustum culling, the GPU path needs the cull compute pipeline and draw_indirect_count
+                cull_mode mode = cull_mode::gpu;
+                pipeline cull_pl;
+                bool cull_loaded = false;
+                std::vector<vml::vec4> cull_spheres;
+                std::vector<uint8_t> cull_visible;
+
+                // Draws recorded this frame, waiting for submit
+                std::vector<draw_data> draws;
+                std::vector<vk::DrawIndexedIndirectCommand> commands;
+                std::vector<batch> batches;
+                std::vector<vml::vec4> lights;
+                std::vector<camera_data> cameras;
+                bool batch_dirty = true;
+
+                // Static draws recorded this frame, kept apart from the rest so they can be replayed from a cache. The
+                // version changes whenever the pipelines are unloaded, invalidating every cache
+                std::vector<draw_data> static_draws;
+                std::vector<vk::DrawIndexedIndirectCommand> static_commands;
+                std::vector<batch> static_batches;
+                bool current_static = false;
+                bool batch_static = false;
+                uint32_t pipeline_version = 1;
+
+                // Shadow maps, each layer is rendered from its view (projection * view) with the shadow pipeline
+                vulkan_wrapper::depth_target shadow_target;
+                vk::Sampler shadow_sampler;
+                bool shadow_target_created = false;
+                // Without the shadow maps a single 1x1 layer takes their place, as every fragment shader reads the binding
+                bool shadow_target_placeholder = false;
+                bool shadow_layout_ready = false;
+                std::map<uint32_t, pipeline> shadow_pls;
+                bool shadow_loaded = false;
+                bool shadow_maps = false;
+                bool current_caster = false;
+                vml::vec3 shadow_bounds_min = vml::vec3(-1.0F, -1.0F, -1.0F);
+                vml::vec3 shadow_bounds_max = vml::vec3(1.0F, 1.0F, 1.0F);
+                std::vector<vml::mat4> shadow_views;
+                std::vector<vk::DrawIndexedIndirectCommand> shadow_commands;
+                std::vector<shadow_batch> shadow_batches;
+
                 push_constants current_pc;
+                // Camera of the following batches, added to the frame's cameras by the next batch once it changes
+                camera_data current_camera;
+                bool camera_dirty = true;
+                draw_data current_draw;
+                uint32_t current_id = 0;
+                uint32_t current_layout = 0;
                 pipeline* current_pl = nullptr;
+                draw_pass current_pass = draw_pass::normal;
+                geometry current_geom;
             };
             std::unique_ptr<info> info_p;
 
+            // Point the frame's descriptor sets at this frame's ring allocations and its current buffers, the sets are only
+            // rewritten once the frame's previous use has finished on the GPU
+            void write_frame_descriptors(const frame_resources& frame) {
+                vk::DescriptorBufferInfo draws_info = {frame.draws.buffer, frame.draws.offset, frame.draws.size};
+                vk::DescriptorBufferInfo commands_info = {frame.commands.buffer, frame.commands.offset, frame.commands.size};
+                vk::DescriptorBufferInfo culled_info = {frame.culled, 0, VK_WHOLE_SIZE};
+                vk::DescriptorBufferInfo counts_info = {frame.counts, 0, VK_WHOLE_SIZE};
+                vk::DescriptorBufferInfo lights_info = {frame.lights.buffer, frame.lights.offset, frame.lights.size};
+                vk::DescriptorBufferInfo shadow_views_info = {frame.shadow_views.buffer, frame.shadow_views.offset, frame.shadow_views.size};
+                std::array<vk::WriteDescriptorSet, 7> writes = {
+                        vk::WriteDescriptorSet(frame.set, 0, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &draws_info, nullptr),
+                        vk::WriteDescriptorSet(frame.set, 1, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &lights_info, nullptr),
+                        vk::WriteDescriptorSet(frame.set, 3, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &shadow_views_info, nullptr),
+                        vk::WriteDescriptorSet(frame.cull_set, 0, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &draws_info, nullptr),
+                        vk::WriteDescriptorSet(frame.cull_set, 1, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &commands_info, nullptr),
+                        vk::WriteDescriptorSet(frame.cull_set, 2, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &culled_info, nullptr),
+                        vk::WriteDescriptorSet(frame.cull_set, 3, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &counts_info, nullptr)};
+                vulkan_wrapper::update_descriptor_sets(static_cast<uint32_t>(writes.size()), writes.data());
+            }
+            // Rewrite the slots of the frame's texture array which have changed image since the frame was last recorded,
+            // each run of neighbouring slots is written at once
+            void write_frame_textures(frame_resources& frame) {
+                uint32_t version = texture_manager::get_version();
+                if (frame.texture_version == version) {
+                    return;
+                }
+                uint32_t count = texture_manager::get_descriptors(frame.texture_version, info_p->texture_slots.data(), info_p->texture_infos.data());
+                std::vector<vk::WriteDescriptorSet> writes;
+                for (uint32_t i = 0; i < count; i++) {
+                    if (!writes.empty() && writes.back().dstArrayElement + writes.back().descriptorCount == info_p->texture_slots[i]) {
+                        writes.back().descriptorCount++;
+                    }
+                    else {
+                        writes.emplace_back(frame.texture_set, 0, info_p->texture_slots[i], 1, vk::DescriptorType::eCombinedImageSampler, &info_p->texture_infos[i], nullptr, nullptr);
+                    }
+                }
+                if (!writes.empty()) {
+                    vulkan_wrapper::update_descriptor_sets(static_cast<uint32_t>(writes.size()), writes.data());
+                }
+                frame.texture_version = version;
+            }
+
+            /**
+             * reserve_frame - Reserve Frame function makes sure the given frame's device local buffers can hold the
+             * requested number of commands and batches, growing them (doubling) if needed. Only called for the frame being
+             * recorded, whose previous use the GPU has already finished
+             * @param frame - frame resources to grow
+             * @param command_count - number of indirect commands needed
+             * @param batch_count - number of batches (draw counts) needed
+             * @return - successful or not
+             */
+            bool reserve_frame(frame_resources& frame, uint32_t command_count, uint32_t batch_count) {
+                if (command_count > frame.command_capacity) {
+                    uint32_t capacity = std::max(frame.command_capacity * 2, command_count);
+                    if (frame.command_capacity > 0) {
+                        vulkan_wrapper::destroy_buffer(frame.culled, frame.culled_memory);
+                        frame.command_capacity = 0;
+                    }
+                    if (!vulkan_wrapper::create_shared_buffer(frame.culled, frame.culled_memory, sizeof(vk::DrawIndexedIndirectCommand) * capacity, vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eStorageBuffer,
+                                                       vk::MemoryPropertyFlagBits::eDeviceLocal)) {
+                        return false;
+                    }
+                    frame.command_capacity = capacity;
+                }
+                if (batch_count > frame.count_capacity) {
+                    uint32_t capacity = std::max(frame.count_capacity * 2, batch_count);
+                    if (frame.count_capacity > 0) {
+                        vulkan_wrapper::destroy_buffer(frame.counts, frame.counts_memory);
+                        frame.count_capacity = 0;
+                    }
+                    if (!vulkan_wrapper::create_shared_buffer(frame.counts, frame.counts_memory, sizeof(uint32_t) * capacity, vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eStorageBuffer,
+                                                       vk::MemoryPropertyFlagBits::eDeviceLocal)) {
+                        return false;
+                    }
+                    frame.count_capacity = capacity;
+                }
+                return true;
+            }
+            /**
+             * reserve_cameras - Reserve Cameras function makes sure the given frame's camera buffer can hold the requested
+             * number of cameras, growing it (doubling) if needed, mapping it for good and pointing the frame's draw sets at the
+             * new buffer. As that rewrites a set bound by the static cache, the cache is recorded again. Only called for the
+             * frame being recorded, whose previous use the GPU has already finished
+             * @param frame - frame resources to grow
+             * @param camera_count - number of cameras needed
+             * @return - successful or not
+             */
+            bool reserve_cameras(frame_resources& frame, uint32_t camera_count) {
+                if (camera_count <= frame.camera_capacity) {
+                    return true;
+                }
+                uint32_t capacity = std::max(frame.camera_capacity * 2, camera_count);
+                if (frame.camera_capacity > 0) {
+                    vulkan_wrapper::unmap_memory(frame.cameras_memory);
+                    vulkan_wrapper::destroy_buffer(frame.cameras, frame.cameras_memory);
+                    frame.camera_capacity = 0;
+                }
+                if (!vulkan_wrapper::create_buffer(frame.cameras, frame.cameras_memory, sizeof(camera_data) * capacity, vk::BufferUsageFlagBits::eStorageBuffer,
+                                                   vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent)) {
+                    return false;
+                }
+                frame.cameras_data = vulkan_wrapper::map_memory(frame.cameras_memory);
+                frame.camera_capacity = capacity;
+                vk::DescriptorBufferInfo cameras_info = {frame.cameras, 0, VK_WHOLE_SIZE};
+                std::array<vk::WriteDescriptorSet, 2> writes = {
+                        vk::WriteDescriptorSet(frame.set, 4, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &cameras_info, nullptr),
+                        vk::WriteDescriptorSet(frame.statics.set, 4, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &cameras_info, nullptr)};
+                vulkan_wrapper::update_descriptor_sets(static_cast<uint32_t>(writes.size()), writes.data());
+                frame.statics.version = 0;
+                return true;
+            }
+            /**
+             * upload_frame - Upload Frame function copies this frame's draw data, commands (main then shadow), lights and
+             * shadow views into the ring buffer and points the frame's descriptor sets at them. Lights and shadow views
+             * always get at least one element as the descriptors cannot be empty.
+             * The whole frame is reserved first so a ring which is too small grows now instead of the frame being dropped
+             * @param frame - frame being recorded
+             * @param shadow_command_count - number of shadow commands to store after the main commands
+             * @return - successful or not, fails only when the ring cannot grow
+             */
+            bool upload_frame(frame_resources& frame, uint32_t shadow_command_count) {
+                vk::DeviceSize command_size = sizeof(vk::DrawIndexedIndirectCommand) * info_p->commands.size();
+                std::array<vk::DeviceSize, 4> sizes = {sizeof(draw_data) * info_p->draws.size(),
+                                                       command_size + sizeof(vk::DrawIndexedIndirectCommand) * shadow_command_count,
+                                                       sizeof(vml::vec4) * std::max(info_p->lights.size(), static_cast<size_t>(1)),
+                                                       sizeof(vml::mat4) * std::max(info_p->shadow_views.size(), static_cast<size_t>(1))};
+                if (!vulkan_wrapper::ring_reserve(static_cast<uint32_t>(sizes.size()), sizes.data()) ||
+                    !vulkan_wrapper::ring_upload(info_p->draws.data(), sizes[0], frame.draws) ||
+                    !vulkan_wrapper::ring_allocate(sizes[1], 0, frame.commands) ||
+                    !vulkan_wrapper::ring_allocate(sizes[2], 0, frame.lights) ||
+                    !vulkan_wrapper::ring_allocate(sizes[3], 0, frame.shadow_views)) {
+                    return false;
+                }
+                auto* commands = static_cast<uint8_t*>(frame.commands.data);
+                memcpy(commands, info_p->commands.data(), command_size);
+                memcpy(commands + command_size, info_p->shadow_commands.data(), sizeof(vk::DrawIndexedIndirectCommand) * shadow_command_count);
+                memcpy(frame.lights.data, info_p->lights.data(), sizeof(vml::vec4) * info_p->lights.size());
+                memcpy(frame.shadow_views.data, info_p->shadow_views.data(), sizeof(vml::mat4) * info_p->shadow_views.size());
+                write_frame_descriptors(frame);
+                return true;
+            }
+            // Release all of the buffers owned by the given frame
+            void destroy_frame(frame_resources& frame) {
+                vulkan_wrapper::free_cached_commands(frame.statics.cached);
+                if (frame.statics.capacity > 0) {
+                    vulkan_wrapper::destroy_buffer(frame.statics.buffer, frame.statics.memory);
+                    frame.statics.capacity = 0;
+                }
+                if (frame.command_capacity > 0) {
+                    vulkan_wrapper::destroy_buffer(frame.culled, frame.culled_memory);
+                }
+                if (frame.count_capacity > 0) {
+                    vulkan_wrapper::destroy_buffer(frame.counts, frame.counts_memory);
+                }
+                if (frame.camera_capacity > 0) {
+                    vulkan_wrapper::unmap_memory(frame.cameras_memory);
+                    vulkan_wrapper::destroy_buffer(frame.cameras, frame.cameras_memory);
+                }
+                frame.command_capacity = frame.count_capacity = frame.camera_capacity = 0;
+            }
+
+            // Bind the vertex and index buffers of the given geometry
+            void bind_geometry(const geometry& geom) {
+                vulkan_wrapper::bind_vertex_buffers(1, &geom.vertex_buffer, info_p->offsets);
+                vulkan_wrapper::bind_index_buffer(geom.index_buffer, 0, geom.index_type);
+            }
+
+            // Returns whether the two lists hold exactly the same (plain) values
+            template <typename T>
+            bool same_data(const std::vector<T>& a, const std::vector<T>& b) {
+                return a.size() == b.size() && (a.empty() || memcmp(a.data(), b.data(), sizeof(T) * a.size()) == 0);
+            }
+            // Returns whether the two lists of batches would record exactly the same commands
+            bool same_batches(const std::vector<batch>& a, const std::vector<batch>& b) {
+                if (a.size() != b.size()) {
+                    return false;
+                }
+                for (size_t i = 0; i < a.size(); i++) {
+                    if (a[i].pl != b[i].pl || a[i].pass_pl != b[i].pass_pl || a[i].geom != b[i].geom || a[i].first_command != b[i].first_command ||
+                        a[i].command_count != b[i].command_count || memcmp(&a[i].pc, &b[i].pc, sizeof(push_constants)) != 0) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            /**
+             * record_static - Record Static function makes sure the frame's static cache holds this frame's static draws,
+             * if anything differs from what was last recorded (draws, batches, lights, shadow views or pipelines) the buffer
+             * is rewritten and the cached command buffer recorded again. Static draws are never culled and read their
+             * camera from the frame's camera buffer, so a moving camera does not invalidate the cache. Streamed textures
+             * only invalidate it without descriptor indexing, as the texture set can then not be updated once bound.
+             * Called before the render pass of the frame whose cache it is
+             * @param frame - frame being recorded
+             * @return - whether there is a valid cache to replay
+             */
+            bool record_static(frame_resources& frame) {
+                static_cache& cache = frame.statics;
+                if (info_p->static_batches.empty()) {
+                    return false;
+                }
+                if (vulkan_wrapper::cached_commands_valid(cache.cached) && cache.version == info_p->pipeline_version &&
+                    (vulkan_wrapper::supports_descriptor_indexing() || cache.texture_version == frame.texture_version) && same_batches(cache.batches, info_p->static_batches) &&
+                    same_data(cache.draws, info_p->static_draws) && same_data(cache.commands, info_p->static_commands) && same_data(cache.lights, info_p->lights) &&
+                    same_data(cache.shadow_views, info_p->shadow_views)) {
+                    return true;
+                }
+
+                // Lights and shadow views always get at least one element as the descriptors cannot be empty
+                auto align = [](vk::DeviceSize size) { return (size + STATIC_ALIGNMENT - 1) / STATIC_ALIGNMENT * STATIC_ALIGNMENT; };
+                vk::DeviceSize draws_size = sizeof(draw_data) * info_p->static_draws.size();
+                vk::DeviceSize commands_size = sizeof(vk::DrawIndexedIndirectCommand) * info_p->static_commands.size();
+                vk::DeviceSize lights_size = sizeof(vml::vec4) * std::max(info_p->lights.size(), static_cast<size_t>(1));
+                vk::DeviceSize shadow_views_size = sizeof(vml::mat4) * std::max(info_p->shadow_views.size(), static_cast<size_t>(1));
+                vk::DeviceSize commands_offset = align(draws_size);
+                vk::DeviceSize lights_offset = commands_offset + align(commands_size);
+                vk::DeviceSize shadow_views_offset = lights_offset + align(lights_size);
+                vk::DeviceSize size = shadow_views_offset + shadow_views_size;
+                if (size > cache.capacity) {
+                    vk::DeviceSize capacity = std::max(cache.capacity * 2, size);
+                    if (cache.capacity > 0) {
+                        vulkan_wrapper::destroy_buffer(cache.buffer, cache.memory);
+                        cache.capacity = 0;
+                    }
+                    if (!vulkan_wrapper::create_buffer(cache.buffer, cache.memory, capacity, vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eStorageBuffer,
+                                                       vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent)) {
+                        return false;
+                    }
+                    cache.capacity = capacity;
+                }
+                vulkan_wrapper::map_buffer(cache.memory, 0, draws_size, info_p->static_draws.data());
+                vulkan_wrapper::map_buffer(cache.memory, commands_offset, commands_size, info_p->static_commands.data());
+                if (!info_p->lights.empty()) {
+                    vulkan_wrapper::map_buffer(cache.memory, lights_offset, sizeof(vml::vec4) * info_p->lights.size(), info_p->lights.data());
+                }
+                if (!info_p->shadow_views.empty()) {
+                    vulkan_wrapper::map_buffer(cache.memory, shadow_views_offset, sizeof(vml::mat4) * info_p->shadow_views.size(), info_p->shadow_views.data());
+                }
+                vk::DescriptorBufferInfo draws_info = {cache.buffer, 0, draws_size};
+                vk::DescriptorBufferInfo lights_info = {cache.buffer, lights_offset, lights_size};
+                vk::DescriptorBufferInfo shadow_views_info = {cache.buffer, shadow_views_offset, shadow_views_size};
+                std::array<vk::WriteDescriptorSet, 3> writes = {
+                        vk::WriteDescriptorSet(cache.set, 0, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &draws_info, nullptr),
+                        vk::WriteDescriptorSet(cache.set, 1, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &lights_info, nullptr),
+                        vk::WriteDescriptorSet(cache.set, 3, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &shadow_views_info, nullptr)};
+                vulkan_wrapper::update_descriptor_sets(static_cast<uint32_t>(writes.size()), writes.data());
+
+                // Every graphics pipeline layout is compatible, so the sets are bound once for the whole cache
+                std::array<vk::DescriptorSet, 2> sets = {cache.set, frame.texture_set};
+                vulkan_wrapper::begin_cached_commands(cache.cached);
+                vulkan_wrapper::bind_descriptor_sets(info_p->static_batches.front().pl->layout, 0, static_cast<uint32_t>(sets.size()), sets.data());
+                for (const batch& b : info_p->static_batches) {
+                    vulkan_wrapper::bind_pipeline(b.pass_pl);
+                    bind_geometry(b.geom);
+                    vulkan_wrapper::push_constants(b.pl->layout, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0, sizeof(push_constants), &b.pc);
+                    vulkan_wrapper::draw_indexed_indirect(cache.buffer, commands_offset + sizeof(vk::DrawIndexedIndirectCommand) * b.first_command, b.command_count, sizeof(vk::DrawIndexedIndirectCommand));
+                }
+                vulkan_wrapper::end_cached_commands(cache.cached);
+
+                cache.version = info_p->pipeline_version;
+                cache.texture_version = frame.texture_version;
+                cache.draws = info_p->static_draws;
+                cache.commands = info_p->static_commands;
+                cache.batches = info_p->static_batches;
+                cache.lights = info_p->lights;
+                cache.shadow_views = info_p->shadow_views;
+                return vulkan_wrapper::cached_commands_valid(cache.cached);
+            }
+
             /**
-             * load_pipeline - Load Pipeline function loads the give pipeline from the binary files
+             * cull_on_cpu - Cull On CPU function removes every command whose bounding sphere is outside the frustum of its
+             * batch, the surviving commands keep their order so blending and depth offsets are unaffected. This is the
+             * fallback when the GPU cull pass is unavailable and does the same test as cull.cs.glsl
+             */
+            void cull_on_cpu() {
+                uint32_t write = 0;
+                for (batch& b : info_p->batches) {
+                    const camera_data& camera = info_p->cameras[b.pc.camera];
+                    vml::frustum f = vml::extract_frustum(camera.p * camera.v);
+                    info_p->cull_spheres.resize(b.command_count);
+                    info_p->cull_visible.resize(b.command_count);
+                    for (uint32_t i = 0; i < b.command_count; i++) {
+                        info_p->cull_spheres[i] = info_p->draws[info_p->commands[b.first_command + i].firstInstance].bounds;
+                    }
+                    vml::intersects_spheres(f, info_p->cull_spheres.data(), b.command_count, info_p->cull_visible.data());
+
+                    uint32_t first = write;
+                    for (uint32_t i = 0; i < b.command_count; i++) {
+                        if (info_p->cull_visible[i]) {
+                            info_p->commands[write++] = info_p->commands[b.first_command + i];
+                        }
+                    }
+                    b.first_command = first;
+                    b.command_count = write - first;
+                }
+                info_p->commands.resize(write);
+            }
+
+            /**
+             * load_compute_pipeline - Load Compute Pipeline function loads the given compute pipeline from its binary file,
+             * it uses a single descriptor set and a push constant range of the given size
              * @param name - name of the pipeline to be loaded
+             * @param set_layout - layout of descriptor set 0
+             * @param push_constant_size - size (in bytes) of the push constants
              * @param pipeline - variable to hold the returned pipeline and layout
              * @return - successful or not
              */
-            bool load_pipeline(const std::string& name, pipeline& pipeline) {
+            bool load_compute_pipeline(const std::string& name, const vk::DescriptorSetLayout& set_layout, uint32_t push_constant_size, pipeline& pipeline) {
+                std::vector<uint8_t> src = resource::resource_manager::read_binary_file(name + ".cs.spv", {"shaders"});
+                vk::ShaderModule comp;
+                if (src.empty() || !vulkan_wrapper::create_shader_module(comp, src)) {
+                    return false;
+                }
+                vk::PipelineShaderStageCreateInfo shader_stage_create_info = {vk::PipelineShaderStageCreateFlags(), vk::ShaderStageFlagBits::eCompute, comp, "main"};
+                vk::PushConstantRange push_constant_range = {vk::ShaderStageFlagBits::eCompute, 0, push_constant_size};
+                vk::PipelineLayoutCreateInfo pipeline_layout_create_info = {vk::PipelineLayoutCreateFlags(), 1, &set_layout, 1, &push_constant_range};
+                if (!vulkan_wrapper::create_pipeline_layout(pipeline.layout, pipeline_layout_create_info)) {
+                    vulkan_wrapper::destroy_shader_module(comp);
+                    return false;
+                }
+                if (!vulkan_wrapper::create_compute_pipeline(pipeline.pl, pipeline.layout, shader_stage_create_info)) {
+                    vulkan_wrapper::destroy_shader_module(comp);
+                    vulkan_wrapper::destroy_pipeline_layout(pipeline.layout);
+                    return false;
+                }
+                vulkan_wrapper::destroy_shader_module(comp);
+                return true;
+            }
+
+            /**
+             * load_shadow_pipeline - Load Shadow Pipeline function loads the depth only pipeline used to render shadow
+             * casters of the given vertex layout into the shadow maps, it has no fragment stage, reads the model matrix
+             * from the draw data and only the position from the vertices
+             * @param layout - vertex layout id (see mesh_manager::get_layout)
+             * @param pipeline - variable to hold the returned pipeline and layout
+             * @return - successful or not
+             */
+            bool load_shadow_pipeline(uint32_t layout, pipeline& pipeline) {
+                std::vector<uint8_t> src = resource::resource_manager::read_binary_file("shadow_depth.vs.spv", {"shaders"});
+                vk::ShaderModule vert;
+                if (src.empty() || !vulkan_wrapper::create_shader_module(vert, src)) {
+                    return false;
+                }
+                vk::PipelineShaderStageCreateInfo shader_stage_create_info = {vk::PipelineShaderStageCreateFlags(), vk::ShaderStageFlagBits::eVertex, vert, "main"};
+                // The push constant is the projection * view matrix of the shadow map layer
+                vk::PushConstantRange push_constant_range = {vk::ShaderStageFlagBits::eVertex, 0, sizeof(vml::mat4)};
+                vk::PipelineLayoutCreateInfo pipeline_layout_create_info = {vk::PipelineLayoutCreateFlags(), 1, &info_p->draw_set_layout, 1, &push_constant_range};
+                if (!vulkan_wrapper::create_pipeline_layout(pipeline.layout, pipeline_layout_create_info)) {
+                    vulkan_wrapper::destroy_shader_module(vert);
+                    return false;
+                }
+                vk::VertexInputBindingDescription vertex_input_binding_description;
+                std::array<vk::VertexInputAttributeDescription, VERTEX_ATTRIBUTE_COUNT> vertex_input_attribute_descriptions;
+                mesh_manager::get_vertex_input(layout, vertex_input_binding_description, vertex_input_attribute_descriptions.data());
+                // Slope scaled bias keeps surfaces from shadowing themselves
+                vulkan_wrapper::pipeline_state state;
+                state.depth_only = true;
+                state.colour_write = false;
+                state.depth_bias = true;
+                state.depth_bias_constant = 1.25F;
+                state.depth_bias_slope = 1.75F;
+                if (!vulkan_wrapper::create_pipeline(pipeline.pl, pipeline.layout, 1, &shader_stage_create_info, 1, &vertex_input_binding_description, 1, vertex_input_attribute_descriptions.data(), -1.0f, state)) {
+                    vulkan_wrapper::destroy_shader_module(vert);
+                    vulkan_wrapper::destroy_pipeline_layout(pipeline.layout);
+                    return false;
+                }
+                vulkan_wrapper::destroy_shader_module(vert);
+                return true;
+            }
+
+            /**
+             * add_shadow_view - Add Shadow View function reserves the next shadow map layer for the given view
+             * @param view - projection * view matrix of the layer
+             */
+            void add_shadow_view(const vml::mat4& view) {
+                info_p->shadow_views.push_back(view);
+            }
+
+            /**
+             * render_shadow_maps - Render Shadow Maps function renders every shadow casting draw into every shadow map
+             * layer used this frame, recorded before the main render pass
+             * @param frame - frame being recorded, its command buffer holds the shadow commands after the main ones
+             * @param command_offset - index of the first shadow command in the frame's command buffer
+             */
+            void render_shadow_maps(const frame_resources& frame, uint32_t command_offset) {
+                for (uint32_t layer = 0; layer < info_p->shadow_views.size(); layer++) {
+                    vulkan_wrapper::begin_depth_pass(info_p->shadow_target, layer);
+                    // Every layout's shadow pipeline has the same pipeline layout, so the set and view stay bound
+                    const pipeline* bound = nullptr;
+                    for (const shadow_batch& b : info_p->shadow_batches) {
+                        if (b.pl != bound) {
+                            vulkan_wrapper::bind_pipeline(b.pl->pl);
+                            if (!bound) {
+                                vulkan_wrapper::bind_descriptor_sets(b.pl->layout, 0, 1, &frame.set);
+                                vulkan_wrapper::push_constants(b.pl->layout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(vml::mat4), &info_p->shadow_views[layer]);
+                            }
+                            bound = b.pl;
+                        }
+                        bind_geometry(b.geom);
+                        vulkan_wrapper::draw_indexed_indirect(frame.commands.buffer, frame.commands.offset + sizeof(vk::DrawIndexedIndirectCommand) * (command_offset + b.first_command), b.command_count, sizeof(vk::DrawIndexedIndirectCommand));
+                    }
+                    vulkan_wrapper::end_depth_pass();
+                }
+            }
+
+            /**
+             * load_pipeline - Load Pipeline function loads the give pipeline from the binary files, reading vertices of
+             * the given layout
+             * @param name - name of the pipeline to be loaded
+             * @param layout - vertex layout id (see mesh_manager::get_layout)
+             * @param pipeline - variable to hold the returned pipeline and layout
+             * @return - successful or not
+             */
+            bool load_pipeline(const std::string& name, uint32_t layout, pipeline& pipeline) {
                 // Create shader modules from the provided files
                 vk::ShaderModule vert, frag;
                 if (!vulkan_wrapper::create_shader_module(vert,
@@ -59,15 +627,22 @@ namespace render::render_manager {
                 shader_stage_create_infos[1] = vk::PipelineShaderStageCreateInfo(vk::PipelineShaderStageCreateFlags(),
                                                                               vk::ShaderStageFlagBits::eFragment, frag,
                                                                               "main");
+                // The fragment stage's texture array is sized by the texture manager, constant 0 of the shader
+                uint32_t texture_count = texture_manager::get_capacity();
+                vk::SpecializationMapEntry specialization_entry = {0, 0, sizeof(uint32_t)};
+                vk::SpecializationInfo specialization_info = {1, &specialization_entry, sizeof(uint32_t), &texture_count};
+                shader_stage_create_infos[1].pSpecializationInfo = &specialization_info;
                 // Indicate the size of the push constants which store most of the information for rendering
                 vk::PushConstantRange push_constant_range = {vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment,
                                                            0,
                                                            sizeof(push_constants)};
 
-                // Tell the layout about the push constants
+                // Tell the layout about the push constants, the per-draw storage buffer and the textures. Every graphics
+                // pipeline has the same layout so the sets stay bound when switching between them
+                std::array<vk::DescriptorSetLayout, 2> set_layouts = {info_p->draw_set_layout, info_p->texture_set_layout};
                 vk::PipelineLayoutCreateInfo pipeline_layout_create_info = {vk::PipelineLayoutCreateFlags(),
-                                                                         0,
-                                                                         nullptr,
+                                                                         static_cast<uint32_t>(set_layouts.size()),
+                                                                         set_layouts.data(),
                                                                          1,
                                                                          &push_constant_range};
                 // Create the pipeline layout
@@ -77,18 +652,53 @@ namespace render::render_manager {
                     return false;
                 }
 
-                // Enable the vertices to be sent to the shader
-                vk::VertexInputBindingDescription vertex_input_binding_description = {0,
-                                                                                   sizeof(vertex),
-                                                                                   vk::VertexInputRate::eVertex};
-                vk::VertexInputAttributeDescription vertex_input_attribute_descriptions[2];
-                vertex_input_attribute_descriptions[0] = {0, 0, vk::Format::eR32G32Sfloat, (uint32_t)offsetof(vertex, pos)};
-                vertex_input_attribute_descriptions[1] = {1, 0, vk::Format::eR32G32Sfloat, (uint32_t)offsetof(vertex, uv)};
+                // Enable the vertices to be sent to the shader, as they are stored in the layout's shared buffer
+                vk::VertexInputBindingDescription vertex_input_binding_description;
+                vk::VertexInputAttributeDescription vertex_input_attribute_descriptions[VERTEX_ATTRIBUTE_COUNT];
+                uint32_t attribute_count = mesh_manager::get_vertex_input(layout, vertex_input_binding_description, vertex_input_attribute_descriptions);
 
                 // Create the pipeline
-                if (!vulkan_wrapper::create_pipeline(pipeline.pl, pipeline.layout, 2, shader_stage_create_infos, 1, &vertex_input_binding_description, 2, vertex_input_attribute_descriptions, -1.0f)) {
+                if (!vulkan_wrapper::create_pipeline(pipeline.pl, pipeline.layout, 2, shader_stage_create_infos, 1, &vertex_input_binding_description, attribute_count, vertex_input_attribute_descriptions, -1.0f)) {
+                    vulkan_wrapper::destroy_shader_module(vert);
+                    vulkan_wrapper::destroy_shader_module(frag);
+                    vulkan_wrapper::destroy_pipeline_layout(pipeline.layout);
+                    return false;
+                }
+
+                // Shadows lie exactly on their receiver, so they are pulled towards the camera with depth bias and
+                // tested with less or equal instead of being offset from the surface
+                vulkan_wrapper::pipeline_state blend_state;
+                blend_state.depth_write = false;
+                blend_state.depth_compare = vk::CompareOp::eLessOrEqual;
+                blend_state.depth_bias = true;
+                blend_state.depth_bias_constant = -1.0F;
+                blend_state.depth_bias_slope = -1.0F;
+                // Marking only sets the stencil to 1 wherever any shadow covers the receiver, so overlapping shadows
+                // are never blended twice and no colour is written
+                vulkan_wrapper::pipeline_state mark_state = blend_state;
+                mark_state.colour_write = false;
+                mark_state.stencil_test = true;
+                mark_state.stencil = {vk::StencilOp::eKeep, vk::StencilOp::eReplace, vk::StencilOp::eKeep, vk::CompareOp::eAlways, 0xFF, 0xFF, 1};
+                // Resolving redraws the receiver once, darkening where it is marked and clearing the mark for the next one
+                vulkan_wrapper::pipeline_state resolve_state;
+                resolve_state.depth_write = false;
+                resolve_state.depth_compare = vk::CompareOp::eLessOrEqual;
+                resolve_state.stencil_test = true;
+                resolve_state.stencil = {vk::StencilOp::eKeep, vk::StencilOp::eZero, vk::StencilOp::eZero, vk::CompareOp::eEqual, 0xFF, 0xFF, 1};
+
+                pipeline.shadow_pls = {};
+                if (!vulkan_wrapper::create_pipeline(pipeline.shadow_pls[0], pipeline.layout, 2, shader_stage_create_infos, 1, &vertex_input_binding_description, attribute_count, vertex_input_attribute_descriptions, -1.0f, blend_state) ||
+                    (vulkan_wrapper::supports_stencil() &&
+                     (!vulkan_wrapper::create_pipeline(pipeline.shadow_pls[1], pipeline.layout, 2, shader_stage_create_infos, 1, &vertex_input_binding_description, attribute_count, vertex_input_attribute_descriptions, -1.0f, mark_state) ||
+                      !vulkan_wrapper::create_pipeline(pipeline.shadow_pls[2], pipeline.layout, 2, shader_stage_create_infos, 1, &vertex_input_binding_description, attribute_count, vertex_input_attribute_descriptions, -1.0f, resolve_state)))) {
+                    for (const vk::Pipeline& pl : pipeline.shadow_pls) {
+                        if (pl) {
+                            vulkan_wrapper::destroy_pipeline(pl);
+                        }
+                    }
                     vulkan_wrapper::destroy_shader_module(vert);
                     vulkan_wrapper::destroy_shader_module(frag);
+                    vulkan_wrapper::destroy_pipeline(pipeline.pl);
                     vulkan_wrapper::destroy_pipeline_layout(pipeline.layout);
                     return false;
                 }
@@ -100,28 +710,179 @@ namespace render::render_manager {
                 // Returns true if successful
                 return true;
             }
+
+            /**
+             * find_pipeline - Find Pipeline function returns the given pipeline's variant for the given vertex layout,
+             * loading it the first time the layout is drawn with. A variant which fails to load is kept (empty) so it is
+             * not tried again every draw
+             * @param id - pipeline id
+             * @param layout - vertex layout id
+             * @return - the pipeline, or nullptr if it is not available
+             */
+            pipeline* find_pipeline(uint32_t id, uint32_t layout) {
+                auto it = info_p->id_pipeline_map.find({id, layout});
+                if (it == info_p->id_pipeline_map.end()) {
+                    if (!info_p->loaded) {
+                        return nullptr;
+                    }
+                    if (std::find(info_p->layouts.begin(), info_p->layouts.end(), layout) == info_p->layouts.end()) {
+                        info_p->layouts.push_back(layout);
+                    }
+                    pipeline pl;
+                    for (const std::pair<const std::string, uint32_t>& nPair : info_p->name_id_map) {
+                        if (nPair.second == id && !load_pipeline(nPair.first, layout, pl)) {
+                            pl = pipeline();
+                        }
+                    }
+                    it = info_p->id_pipeline_map.insert({{id, layout}, pl}).first;
+                }
+                return it->second.pl ? &it->second : nullptr;
+            }
+            // Returns the shadow pipeline for the given vertex layout (see find_pipeline), or nullptr if not available
+            pipeline* find_shadow_pipeline(uint32_t layout) {
+                auto it = info_p->shadow_pls.find(layout);
+                if (it == info_p->shadow_pls.end()) {
+                    if (!info_p->shadow_loaded) {
+                        return nullptr;
+                    }
+                    pipeline pl;
+                    if (!load_shadow_pipeline(layout, pl)) {
+                        pl = pipeline();
+                    }
+                    it = info_p->shadow_pls.insert({layout, pl}).first;
+                }
+                return it->second.pl ? &it->second : nullptr;
+            }
+            // Destroy the given pipeline and its variants once the frames in flight which may use them have finished
+            void defer_destroy_pipeline(const pipeline& pl) {
+                if (!pl.pl) {
+                    return;
+                }
+                vulkan_wrapper::defer_destroy(pl.pl);
+                for (const vk::Pipeline& shadow_pl : pl.shadow_pls) {
+                    if (shadow_pl) {
+                        vulkan_wrapper::defer_destroy(shadow_pl);
+                    }
+                }
+                vulkan_wrapper::defer_destroy(pl.layout);
+            }
         }
 
         // Hook to get the aspect ratio from Vulkan without including the entire header
         float get_aspect_ratio() {
             return vulkan_wrapper::get_aspect_ratio();
         }
+        // Hook to check whether the stencil shadow passes (shadow_mark and shadow_resolve) are available
+        bool supports_stencil() {
+            return vulkan_wrapper::supports_stencil();
+        }
+        // Returns whether shadow maps can be used, needs the shadow depth pipeline and the shadow map image
+        bool supports_shadow_maps() {
+            return info_p->shadow_loaded && info_p->shadow_target_created;
+        }
 
         /**
-         * init - Init function initialises the Render Manager where it creates the vertex buffer for the 2D rectangle
+         * init - Init function initialises the Render Manager where it registers the 2D rectangle mesh and creates the
+         * descriptor sets for the per-frame draw data, must be called after mesh_manager::init
          */
         void init() {
             info_p = std::make_unique<info>();
-            static const std::vector<vertex> vertices_2D = {
-                    {{0.0f, 0.0f}, {0.0f, 0.0f}},
-                    {{1.0f, 0.0f}, {1.0f, 0.0f}},
-                    {{1.0f, 1.0f}, {1.0f, 1.0f}},
-                    {{0.0f, 0.0f}, {0.0f, 0.0f}},
-                    {{1.0f, 1.0f}, {1.0f, 1.0f}},
-                    {{0.0f, 1.0f}, {0.0f, 1.0f}}};
-            vulkan_wrapper::create_vertex_buffer(info_p->rect_2D, info_p->rect_2D_memory, sizeof(vertex) * vertices_2D.size());
-            vulkan_wrapper::map_vertex_buffer(info_p->rect_2D_memory, sizeof(vertex) * vertices_2D.size(), vertices_2D.data());
+            // The rectangle is flat so its layout keeps two components of position, it is loaded with the pipelines
+            mesh_data rect;
+            rect.positions = {vml::vec3(0.0F, 0.0F, 0.0F), vml::vec3(1.0F, 0.0F, 0.0F), vml::vec3(1.0F, 1.0F, 0.0F), vml::vec3(0.0F, 1.0F, 0.0F)};
+            rect.uvs = {vml::vec2(0.0F, 0.0F), vml::vec2(1.0F, 0.0F), vml::vec2(1.0F, 1.0F), vml::vec2(0.0F, 1.0F)};
+            rect.indices = {0, 1, 2, 0, 2, 3};
+            vertex_layout rect_layout;
+            rect_layout.position = vertex_format::float2;
+            info_p->rect_2D = mesh_manager::register_mesh(rect, rect_layout);
+            info_p->layouts.push_back(mesh_manager::get_mesh(info_p->rect_2D).layout);
             info_p->offsets = new vk::DeviceSize[1]{0};
+
+            // One storage buffer of draw_data, read by both stages (the fragment stage needs the colour, flags and
+            // texture), one of lights which the fragment stage loops over, the shadow maps with the view of each layer
+            // and the cameras of the frame
+            std::array<vk::DescriptorSetLayoutBinding, 5> draw_bindings = {
+                    vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, nullptr),
+                    vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eFragment, nullptr),
+                    vk::DescriptorSetLayoutBinding(2, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eFragment, nullptr),
+                    vk::DescriptorSetLayoutBinding(3, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eFragment, nullptr),
+                    vk::DescriptorSetLayoutBinding(4, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eVertex, nullptr)};
+            vk::DescriptorSetLayoutCreateInfo set_layout_create_info = {vk::DescriptorSetLayoutCreateFlags(), static_cast<uint32_t>(draw_bindings.size()), draw_bindings.data()};
+            vulkan_wrapper::create_descriptor_set_layout(info_p->draw_set_layout, set_layout_create_info);
+
+            // The cull compute shader reads the draws and commands and writes the visible commands and their count
+            std::array<vk::DescriptorSetLayoutBinding, 4> cull_bindings;
+            for (uint32_t i = 0; i < cull_bindings.size(); i++) {
+                cull_bindings[i] = {i, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute, nullptr};
+            }
+            vk::DescriptorSetLayoutCreateInfo cull_set_layout_create_info = {vk::DescriptorSetLayoutCreateFlags(), static_cast<uint32_t>(cull_bindings.size()), cull_bindings.data()};
+            vulkan_wrapper::create_descriptor_set_layout(info_p->cull_set_layout, cull_set_layout_create_info);
+
+            // One of each descriptor set per frame in flight, plus a draw set for each frame's static cache
+            uint32_t frame_count = vulkan_wrapper::get_max_frames_in_flight();
+            std::array<vk::DescriptorPoolSize, 2> pool_sizes = {
+                    vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, frame_count * static_cast<uint32_t>(2 * (draw_bindings.size() - 1) + cull_bindings.size())),
+                    vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, frame_count * 2)};
+            vk::DescriptorPoolCreateInfo pool_create_info = {vk::DescriptorPoolCreateFlags(), frame_count * 3, static_cast<uint32_t>(pool_sizes.size()), pool_sizes.data()};
+            vulkan_wrapper::create_descriptor_pool(info_p->descriptor_pool, pool_create_info);
+
+            std::vector<vk::DescriptorSetLayout> set_layouts(frame_count, info_p->draw_set_layout);
+            set_layouts.insert(set_layouts.end(), frame_count, info_p->cull_set_layout);
+            set_layouts.insert(set_layouts.end(), frame_count, info_p->draw_set_layout);
+            std::vector<vk::DescriptorSet> sets;
+            vk::DescriptorSetAllocateInfo set_allocate_info = {info_p->descriptor_pool, frame_count * 3, set_layouts.data()};
+            vulkan_wrapper::allocate_descriptor_sets(sets, set_allocate_info);
+
+            // The texture sets come from their own pool, which must allow update after bind when descriptor indexing is
+            // used. Every slot is written on a frame's first use, after that only the slots which change image
+            uint32_t texture_count = texture_manager::get_capacity();
+            bool indexing = vulkan_wrapper::supports_descriptor_indexing();
+            vk::DescriptorSetLayoutBinding texture_binding = {0, vk::DescriptorType::eCombinedImageSampler, texture_count, vk::ShaderStageFlagBits::eFragment, nullptr};
+            vk::DescriptorBindingFlags texture_binding_flags = vk::DescriptorBindingFlagBits::eUpdateAfterBind | vk::DescriptorBindingFlagBits::ePartiallyBound;
+            vk::DescriptorSetLayoutBindingFlagsCreateInfo binding_flags_create_info = {1, &texture_binding_flags};
+            vk::DescriptorSetLayoutCreateInfo texture_set_layout_create_info = {indexing ? vk::DescriptorSetLayoutCreateFlags(vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool) : vk::DescriptorSetLayoutCreateFlags(), 1, &texture_binding};
+            if (indexing) {
+                texture_set_layout_create_info.pNext = &binding_flags_create_info;
+            }
+            vulkan_wrapper::create_descriptor_set_layout(info_p->texture_set_layout, texture_set_layout_create_info);
+            vk::DescriptorPoolSize texture_pool_size = {vk::DescriptorType::eCombinedImageSampler, frame_count * texture_count};
+            vk::DescriptorPoolCreateInfo texture_pool_create_info = {indexing ? vk::DescriptorPoolCreateFlags(vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind) : vk::DescriptorPoolCreateFlags(), frame_count, 1, &texture_pool_size};
+            vulkan_wrapper::create_descriptor_pool(info_p->texture_pool, texture_pool_create_info);
+            std::vector<vk::DescriptorSetLayout> texture_set_layouts(frame_count, info_p->texture_set_layout);
+            std::vector<vk::DescriptorSet> texture_sets;
+            vk::DescriptorSetAllocateInfo texture_set_allocate_info = {info_p->texture_pool, frame_count, texture_set_layouts.data()};
+            vulkan_wrapper::allocate_descriptor_sets(texture_sets, texture_set_allocate_info);
+            info_p->texture_slots.resize(texture_count);
+            info_p->texture_infos.resize(texture_count);
+
+            // The shadow maps are shared by every frame, a depth pass waits for the previous frame's reads to finish
+            info_p->shadow_target_created = vulkan_wrapper::create_depth_target(info_p->shadow_target, SHADOW_MAP_SIZE, SHADOW_MAP_LAYERS);
+            if (!info_p->shadow_target_created) {
+                info_p->shadow_target_placeholder = vulkan_wrapper::create_depth_target(info_p->shadow_target, 1, 1);
+            }
+            // Anything outside of a shadow map is treated as lit
+            vk::SamplerCreateInfo sampler_create_info = {vk::SamplerCreateFlags(), vk::Filter::eNearest, vk::Filter::eNearest, vk::SamplerMipmapMode::eNearest,
+                                                         vk::SamplerAddressMode::eClampToBorder, vk::SamplerAddressMode::eClampToBorder, vk::SamplerAddressMode::eClampToBorder,
+                                                         0.0F, VK_FALSE, 1.0F, VK_FALSE, vk::CompareOp::eAlways, 0.0F, 0.0F, vk::BorderColor::eFloatOpaqueWhite, VK_FALSE};
+            vulkan_wrapper::create_sampler(info_p->shadow_sampler, sampler_create_info);
+
+            info_p->frames.resize(frame_count);
+            for (uint32_t i = 0; i < frame_count; i++) {
+                frame_resources& frame = info_p->frames[i];
+                frame.set = sets[i];
+                frame.cull_set = sets[frame_count + i];
+                frame.statics.set = sets[2 * frame_count + i];
+                frame.texture_set = texture_sets[i];
+                reserve_frame(frame, 64, 8);
+                reserve_cameras(frame, 4);
+                if (info_p->shadow_target_created || info_p->shadow_target_placeholder) {
+                    vk::DescriptorImageInfo shadow_map_info = {info_p->shadow_sampler, info_p->shadow_target.view, vk::ImageLayout::eShaderReadOnlyOptimal};
+                    std::array<vk::WriteDescriptorSet, 2> writes = {
+                            vk::WriteDescriptorSet(frame.set, 2, 0, 1, vk::DescriptorType::eCombinedImageSampler, &shadow_map_info, nullptr, nullptr),
+                            vk::WriteDescriptorSet(frame.statics.set, 2, 0, 1, vk::DescriptorType::eCombinedImageSampler, &shadow_map_info, nullptr, nullptr)};
+                    vulkan_wrapper::update_descriptor_sets(static_cast<uint32_t>(writes.size()), writes.data());
+                }
+            }
             reset_push_constants();
         }
 
@@ -134,13 +895,14 @@ namespace render::render_manager {
             // Add name to map with the next available id
             info_p->name_id_map.insert(std::pair<const std::string, uint32_t>(name, info_p->next_id));
             if (info_p->loaded) {
-                pipeline pl;
-                // Load the pipeline
-                if (!load_pipeline(name, pl)) {
-                    return false;
+                // Load the pipeline for every layout drawn so far, placing each into the map for easy loading
+                for (uint32_t layout : info_p->layouts) {
+                    pipeline pl;
+                    if (!load_pipeline(name, layout, pl)) {
+                        return false;
+                    }
+                    info_p->id_pipeline_map.insert({{info_p->next_id, layout}, pl});
                 }
-                // Place pipeline into the map for easy loading
-                info_p->id_pipeline_map.insert(std::pair<const uint32_t, pipeline>(info_p->next_id, pl));
             }
             info_p->next_id++;
             return true;
@@ -164,13 +926,16 @@ namespace render::render_manager {
          * @param id - pipeline id
          */
         void bind_pipeline(uint32_t id) {
-            if (id > 0) {
-                //Find the pipeline and if present bind it
-                auto it = info_p->id_pipeline_map.find(id);
-                if (it != info_p->id_pipeline_map.end()) {
-                    vulkan_wrapper::bind_pipeline(it->second.pl);
-                    info_p->current_pl = &it->second;
-                }
+            // The main render pass was recreated (e.g. a new sample count) so every pipeline must be created again, this
+            // is the first call of a frame
+            if (info_p->loaded && info_p->render_pass_version != vulkan_wrapper::get_render_pass_version()) {
+                reload_shaders();
+            }
+            // The variant for the layout of the following draws is found when they are drawn (see draw_mesh)
+            if (id > 0 && info_p->current_id != id) {
+                info_p->current_id = id;
+                info_p->current_pl = nullptr;
+                info_p->batch_dirty = true;
             }
         }
         /**
@@ -178,63 +943,352 @@ namespace render::render_manager {
          * this is called at the start of rendering
          */
         void reset_push_constants() {
-            info_p->current_pc.p = vml::mat4::identity();
-            info_p->current_pc.v = vml::mat4::identity();
-            info_p->current_pc.m = vml::mat4::identity();
-            info_p->current_pc.cm = vml::mat4::identity();
+            info_p->current_camera.p = vml::mat4::identity();
+            info_p->current_camera.v = vml::mat4::identity();
+            info_p->camera_dirty = true;
             info_p->current_pc.light_dir = vml::vec4();
-            info_p->current_pc.light0 = vml::vec4();
-            info_p->current_pc.light1 = vml::vec4();
-            info_p->current_pc.is_shadow = false;
+            info_p->current_pc.first_light = 0;
+            info_p->current_pc.light_count = 0;
+            info_p->current_pc.first_shadow_layer = 0;
+            info_p->current_pc.shadow_maps = 0;
+            info_p->shadow_maps = false;
+            info_p->current_caster = false;
+            info_p->current_static = false;
+            info_p->current_draw.m = vml::mat4::identity();
+            info_p->current_draw.cm = vml::mat4::identity();
+            info_p->current_draw.flags = vml::vec4();
+            info_p->current_draw.texture = 0;
+            info_p->current_pass = draw_pass::normal;
+            info_p->batch_dirty = true;
         }
-        // Set the perspective matrix push constant
+        // Set the perspective matrix of the camera, starts a new batch
         void set_perspective(const vml::mat4& pers) {
-            info_p->current_pc.p = pers;
+            info_p->current_camera.p = pers;
+            info_p->camera_dirty = true;
+            info_p->batch_dirty = true;
         }
-        // Set the view matrix push constant
+        // Set the view matrix of the camera, starts a new batch
         void set_view(const vml::mat4& view) {
-            info_p->current_pc.v = view;
+            info_p->current_camera.v = view;
+            info_p->camera_dirty = true;
+            info_p->batch_dirty = true;
         }
-        // Set the model matrix push constant
+        // Set the model matrix of the following draws
         void set_model(const vml::mat4& mode) {
-            info_p->current_pc.m = mode;
+            info_p->current_draw.m = mode;
         }
-        // Set the colour multiplier matrix push constant
+        // Set the colour multiplier matrix of the following draws
         void set_colour_mult(const vml::mat4& cm) {
-            info_p->current_pc.cm = cm;
+            info_p->current_draw.cm = cm;
         }
-        // Set the light direction vector push constant
+        /**
+         * set_light_dir - Set Light Dir function sets the light direction vector push constant, starts a new batch.
+         * With shadow maps in use the light gets an orthographic shadow map covering the shadow bounds
+         * @param l - light direction
+         */
         void set_light_dir(const vml::vec3& l) {
             info_p->current_pc.light_dir = vml::vec4(l, 0.0F);
+            info_p->current_pc.shadow_maps = 0;
+            if (info_p->shadow_maps && info_p->shadow_views.size() + 1 <= SHADOW_MAP_LAYERS) {
+                vml::vec3 centre = (info_p->shadow_bounds_min + info_p->shadow_bounds_max) / 2.0F;
+                float radius = (info_p->shadow_bounds_max - info_p->shadow_bounds_min).magnitude() / 2.0F;
+                vml::vec3 dir = l / l.magnitude();
+                // Any up vector works as long as it is not parallel to the light
+                vml::vec3 up = std::fabs(dir[1]) > 0.9F ? vml::vec3(0.0F, 0.0F, 1.0F) : vml::vec3(0.0F, 1.0F, 0.0F);
+                vml::mat4 view = vml::look_at(centre - dir * (2.0F * radius), centre, up);
+                info_p->current_pc.first_shadow_layer = static_cast<uint32_t>(info_p->shadow_views.size());
+                info_p->current_pc.shadow_maps = 1;
+                add_shadow_view(vml::orthographic(-radius, radius, -radius, radius, radius, 3.0F * radius) * view);
+            }
+            info_p->batch_dirty = true;
         }
-        // Set the light0 position vector push constant
-        void set_light0(const vml::vec3& l) {
-            info_p->current_pc.light0 = vml::vec4(l, 0.0F);
-        }
-        // Set the light1 position vector push constant
-        void set_light1(const vml::vec3& l) {
-            info_p->current_pc.light1 = vml::vec4(l, 0.0F);
+        /**
+         * set_lights - Set Lights function appends the given point lights to this frame's light list and points the
+         * following draws at them, starts a new batch
+         * @param lights - light positions, w is unused
+         * @param count - number of lights
+         */
+        void set_lights(const vml::vec4* lights, uint32_t count) {
+            info_p->current_pc.first_light = static_cast<uint32_t>(info_p->lights.size());
+            info_p->current_pc.light_count = count;
+            info_p->lights.insert(info_p->lights.end(), lights, lights + count);
+            // With shadow maps in use each light gets a cube of six layers reaching the far corner of the shadow bounds
+            info_p->current_pc.shadow_maps = 0;
+            if (info_p->shadow_maps && info_p->shadow_views.size() + 6 * count <= SHADOW_MAP_LAYERS) {
+                static const vml::vec3 directions[6] = {vml::vec3(1.0F, 0.0F, 0.0F), vml::vec3(-1.0F, 0.0F, 0.0F), vml::vec3(0.0F, 1.0F, 0.0F),
+                                                        vml::vec3(0.0F, -1.0F, 0.0F), vml::vec3(0.0F, 0.0F, 1.0F), vml::vec3(0.0F, 0.0F, -1.0F)};
+                info_p->current_pc.first_shadow_layer = static_cast<uint32_t>(info_p->shadow_views.size());
+                info_p->current_pc.shadow_maps = 1;
+                for (uint32_t i = 0; i < count; i++) {
+                    vml::vec3 position = vml::vec3(lights[i][0], lights[i][1], lights[i][2]);
+                    float far = 0.0F;
+                    for (int c = 0; c < 8; c++) {
+                        vml::vec3 corner = vml::vec3((c & 1) ? info_p->shadow_bounds_max[0] : info_p->shadow_bounds_min[0], (c & 2) ? info_p->shadow_bounds_max[1] : info_p->shadow_bounds_min[1],
+                                                     (c & 4) ? info_p->shadow_bounds_max[2] : info_p->shadow_bounds_min[2]);
+                        far = std::max(far, (corner - position).magnitude());
+                    }
+                    // A 90 degree square frustum per face, together they cover every direction
+                    vml::mat4 projection = vml::perspective(1.0F, 0.5F, 0.05F, far * 1.01F);
+                    for (const vml::vec3& dir : directions) {
+                        vml::vec3 up = dir[1] != 0.0F ? vml::vec3(0.0F, 0.0F, 1.0F) : vml::vec3(0.0F, 1.0F, 0.0F);
+                        add_shadow_view(projection * vml::look_at(position, position + dir, up));
+                    }
+                }
+            }
+            info_p->batch_dirty = true;
         }
-        // Set the is shadow boolean push constant
+        // Set whether the following draws are rendered as shadows
         void set_is_shadow(bool is) {
-            info_p->current_pc.is_shadow = is;
+            info_p->current_draw.flags[0] = is ? 1.0F : 0.0F;
+        }
+        // Set which variant of the bound pipeline the following draws use, starts a new batch
+        void set_draw_pass(draw_pass pass) {
+            if (info_p->current_pass != pass) {
+                info_p->current_pass = pass;
+                info_p->batch_dirty = true;
+            }
+        }
+        // Set whether the following draws are rendered into the shadow maps
+        void set_casts_shadow(bool casts) {
+            info_p->current_caster = casts;
+        }
+        /**
+         * set_static - Set Static function sets whether the following draws belong to the static set, which is recorded
+         * once into a cached command buffer and replayed every frame until any of it changes. Static draws are drawn
+         * before everything else and never culled, shadow casters are always drawn as normal
+         * @param is - static or not
+         */
+        void set_static(bool is) {
+            info_p->current_static = is;
+        }
+        // Set whether the following set_light_dir and set_lights calls give their lights shadow maps, ignored if shadow
+        // maps are not supported
+        void use_shadow_maps(bool use) {
+            info_p->shadow_maps = use && supports_shadow_maps();
+        }
+        // Set the region shadow maps must cover, must be set before the lights using them
+        void set_shadow_bounds(const vml::vec3& min, const vml::vec3& max) {
+            info_p->shadow_bounds_min = min;
+            info_p->shadow_bounds_max = max;
+        }
+        // Hook to start streaming a texture without including the texture manager, see texture_manager::load
+        uint32_t load_texture(const std::string& name) {
+            return texture_manager::load(name);
+        }
+        // Hook to register a mesh in its most compact vertex layout without including the mesh manager, see mesh_manager::register_mesh
+        uint32_t register_mesh(const mesh_data& data) {
+            return mesh_manager::register_mesh(data);
+        }
+        // Set the texture sampled by the following draws (0 for none), it is part of the draw data so batches carry on
+        void set_texture(uint32_t id) {
+            texture_manager::use(id);
+            info_p->current_draw.texture = id;
+        }
+        // Choose how draws outside of the view frustum are removed, GPU falls back to CPU when it is unavailable
+        void set_cull_mode(cull_mode mode) {
+            info_p->mode = mode;
         }
 
         /**
-         * draw - Draw function draws the currently binded vertex buffer using the given parameters
-         * @param vertex_count - Number of vertices to draw
+         * draw_mesh - Draw Mesh function records an indexed draw of the given mesh (see mesh_manager) with the current
+         * draw data, nothing is sent to the GPU until submit. Each instance gets its own copy of the draw data so
+         * instances can be indexed in the shader with gl_InstanceIndex. Meshes sharing a vertex layout share buffers, so
+         * consecutive draws of different meshes stay in one batch
+         * @param id - mesh id, draws of a mesh which is not yet ready are skipped
          * @param instance_count - Number of instances to draw
-         * @param first_vertex - Offset into the vertex buffer to start
-         * @param first_instance - Offset into the instances to start
          */
-        void draw(uint32_t vertex_count, uint32_t instance_count, uint32_t first_vertex, uint32_t first_instance) {
-            vulkan_wrapper::push_constants(info_p->current_pl->layout, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0, sizeof(push_constants), &info_p->current_pc);
-            vulkan_wrapper::draw(vertex_count, instance_count, first_vertex, first_instance);
+        void draw_mesh(uint32_t id, uint32_t instance_count) {
+            const mesh_manager::mesh& m = mesh_manager::get_mesh(id);
+            if (!m.ready || info_p->current_id == 0 || instance_count == 0) {
+                return;
+            }
+            // A new layout needs the bound pipeline's variant for it, and new buffers start a new bucket
+            if (!info_p->current_pl || info_p->current_layout != m.layout) {
+                info_p->current_pl = find_pipeline(info_p->current_id, m.layout);
+                info_p->current_layout = m.layout;
+                info_p->batch_dirty = true;
+            }
+            if (!info_p->current_pl) {
+                return;
+            }
+            geometry geom = {mesh_manager::get_vertex_buffer(m.layout), mesh_manager::get_index_buffer(m.layout), m.index_type};
+            if (info_p->current_geom != geom) {
+                info_p->current_geom = geom;
+                info_p->batch_dirty = true;
+            }
+            // Static draws go into their own lists, see set_static
+            bool is_static = info_p->current_static && !info_p->current_caster;
+            std::vector<draw_data>& draws = is_static ? info_p->static_draws : info_p->draws;
+            std::vector<vk::DrawIndexedIndirectCommand>& commands = is_static ? info_p->static_commands : info_p->commands;
+            std::vector<batch>& batches = is_static ? info_p->static_batches : info_p->batches;
+            // Push constants, pipeline, draw pass or geometry changed since the last draw so start a new bucket
+            if (info_p->batch_dirty || info_p->batch_static != is_static) {
+                vk::Pipeline pass_pl = info_p->current_pass == draw_pass::normal ? info_p->current_pl->pl : info_p->current_pl->shadow_pls[static_cast<uint32_t>(info_p->current_pass) - 1];
+                if (!pass_pl) {
+                    return;
+                }
+                // The camera is only written to the frame's cameras once it changes, batches refer to it by index
+                if (info_p->camera_dirty) {
+                    info_p->current_pc.camera = static_cast<uint32_t>(info_p->cameras.size());
+                    info_p->cameras.push_back(info_p->current_camera);
+                    info_p->camera_dirty = false;
+                }
+                batches.push_back({info_p->current_pl, pass_pl, geom, info_p->current_pc, static_cast<uint32_t>(commands.size()), 0});
+                info_p->batch_dirty = false;
+                info_p->batch_static = is_static;
+            }
+            uint32_t first_draw = static_cast<uint32_t>(draws.size());
+            // Quantised positions are taken back to model space by the model matrix of the draw, the fixed function
+            // vertex fetch having already scaled them to -1 - 1
+            draw_data draw = info_p->current_draw;
+            if (m.quantised) {
+                draw.m = draw.m * m.dequantise;
+            }
+            draw.bounds = vml::bounding_sphere(draw.m, m.bounds_min, m.bounds_max);
+            draws.insert(draws.end(), instance_count, draw);
+            commands.push_back({m.index_count, instance_count, m.first_index, m.vertex_offset, first_draw});
+            batches.back().command_count++;
+            // Shadow casters are drawn again into the shadow maps, they are never culled against the camera
+            pipeline* shadow_pl = info_p->current_caster ? find_shadow_pipeline(m.layout) : nullptr;
+            if (shadow_pl) {
+                if (info_p->shadow_batches.empty() || info_p->shadow_batches.back().pl != shadow_pl || info_p->shadow_batches.back().geom != geom) {
+                    info_p->shadow_batches.push_back({shadow_pl, geom, static_cast<uint32_t>(info_p->shadow_commands.size()), 0});
+                }
+                info_p->shadow_commands.push_back(commands.back());
+                info_p->shadow_batches.back().command_count++;
+            }
+        }
+        // Returns the mesh of the 2D rectangle (see draw_rect_2D), to draw it through draw_mesh
+        uint32_t get_rect_2D() {
+            return info_p->rect_2D;
         }
         // Draw the 2D rectangle used for the majority of this application described as (0, 0, 0), (1, 0, 0), (1, 1, 0) and (0, 1, 0)
         void draw_rect_2D() {
-            vulkan_wrapper::bind_vertex_buffers(1, &info_p->rect_2D, info_p->offsets);
-            draw(6, 1, 0, 0);
+            draw_mesh(info_p->rect_2D);
+        }
+
+        /**
+         * submit - Submit function culls and uploads every draw recorded this frame and starts the render pass, then
+         * issues one indirect draw per batch so the CPU cost no longer grows with the number of draws. With GPU culling
+         * a compute pass compacts the visible commands of each batch before the render pass and the draw count is read
+         * back by the GPU with draw_indirect_count. Culling is recorded for the async compute
+         * queue, which rendering waits on before reading the draws. Static draws are replayed from the frame's cache (see
+         * set_static) ahead of everything else
+         */
+        void submit() {
+            frame_resources& frame = info_p->frames[vulkan_wrapper::get_frame_index()];
+            // Finish the texture uploads of earlier frames before the render pass and pick up any new images
+            texture_manager::update();
+            write_frame_textures(frame);
+
+            cull_mode mode = info_p->mode;
+            if (mode == cull_mode::gpu && !(info_p->cull_loaded && vulkan_wrapper::supports_draw_indirect_count())) {
+                mode = cull_mode::cpu;
+            }
+            if (mode == cull_mode::cpu) {
+                cull_on_cpu();
+            }
+
+            uint32_t command_count = static_cast<uint32_t>(info_p->commands.size());
+            uint32_t batch_count = static_cast<uint32_t>(info_p->batches.size());
+            // Shadow casting commands are stored after the main commands
+            bool shadows = info_p->shadow_target_created && info_p->shadow_loaded && !info_p->shadow_views.empty() && !info_p->shadow_commands.empty();
+            uint32_t shadow_command_count = shadows ? static_cast<uint32_t>(info_p->shadow_commands.size()) : 0;
+
+            // Both the frame's batches and its static cache read the cameras
+            auto camera_count = static_cast<uint32_t>(info_p->cameras.size());
+            bool cameras = reserve_cameras(frame, std::max(camera_count, 1U));
+            if (cameras && camera_count > 0) {
+                memcpy(frame.cameras_data, info_p->cameras.data(), sizeof(camera_data) * camera_count);
+            }
+            bool uploaded = cameras && command_count > 0 && reserve_frame(frame, command_count, batch_count) && upload_frame(frame, shadow_command_count);
+
+            // The shadow map layers must be readable before they are first sampled, even if never rendered
+            if ((info_p->shadow_target_created || info_p->shadow_target_placeholder) && !info_p->shadow_layout_ready) {
+                vulkan_wrapper::image_barrier(info_p->shadow_target.image, vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eDepth, 0, 1, 0, info_p->shadow_target.layers), vk::ImageLayout::eUndefined, vk::ImageLayout::eShaderReadOnlyOptimal,
+                                              vk::PipelineStageFlagBits::eTopOfPipe, vk::AccessFlags(), vk::PipelineStageFlagBits::eFragmentShader, vk::AccessFlagBits::eShaderRead);
+                info_p->shadow_layout_ready = true;
+            }
+            // With a static cache the pass is recorded in secondary command buffers, the cache first then everything else
+            bool statics = cameras && record_static(frame);
+
+            if (uploaded) {
+                if (shadows) {
+                    render_shadow_maps(frame, command_count);
+                }
+
+                if (mode == cull_mode::gpu) {
+                    // Culling runs on the compute queue, the draws are read from the vertex shader onwards
+                    vulkan_wrapper::begin_async_compute();
+                    // One workgroup per batch, each compacts its own range of commands so batches never mix
+                    vulkan_wrapper::bind_compute_pipeline(info_p->cull_pl.pl);
+                    vulkan_wrapper::bind_compute_descriptor_sets(info_p->cull_pl.layout, 0, 1, &frame.cull_set);
+                    for (uint32_t i = 0; i < batch_count; i++) {
+                        const batch& b = info_p->batches[i];
+                        cull_constants cc = {};
+                        const camera_data& camera = info_p->cameras[b.pc.camera];
+                        vml::frustum f = vml::extract_frustum(camera.p * camera.v);
+                        for (int j = 0; j < 6; j++) {
+                            cc.planes[j] = f[j];
+                        }
+                        cc.first_command = b.first_command;
+                        cc.command_count = b.command_count;
+                        cc.count_index = i;
+                        vulkan_wrapper::push_constants(info_p->cull_pl.layout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(cull_constants), &cc);
+                        vulkan_wrapper::dispatch(1, 1, 1);
+                    }
+                    vulkan_wrapper::end_async_compute(vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexShader | vk::PipelineStageFlagBits::eFragmentShader);
+                }
+            }
+
+            vulkan_wrapper::begin_render_pass(statics);
+            if (statics) {
+                vulkan_wrapper::execute_cached_commands(frame.statics.cached);
+                vulkan_wrapper::begin_secondary_commands();
+            }
+            if (uploaded) {
+                // Every graphics pipeline layout is compatible, so the sets are bound once for the whole frame
+                std::array<vk::DescriptorSet, 2> sets = {frame.set, frame.texture_set};
+                bool bound = false;
+                for (uint32_t i = 0; i < batch_count; i++) {
+                    const batch& b = info_p->batches[i];
+                    if (b.command_count == 0) {
+                        continue;
+                    }
+                    vulkan_wrapper::bind_pipeline(b.pass_pl);
+                    if (!bound) {
+                        vulkan_wrapper::bind_descriptor_sets(b.pl->layout, 0, static_cast<uint32_t>(sets.size()), sets.data());
+                        bound = true;
+                    }
+                    bind_geometry(b.geom);
+                    vulkan_wrapper::push_constants(b.pl->layout, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0, sizeof(push_constants), &b.pc);
+                    if (mode == cull_mode::gpu) {
+                        vulkan_wrapper::draw_indexed_indirect_count(frame.culled, sizeof(vk::DrawIndexedIndirectCommand) * b.first_command, frame.counts, sizeof(uint32_t) * i, b.command_count, sizeof(vk::DrawIndexedIndirectCommand));
+                    }
+                    else {
+                        vulkan_wrapper::draw_indexed_indirect(frame.commands.buffer, frame.commands.offset + sizeof(vk::DrawIndexedIndirectCommand) * b.first_command, b.command_count, sizeof(vk::DrawIndexedIndirectCommand));
+                    }
+                }
+            }
+            if (statics) {
+                vulkan_wrapper::end_secondary_commands();
+            }
+
+            info_p->draws.clear();
+            info_p->commands.clear();
+            info_p->batches.clear();
+            info_p->lights.clear();
+            info_p->cameras.clear();
+            info_p->shadow_views.clear();
+            info_p->shadow_commands.clear();
+            info_p->shadow_batches.clear();
+            info_p->static_draws.clear();
+            info_p->static_commands.clear();
+            info_p->static_batches.clear();
+            info_p->camera_dirty = true;
+            info_p->batch_dirty = true;
+            // Meshes registered and buffers grown while recording are drawn from the next frame
+            mesh_manager::update();
         }
 
         /**
@@ -242,14 +1296,26 @@ namespace render::render_manager {
          * @return successful or not
          */
         bool load_shaders() {
+            // Every layout drawn so far is loaded now so that reloading does not stall the next frames
             for (const std::pair<const std::string, uint32_t>& nPair : info_p->name_id_map) {
-                pipeline pl;
-                if (!load_pipeline(nPair.first, pl)) {
-                    unload_shaders();
-                    return false;
+                for (uint32_t layout : info_p->layouts) {
+                    pipeline pl;
+                    if (!load_pipeline(nPair.first, layout, pl)) {
+                        unload_shaders();
+                        return false;
+                    }
+                    info_p->id_pipeline_map.insert({{nPair.second, layout}, pl});
                 }
-                info_p->id_pipeline_map.insert(std::pair<const uint32_t, pipeline>(nPair.second, pl));
             }
+            // The cull pipeline is optional, without it culling happens on the CPU
+            info_p->cull_loaded = load_compute_pipeline("cull", info_p->cull_set_layout, sizeof(cull_constants), info_p->cull_pl);
+            // As is the shadow pipeline, without it modules keep to projected shadows. Later layouts are loaded as drawn
+            pipeline shadow_pl;
+            info_p->shadow_loaded = load_shadow_pipeline(info_p->layouts.front(), shadow_pl);
+            if (info_p->shadow_loaded) {
+                info_p->shadow_pls.insert({info_p->layouts.front(), shadow_pl});
+            }
+            info_p->render_pass_version = vulkan_wrapper::get_render_pass_version();
             return (info_p->loaded = true);
         }
 
@@ -257,14 +1323,30 @@ namespace render::render_manager {
          * unload_shaders - Unload Shaders function destroys all pipelines that have been loaded
          */
         void unload_shaders() {
-            for (const std::pair<const uint32_t, pipeline>& pPair : info_p->id_pipeline_map) {
-                vulkan_wrapper::destroy_pipeline_layout(pPair.second.layout);
-                vulkan_wrapper::destroy_pipeline(pPair.second.pl);
+            info_p->current_pl = nullptr;
+            info_p->batches.clear();
+            info_p->static_batches.clear();
+            info_p->shadow_commands.clear();
+            info_p->shadow_batches.clear();
+            info_p->pipeline_version++;
+            // Frames still in flight may use the pipelines, they are destroyed once those frames have finished
+            for (const std::pair<const std::pair<uint32_t, uint32_t>, pipeline>& pPair : info_p->id_pipeline_map) {
+                defer_destroy_pipeline(pPair.second);
             }
             info_p->id_pipeline_map.clear();
+            if (info_p->cull_loaded) {
+                vulkan_wrapper::defer_destroy(info_p->cull_pl.pl);
+                vulkan_wrapper::defer_destroy(info_p->cull_pl.layout);
+                info_p->cull_loaded = false;
+            }
+            for (const std::pair<const uint32_t, pipeline>& pPair : info_p->shadow_pls) {
+                defer_destroy_pipeline(pPair.second);
+            }
+            info_p->shadow_pls.clear();
+            info_p->shadow_loaded = false;
             info_p->loaded = false;
         }
-        // Function to reload all pipelines, not used
+        // Function to reload all pipelines, safe while frames are in flight as the old pipelines are destroyed later
         bool reload_shaders() {
             unload_shaders();
             return load_shaders();
@@ -277,7 +1359,18 @@ namespace render::render_manager {
                 unload_shaders();
             }
             delete[] info_p->offsets;
-            vulkan_wrapper::destroy_vertex_buffer(info_p->rect_2D, info_p->rect_2D_memory);
+            for (frame_resources& frame : info_p->frames) {
+                destroy_frame(frame);
+            }
+            if (info_p->shadow_target_created || info_p->shadow_target_placeholder) {
+                vulkan_wrapper::destroy_depth_target(info_p->shadow_target);
+            }
+            vulkan_wrapper::destroy_sampler(info_p->shadow_sampler);
+            vulkan_wrapper::destroy_descriptor_pool(info_p->texture_pool);
+            vulkan_wrapper::destroy_descriptor_set_layout(info_p->texture_set_layout);
+            vulkan_wrapper::destroy_descriptor_pool(info_p->descriptor_pool);
+            vulkan_wrapper::destroy_descriptor_set_layout(info_p->cull_set_layout);
+            vulkan_wrapper::destroy_descriptor_set_layout(info_p->draw_set_layout);
             info_p->name_id_map.clear();
             info_p.reset(nullptr);
         }
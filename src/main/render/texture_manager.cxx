@@ -0,0 +1,480 @@
+#include "render/texture_manager.hxx"
+
+#include "resource/resource_manager.hxx"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+/**
+ * render::texture_manager - Texture Manager namespace streams textures from PNG files: worker threads decode them
+ * straight into pooled staging memory, a small copy is made resident first and the full size image follows once the
+ * residency budget allows. Nothing here ever waits for a decode or an upload, a texture samples as plain white until
+ * its first image is ready
+ */
+namespace render::texture_manager {
+    namespace {
+        // Textures are first made resident as a copy no larger than this, the full size image follows later
+        const uint32_t LOW_SIZE = 64;
+        // A full size image unused for this many frames may be evicted to make room for another
+        const uint64_t EVICT_FRAMES = 120;
+        // Full size uploads started per frame, so streaming never floods a single frame
+        const uint32_t FULL_UPLOADS_PER_FRAME = 1;
+        const vk::DeviceSize DEFAULT_BUDGET = 256U << 20U;
+
+        // Work for the decode threads, the low copy is only asked for on the first load
+        struct job {
+            uint32_t id;
+            std::string name;
+            bool low;
+        };
+        // A decoded texture waiting to be uploaded. low holds a box filtered copy no larger than LOW_SIZE, or the
+        // whole texture if it is already that small (full is then empty)
+        struct decoded {
+            uint32_t id = 0;
+            bool ok = false;
+            uint32_t width = 0;
+            uint32_t height = 0;
+            vulkan_wrapper::staging_buffer full;
+            uint32_t low_width = 0;
+            uint32_t low_height = 0;
+            vulkan_wrapper::staging_buffer low;
+        };
+
+        // A texture slot, the full size image is sampled once ready and the low copy until then. Upload values are the
+        // frame an image was uploaded in, its mips are generated the frame after (once the upload has been acquired).
+        // The version is the descriptor version the slot last changed image in
+        struct texture {
+            std::string name;
+            vk::Sampler sampler;
+            uint32_t width = 0;
+            uint32_t height = 0;
+            vulkan_wrapper::texture_image low;
+            vulkan_wrapper::texture_image full;
+            uint64_t low_upload = 0;
+            uint64_t full_upload = 0;
+            bool low_ready = false;
+            bool full_ready = false;
+            bool loading = false;
+            uint64_t last_used = 0;
+            uint32_t version = 1;
+        };
+
+        // Structure inside of an anonymous namespace to provide a 'private' storage
+        struct info {
+            // Slot 0 is the white texture, the rest are indexed by texture id
+            std::vector<texture> textures;
+            std::map<std::string, uint32_t> name_id_map;
+            std::map<sampler_desc, vk::Sampler> samplers;
+            vulkan_wrapper::texture_image white;
+
+            // Frames seen by update, the descriptor version changes whenever a slot changes image. Slots past the
+            // loaded textures are white from version 1
+            uint32_t capacity = 1;
+            uint64_t frame = 0;
+            uint32_t version = 1;
+            vk::DeviceSize budget = DEFAULT_BUDGET;
+            vk::DeviceSize resident = 0;
+            std::deque<decoded> pending_full;
+
+            // Decode threads, jobs and results are guarded by the mutex
+            std::vector<std::thread> threads;
+            std::mutex mutex;
+            std::condition_variable jobs_ready;
+            std::deque<job> jobs;
+            std::vector<decoded> results;
+            bool stop = false;
+        };
+        std::unique_ptr<info> info_p;
+
+        // Number of mips down to 1x1 for the given size
+        uint32_t mip_levels(uint32_t width, uint32_t height) {
+            uint32_t levels = 1;
+            for (uint32_t size = std::max(width, height); size > 1; size /= 2) {
+                levels++;
+            }
+            return levels;
+        }
+        // Memory a full size image with mips is expected to need, before it exists
+        vk::DeviceSize full_size(const texture& t) {
+            return static_cast<vk::DeviceSize>(t.width) * t.height * 4 * 4 / 3;
+        }
+        // Whether the texture is larger than its low copy, i.e has a full size image to stream
+        bool has_full(const texture& t) {
+            return std::max(t.width, t.height) > LOW_SIZE;
+        }
+
+        /**
+         * decode - Decode function reads a PNG into a staging buffer and, if asked, makes the low copy by averaging
+         * each block of pixels that shrinks the largest side to LOW_SIZE. Runs on the decode threads
+         * @param j - job to do
+         * @return - the decoded texture, ok is false (and nothing held) if the file could not be read
+         */
+        decoded decode(const job& j) {
+            decoded d;
+            d.id = j.id;
+            bool read = resource::resource_manager::read_png_file(j.name, {"textures"}, [&d](uint32_t width, uint32_t height) -> void* {
+                d.width = width;
+                d.height = height;
+                return vulkan_wrapper::acquire_staging(static_cast<vk::DeviceSize>(width) * height * 4, d.full) ? d.full.data : nullptr;
+            });
+            if (!read) {
+                vulkan_wrapper::release_staging(d.full);
+                d.full = {};
+                return d;
+            }
+            if (j.low && std::max(d.width, d.height) <= LOW_SIZE) {
+                d.low = d.full;
+                d.low_width = d.width;
+                d.low_height = d.height;
+                d.full = {};
+            }
+            else if (j.low) {
+                uint32_t factor = 1;
+                while (std::max(d.width, d.height) / factor > LOW_SIZE) {
+                    factor *= 2;
+                }
+                d.low_width = std::max(d.width / factor, 1U);
+                d.low_height = std::max(d.height / factor, 1U);
+                if (!vulkan_wrapper::acquire_staging(static_cast<vk::DeviceSize>(d.low_width) * d.low_height * 4, d.low)) {
+                    vulkan_wrapper::release_staging(d.full);
+                    d.full = {};
+                    return d;
+                }
+                const auto* src = static_cast<const uint8_t*>(d.full.data);
+                auto* dst = static_cast<uint8_t*>(d.low.data);
+                for (uint32_t y = 0; y < d.low_height; y++) {
+                    for (uint32_t x = 0; x < d.low_width; x++) {
+                        uint32_t sum[4] = {0, 0, 0, 0};
+                        for (uint32_t fy = 0; fy < factor; fy++) {
+                            const uint8_t* row = src + static_cast<size_t>(std::min(y * factor + fy, d.height - 1)) * d.width * 4;
+                            for (uint32_t fx = 0; fx < factor; fx++) {
+                                const uint8_t* pixel = row + static_cast<size_t>(std::min(x * factor + fx, d.width - 1)) * 4;
+                                for (int c = 0; c < 4; c++) {
+                                    sum[c] += pixel[c];
+                                }
+                            }
+                        }
+                        for (int c = 0; c < 4; c++) {
+                            dst[(static_cast<size_t>(y) * d.low_width + x) * 4 + c] = static_cast<uint8_t>(sum[c] / (factor * factor));
+                        }
+                    }
+                }
+            }
+            d.ok = true;
+            return d;
+        }
+        // Body of every decode thread, takes jobs until terminate
+        void decode_thread() {
+            while (true) {
+                job j;
+                {
+                    std::unique_lock<std::mutex> lock(info_p->mutex);
+                    info_p->jobs_ready.wait(lock, [] { return info_p->stop || !info_p->jobs.empty(); });
+                    if (info_p->stop) {
+                        return;
+                    }
+                    j = std::move(info_p->jobs.front());
+                    info_p->jobs.pop_front();
+                }
+                decoded d = decode(j);
+                std::lock_guard<std::mutex> lock(info_p->mutex);
+                info_p->results.push_back(d);
+            }
+        }
+        // Hands a job to the decode threads
+        void queue_job(uint32_t id, bool low) {
+            info_p->textures[id].loading = true;
+            {
+                std::lock_guard<std::mutex> lock(info_p->mutex);
+                info_p->jobs.push_back({id, info_p->textures[id].name, low});
+            }
+            info_p->jobs_ready.notify_one();
+        }
+
+        /**
+         * upload_texture - Upload Texture function creates an image with a full mip chain and uploads the first level
+         * from the staging buffer, leaving it ready for generate_mipmaps next frame
+         * @param image - returns the image
+         * @param staging - staging buffer holding the pixels, handed over to the upload (or released on failure)
+         * @param width - width of the pixels
+         * @param height - height of the pixels
+         * @return - successful or not
+         */
+        bool upload_texture(vulkan_wrapper::texture_image& image, const vulkan_wrapper::staging_buffer& staging, uint32_t width, uint32_t height) {
+            if (!vulkan_wrapper::create_texture_image(image, width, height, mip_levels(width, height))) {
+                vulkan_wrapper::release_staging(staging);
+                image = {};
+                return false;
+            }
+            vk::BufferImageCopy region = {0, 0, 0, {vk::ImageAspectFlagBits::eColor, 0, 0, 1}, {0, 0, 0}, {width, height, 1}};
+            vk::ImageSubresourceRange range = {vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1};
+            if (!vulkan_wrapper::upload_image(image.image, staging, 1, &region, range, vk::ImageLayout::eTransferSrcOptimal, vk::PipelineStageFlagBits::eTransfer, vk::AccessFlagBits::eTransferRead)) {
+                vulkan_wrapper::destroy_texture_image(image);
+                image = {};
+                return false;
+            }
+            return true;
+        }
+
+        /**
+         * make_room - Make Room function evicts the least recently used full size images, among those unused for
+         * EVICT_FRAMES, until the given size fits in the residency budget. Evicted textures fall back to their low copy
+         * @param size - size (in bytes) needed
+         * @param keep - texture id which must not be evicted
+         * @return - whether it fits
+         */
+        bool make_room(vk::DeviceSize size, uint32_t keep) {
+            while (info_p->resident + size > info_p->budget) {
+                texture* victim = nullptr;
+                for (uint32_t i = 1; i < info_p->textures.size(); i++) {
+                    texture& t = info_p->textures[i];
+                    if (i != keep && t.full_ready && t.last_used + EVICT_FRAMES < info_p->frame && (!victim || t.last_used < victim->last_used)) {
+                        victim = &t;
+                    }
+                }
+                if (!victim) {
+                    return false;
+                }
+                vulkan_wrapper::defer_destroy(victim->full);
+                info_p->resident -= victim->full.size;
+                victim->full = {};
+                victim->full_ready = false;
+                victim->version = ++info_p->version;
+            }
+            return true;
+        }
+    }
+
+    // Orders sampler descriptions so they can key the sampler cache
+    bool sampler_desc::operator<(const sampler_desc& other) const {
+        return std::tie(filter, address, mipmaps) < std::tie(other.filter, other.address, other.mipmaps);
+    }
+
+    /**
+     * init - Init function sizes the descriptor array for the device, creates the white texture in slot 0 and starts
+     * the decode threads
+     * @param thread_count - number of decode threads
+     */
+    void init(uint32_t thread_count) {
+        info_p = std::make_unique<info>();
+        // One sampler of the fragment stage is taken by the shadow maps
+        uint32_t limit = vulkan_wrapper::get_max_sampled_images();
+        info_p->capacity = std::max(std::min(vulkan_wrapper::supports_descriptor_indexing() ? MAX_TEXTURES : FALLBACK_TEXTURES, limit > 1 ? limit - 1 : 1), 1U);
+        static const uint8_t white[4] = {255, 255, 255, 255};
+        if (vulkan_wrapper::create_texture_image(info_p->white, 1, 1, 1)) {
+            vulkan_wrapper::upload_image(info_p->white.image, vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1), vk::Extent3D(1, 1, 1), sizeof(white), white, vk::ImageLayout::eShaderReadOnlyOptimal,
+                                         vk::PipelineStageFlagBits::eFragmentShader, vk::AccessFlagBits::eShaderRead);
+        }
+        info_p->textures.emplace_back();
+        info_p->textures[0].sampler = get_sampler(sampler_desc());
+        for (uint32_t i = 0; i < std::max(thread_count, 1U); i++) {
+            info_p->threads.emplace_back(decode_thread);
+        }
+    }
+
+    /**
+     * load - Load function starts streaming the given PNG (from the textures folder), loading the same name twice
+     * returns the same texture. Returns straight away, the texture is white until its first image is ready
+     * @param name - file name
+     * @param sampler - how the texture is sampled, only used on the first load
+     * @return - texture id, or 0 (white) if every slot is taken
+     */
+    uint32_t load(const std::string& name, const sampler_desc& sampler) {
+        auto it = info_p->name_id_map.find(name);
+        if (it != info_p->name_id_map.end()) {
+            return it->second;
+        }
+        if (info_p->textures.size() >= info_p->capacity) {
+            return 0;
+        }
+        auto id = static_cast<uint32_t>(info_p->textures.size());
+        info_p->textures.emplace_back();
+        info_p->textures[id].name = name;
+        info_p->textures[id].sampler = get_sampler(sampler);
+        info_p->textures[id].version = ++info_p->version;
+        info_p->name_id_map.insert(std::pair<const std::string, uint32_t>(name, id));
+        queue_job(id, true);
+        return id;
+    }
+    // Marks the texture as used this frame, textures in use are brought to full size and are not evicted
+    void use(uint32_t id) {
+        if (id > 0 && id < info_p->textures.size()) {
+            info_p->textures[id].last_used = info_p->frame;
+        }
+    }
+
+    /**
+     * update - Update function moves streaming along once per frame, before the render pass: mips are generated for
+     * images uploaded last frame, finished decodes are uploaded (low copies straight away, full size images a few per
+     * frame) and textures used last frame are queued for their full size image if it fits the budget
+     */
+    void update() {
+        info_p->frame++;
+        for (texture& t : info_p->textures) {
+            if (t.low_upload > 0 && t.low_upload < info_p->frame) {
+                vulkan_wrapper::generate_mipmaps(t.low);
+                t.low_upload = 0;
+                t.low_ready = true;
+                t.version = ++info_p->version;
+            }
+            if (t.full_upload > 0 && t.full_upload < info_p->frame) {
+                vulkan_wrapper::generate_mipmaps(t.full);
+                t.full_upload = 0;
+                t.full_ready = true;
+                t.version = ++info_p->version;
+            }
+        }
+
+        std::vector<decoded> results;
+        {
+            std::lock_guard<std::mutex> lock(info_p->mutex);
+            results.swap(info_p->results);
+        }
+        for (const decoded& d : results) {
+            texture& t = info_p->textures[d.id];
+            t.loading = false;
+            if (!d.ok) {
+                continue;
+            }
+            t.width = d.width;
+            t.height = d.height;
+            if (d.low.buffer && upload_texture(t.low, d.low, d.low_width, d.low_height)) {
+                t.low_upload = info_p->frame;
+            }
+            // The full size image waits its turn, it stays loading until then
+            if (d.full.buffer) {
+                t.loading = true;
+                info_p->pending_full.push_back(d);
+            }
+        }
+
+        for (uint32_t n = 0; n < FULL_UPLOADS_PER_FRAME && !info_p->pending_full.empty(); n++) {
+            decoded d = info_p->pending_full.front();
+            info_p->pending_full.pop_front();
+            texture& t = info_p->textures[d.id];
+            t.loading = false;
+            // upload_texture takes the staging buffer either way, it is only released here if never handed over
+            if (t.full.image || !make_room(full_size(t), d.id)) {
+                vulkan_wrapper::release_staging(d.full);
+            }
+            else if (upload_texture(t.full, d.full, d.width, d.height)) {
+                t.full_upload = info_p->frame;
+                info_p->resident += t.full.size;
+            }
+        }
+
+        for (uint32_t i = 1; i < info_p->textures.size(); i++) {
+            texture& t = info_p->textures[i];
+            if (t.low_ready && !t.full.image && !t.loading && has_full(t) && t.last_used + 1 >= info_p->frame && make_room(full_size(t), i)) {
+                queue_job(i, false);
+            }
+        }
+    }
+
+    /**
+     * get_sampler - Get Sampler function returns the sampler for the given description, creating it the first time
+     * @param desc - filtering and addressing
+     * @return - sampler shared by every texture with the same description
+     */
+    vk::Sampler get_sampler(const sampler_desc& desc) {
+        auto it = info_p->samplers.find(desc);
+        if (it != info_p->samplers.end()) {
+            return it->second;
+        }
+        vk::SamplerMipmapMode mipmap_mode = desc.filter == vk::Filter::eLinear ? vk::SamplerMipmapMode::eLinear : vk::SamplerMipmapMode::eNearest;
+        vk::SamplerCreateInfo sampler_create_info = {vk::SamplerCreateFlags(), desc.filter, desc.filter, mipmap_mode, desc.address, desc.address, desc.address,
+                                                     0.0F, VK_FALSE, 1.0F, VK_FALSE, vk::CompareOp::eAlways, 0.0F, desc.mipmaps ? VK_LOD_CLAMP_NONE : 0.0F, vk::BorderColor::eFloatOpaqueWhite, VK_FALSE};
+        vk::Sampler sampler;
+        vulkan_wrapper::create_sampler(sampler, sampler_create_info);
+        info_p->samplers.insert(std::pair<const sampler_desc, vk::Sampler>(desc, sampler));
+        return sampler;
+    }
+    // Set how much memory full size images may use, anything over is evicted as textures fall out of use
+    void set_residency_budget(vk::DeviceSize budget) {
+        info_p->budget = budget;
+    }
+    // Returns how much memory the full size images use
+    vk::DeviceSize get_resident_size() {
+        return info_p->resident;
+    }
+
+    // Returns the number of slots in the descriptor array, at most MAX_TEXTURES (or FALLBACK_TEXTURES)
+    uint32_t get_capacity() {
+        return info_p->capacity;
+    }
+    // Returns the descriptor version, it changes whenever a slot's image changes and the descriptors must be rewritten
+    uint32_t get_version() {
+        return info_p->version;
+    }
+    /**
+     * get_descriptors - Get Descriptors function fills the image info of every slot which changed image after the
+     * given version, in slot order: the full size image if ready, the low copy if not, otherwise white
+     * @param since - descriptor version the caller last wrote, 0 for every slot
+     * @param slots - returns the slot of each image info, get_capacity entries
+     * @param infos - returns the image infos, get_capacity entries
+     * @return - number of slots filled
+     */
+    uint32_t get_descriptors(uint32_t since, uint32_t* slots, vk::DescriptorImageInfo* infos) {
+        uint32_t count = 0;
+        for (uint32_t i = 0; i < info_p->capacity; i++) {
+            vk::ImageView view = info_p->white.view;
+            vk::Sampler sampler = info_p->textures[0].sampler;
+            uint32_t version = 1;
+            if (i < info_p->textures.size()) {
+                const texture& t = info_p->textures[i];
+                sampler = t.sampler;
+                view = t.full_ready ? t.full.view : t.low_ready ? t.low.view : view;
+                version = t.version;
+            }
+            if (version > since) {
+                slots[count] = i;
+                infos[count++] = {sampler, view, vk::ImageLayout::eShaderReadOnlyOptimal};
+            }
+        }
+        return count;
+    }
+
+    /**
+     * terminate - Terminate function stops the decode threads and destroys every texture and sampler, the device must
+     * be idle
+     */
+    void terminate() {
+        {
+            std::lock_guard<std::mutex> lock(info_p->mutex);
+            info_p->stop = true;
+        }
+        info_p->jobs_ready.notify_all();
+        for (std::thread& thread : info_p->threads) {
+            thread.join();
+        }
+        for (const decoded& d : info_p->results) {
+            vulkan_wrapper::release_staging(d.full);
+            vulkan_wrapper::release_staging(d.low);
+        }
+        for (const decoded& d : info_p->pending_full) {
+            vulkan_wrapper::release_staging(d.full);
+        }
+        for (const texture& t : info_p->textures) {
+            if (t.low.image) {
+                vulkan_wrapper::destroy_texture_image(t.low);
+            }
+            if (t.full.image) {
+                vulkan_wrapper::destroy_texture_image(t.full);
+            }
+        }
+        if (info_p->white.image) {
+            vulkan_wrapper::destroy_texture_image(info_p->white);
+        }
+        for (const std::pair<const sampler_desc, vk::Sampler>& sPair : info_p->samplers) {
+            vulkan_wrapper::destroy_sampler(sPair.second);
+        }
+        info_p.reset(nullptr);
+    }
+}
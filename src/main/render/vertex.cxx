@@ -0,0 +1,191 @@
+#include "render/vertex.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+/**
+ * render::vertex - Vertex functions describe and fill interleaved vertex buffers for any vertex_layout, they do not
+ * depend on Vulkan so meshes can be packed away from the renderer
+ */
+namespace render {
+    namespace {
+        // Returns the nearest half precision float to the given value (rounding to even), too large becomes infinity
+        uint16_t to_half(float value) {
+            uint32_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            const uint32_t sign = (bits >> 16U) & 0x8000U;
+            const int32_t exponent = static_cast<int32_t>((bits >> 23U) & 0xFFU) - 127 + 15;
+            uint32_t mantissa = bits & 0x7FFFFFU;
+            if (((bits >> 23U) & 0xFFU) == 0xFFU) {
+                return static_cast<uint16_t>(sign | 0x7C00U | (mantissa ? 0x200U : 0U));
+            }
+            if (exponent >= 31) {
+                return static_cast<uint16_t>(sign | 0x7C00U);
+            }
+            // Too small for a normal half, keep what fits of the mantissa (including its implicit 1) as a subnormal
+            uint32_t shift = 13;
+            uint32_t half = sign | (static_cast<uint32_t>(std::max(exponent, 0)) << 10U);
+            if (exponent <= 0) {
+                if (exponent < -10) {
+                    return static_cast<uint16_t>(sign);
+                }
+                mantissa |= 0x800000U;
+                shift = static_cast<uint32_t>(14 - exponent);
+            }
+            half |= mantissa >> shift;
+            // A carry out of the mantissa correctly moves up to the next exponent
+            const uint32_t remainder = mantissa & ((1U << shift) - 1U);
+            const uint32_t halfway = 1U << (shift - 1U);
+            if (remainder > halfway || (remainder == halfway && (half & 1U))) {
+                half++;
+            }
+            return static_cast<uint16_t>(half);
+        }
+
+        // Write the given value (of count components) in the given format, components the value lacks are 0
+        void pack_attribute(vertex_format format, const float* value, uint32_t count, uint8_t* dst) {
+            float v[4] = {};
+            std::copy(value, value + std::min(count, 4U), v);
+            switch (format) {
+                case vertex_format::float2:
+                    memcpy(dst, v, sizeof(float) * 2);
+                    break;
+                case vertex_format::float3:
+                    memcpy(dst, v, sizeof(float) * 3);
+                    break;
+                case vertex_format::snorm8x4:
+                    for (int i = 0; i < 4; i++) {
+                        dst[i] = static_cast<uint8_t>(static_cast<int8_t>(std::lround(std::clamp(v[i], -1.0F, 1.0F) * 127.0F)));
+                    }
+                    break;
+                case vertex_format::snorm16x4:
+                    for (int i = 0; i < 4; i++) {
+                        auto c = static_cast<int16_t>(std::lround(std::clamp(v[i], -1.0F, 1.0F) * 32767.0F));
+                        memcpy(dst + i * sizeof(int16_t), &c, sizeof(int16_t));
+                    }
+                    break;
+                case vertex_format::unorm16x2:
+                    for (int i = 0; i < 2; i++) {
+                        auto c = static_cast<uint16_t>(std::lround(std::clamp(v[i], 0.0F, 1.0F) * 65535.0F));
+                        memcpy(dst + i * sizeof(uint16_t), &c, sizeof(uint16_t));
+                    }
+                    break;
+                case vertex_format::half2:
+                    for (int i = 0; i < 2; i++) {
+                        uint16_t c = to_half(v[i]);
+                        memcpy(dst + i * sizeof(uint16_t), &c, sizeof(uint16_t));
+                    }
+                    break;
+            }
+        }
+    }
+
+    // Returns the format the given attribute is stored in
+    vertex_format vertex_layout::get_format(vertex_attribute attribute) const {
+        switch (attribute) {
+            case vertex_attribute::position:
+                return position;
+            case vertex_attribute::uv:
+                return uv;
+            default:
+                return normal;
+        }
+    }
+    // Returns the offset (in bytes) of the given attribute within a vertex, attributes are stored in order
+    uint32_t vertex_layout::get_offset(vertex_attribute attribute) const {
+        uint32_t offset = 0;
+        for (uint32_t i = 0; i < static_cast<uint32_t>(attribute); i++) {
+            offset += get_format_size(get_format(static_cast<vertex_attribute>(i)));
+        }
+        return offset;
+    }
+    // Returns the size (in bytes) of one vertex
+    uint32_t vertex_layout::get_stride() const {
+        return get_offset(static_cast<vertex_attribute>(VERTEX_ATTRIBUTE_COUNT));
+    }
+    bool vertex_layout::operator==(const vertex_layout& other) const {
+        return position == other.position && uv == other.uv && normal == other.normal;
+    }
+
+    // Returns the size (in bytes) of one attribute stored in the given format
+    uint32_t get_format_size(vertex_format format) {
+        switch (format) {
+            case vertex_format::float2:
+                return sizeof(float) * 2;
+            case vertex_format::float3:
+                return sizeof(float) * 3;
+            case vertex_format::snorm16x4:
+                return sizeof(int16_t) * 4;
+            default:
+                return 4;
+        }
+    }
+
+    /**
+     * get_compact_layout - Get Compact Layout function returns the smallest layout which stores the given mesh without
+     * visible loss: positions as snorm16 relative to the mesh's bounds, uvs as unorm16 if they all lie within 0 - 1
+     * (half floats otherwise, for tiling) and normals as snorm8. 16 bytes a vertex instead of 24
+     * @param data - mesh to store
+     * @return - the layout
+     */
+    vertex_layout get_compact_layout(const mesh_data& data) {
+        vertex_layout layout;
+        layout.position = vertex_format::snorm16x4;
+        bool unit_uvs = std::all_of(data.uvs.begin(), data.uvs.end(), [](const vml::vec2& uv) { return uv[0] >= 0.0F && uv[0] <= 1.0F && uv[1] >= 0.0F && uv[1] <= 1.0F; });
+        layout.uv = unit_uvs ? vertex_format::unorm16x2 : vertex_format::half2;
+        layout.normal = vertex_format::snorm8x4;
+        return layout;
+    }
+
+    /**
+     * get_quantisation - Get Quantisation function returns how the positions of the given mesh are stored in the given
+     * layout. Normalised positions are centred on the mesh's bounds and scaled by the largest half extent so the mesh
+     * fills -1 - 1 along its longest axis, float positions are stored as they are
+     * @param data - mesh to store
+     * @param layout - layout it is stored in
+     * @return - the quantisation, model space position = offset + scale * stored
+     */
+    vertex_quantisation get_quantisation(const mesh_data& data, const vertex_layout& layout) {
+        vertex_quantisation quantisation;
+        if ((layout.position != vertex_format::snorm8x4 && layout.position != vertex_format::snorm16x4) || data.positions.empty()) {
+            return quantisation;
+        }
+        vml::vec3 min = data.positions[0];
+        vml::vec3 max = data.positions[0];
+        for (const vml::vec3& position : data.positions) {
+            for (int i = 0; i < 3; i++) {
+                min[i] = std::min(min[i], position[i]);
+                max[i] = std::max(max[i], position[i]);
+            }
+        }
+        quantisation.offset = (min + max) / 2.0F;
+        float extent = std::max({max[0] - min[0], max[1] - min[1], max[2] - min[2]}) / 2.0F;
+        quantisation.scale = extent > 0.0F ? extent : 1.0F;
+        return quantisation;
+    }
+
+    /**
+     * pack_vertices - Pack Vertices function interleaves the attributes of every vertex of the mesh in the given layout
+     * @param data - mesh to pack, missing normals and uvs are packed as +z and 0
+     * @param layout - layout to pack into
+     * @param quantisation - how positions are stored, see get_quantisation
+     * @param dst - returns the vertices, must hold positions.size() * layout.get_stride() bytes
+     */
+    void pack_vertices(const mesh_data& data, const vertex_layout& layout, const vertex_quantisation& quantisation, uint8_t* dst) {
+        const uint32_t stride = layout.get_stride();
+        const uint32_t uv_offset = layout.get_offset(vertex_attribute::uv);
+        const uint32_t normal_offset = layout.get_offset(vertex_attribute::normal);
+        const vml::vec2 default_uv;
+        const vml::vec3 default_normal(0.0F, 0.0F, 1.0F);
+        for (size_t i = 0; i < data.positions.size(); i++) {
+            uint8_t* vertex = dst + i * stride;
+            const vml::vec2& uv = i < data.uvs.size() ? data.uvs[i] : default_uv;
+            const vml::vec3& normal = i < data.normals.size() ? data.normals[i] : default_normal;
+            vml::vec3 position = (data.positions[i] - quantisation.offset) / quantisation.scale;
+            pack_attribute(layout.position, &position[0], 3, vertex);
+            pack_attribute(layout.uv, &uv[0], 2, vertex + uv_offset);
+            pack_attribute(layout.normal, &normal[0], 3, vertex + normal_offset);
+        }
+    }
+}
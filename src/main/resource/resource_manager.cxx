@@ -1,10 +1,14 @@
 #include "resource/resource_manager.hxx"
 
+#include "platform/platform.hxx"
+
 #include <memory>
 #include <fstream>
+#include <png.h>
 
 /**
- * resource::resource_manager - Resource Manager namespace is used to read binary files for pipeline loading
+ * resource::resource_manager - Resource Manager namespace is used to read binary files for pipeline loading, to map
+ * files which are used in place (such as scenes) and to decode images
  */
 namespace resource::resource_manager {
     namespace {
@@ -13,7 +17,47 @@ namespace resource::resource_manager {
             char separator = 0;
         };
         std::unique_ptr<info> info_p;
+
+        // Full path of a file in the given folders of the resource folder
+        std::string get_path(const std::string& file_name, const std::vector<std::string>& folders) {
+            std::string full_path = info_p->folder;
+            for (const std::string& d : folders) {
+                full_path = full_path.append(d).append(&info_p->separator, 1);
+            }
+            return full_path.append(file_name);
+        }
+    }
+
+    mapped_file::mapped_file(const void* data, size_t size) : address(data), length(size) {}
+    mapped_file::mapped_file(mapped_file&& other) noexcept : address(other.address), length(other.length) {
+        other.address = nullptr;
+        other.length = 0;
+    }
+    mapped_file& mapped_file::operator=(mapped_file&& other) noexcept {
+        if (this != &other) {
+            if (address) {
+                platform::files::unmap_file(address, length);
+            }
+            address = other.address;
+            length = other.length;
+            other.address = nullptr;
+            other.length = 0;
+        }
+        return *this;
     }
+    mapped_file::~mapped_file() {
+        if (address) {
+            platform::files::unmap_file(address, length);
+        }
+    }
+    // Start of the file, nullptr if nothing is mapped
+    const uint8_t* mapped_file::data() const {
+        return static_cast<const uint8_t*>(address);
+    }
+    size_t mapped_file::size() const {
+        return length;
+    }
+
     void init(const std::string& folder, char separator) {
         info_p = std::make_unique<info>();
         info_p->folder = folder;
@@ -26,12 +70,7 @@ namespace resource::resource_manager {
      * @return - vector of bytes that have been read
      */
     std::vector<uint8_t> read_binary_file(const std::string& file_name, const std::vector<std::string>& folders) {
-        std::string full_path = info_p->folder;
-        for (const std::string& d : folders) {
-            full_path = full_path.append(d).append(&info_p->separator, 1);
-        }
-        full_path = full_path.append(file_name);
-        std::ifstream file(full_path, std::ios::ate | std::ios::binary);
+        std::ifstream file(get_path(file_name, folders), std::ios::ate | std::ios::binary);
         if (!file.is_open()) {
             return {};
         }
@@ -41,4 +80,44 @@ namespace resource::resource_manager {
         file.read((char*)buffer.data(), file_size);
         return buffer;
     }
+    /**
+     * map_file - Map File function maps a whole file read only into memory instead of reading it, so it can be used in
+     * place and only the parts touched are read from disk. The mapping is page aligned
+     * @param file_name - file name to map
+     * @param folders - parent folders
+     * @return - the mapped file, empty if it could not be mapped
+     */
+    mapped_file map_file(const std::string& file_name, const std::vector<std::string>& folders) {
+        size_t size = 0;
+        const void* data = platform::files::map_file(get_path(file_name, folders), size);
+        return data ? mapped_file(data, size) : mapped_file();
+    }
+    /**
+     * read_png_file - Read PNG File function decodes a PNG file into 8 bit RGBA pixels, the rows are written tightly
+     * packed straight into the memory given by allocate (e.g a staging buffer). Only reads the immutable folder so it is
+     * safe to call from worker threads
+     * @param file_name - file name to read
+     * @param folders - parent folders
+     * @param allocate - given the width and height returns memory for width * height * 4 bytes, or nullptr to give up
+     * @return - successful or not
+     */
+    bool read_png_file(const std::string& file_name, const std::vector<std::string>& folders, const std::function<void*(uint32_t, uint32_t)>& allocate) {
+        std::vector<uint8_t> src = read_binary_file(file_name, folders);
+        if (src.empty()) {
+            return false;
+        }
+        png_image image = {};
+        image.version = PNG_IMAGE_VERSION;
+        if (!png_image_begin_read_from_memory(&image, src.data(), src.size())) {
+            return false;
+        }
+        image.format = PNG_FORMAT_RGBA;
+        void* pixels = allocate(image.width, image.height);
+        if (!pixels) {
+            png_image_free(&image);
+            return false;
+        }
+        // Frees the image whether it succeeds or not
+        return png_image_finish_read(&image, nullptr, pixels, 0, nullptr) != 0;
+    }
 }
\ No newline at end of file
@@ -0,0 +1,208 @@
+#include "scene/render_system.hxx"
+
+#include "render/render_manager.hxx"
+#include "vml/planar_shadow.hxx"
+
+#include <cstring>
+#include <vector>
+
+/**
+ * scene::render_system - Render System namespace turns the components of a scene into draws, each function walks the
+ * component arrays it needs from start to end. Everything is recorded with the render manager, which batches the draws
+ */
+namespace scene::render_system {
+    namespace {
+        // Point lights gathered each frame, kept to avoid reallocating
+        std::vector<vml::vec4> point_lights;
+
+        // Returns whether the two values hold exactly the same (plain) data
+        template <typename T>
+        bool same(const T& a, const T& b) {
+            return memcmp(&a, &b, sizeof(T)) == 0;
+        }
+        // vec3 is padded to 16 bytes and the padding is not copied, so only its components are compared
+        bool same(const vml::vec3& a, const vml::vec3& b) {
+            return memcmp(a.data, b.data, sizeof(a.data)) == 0;
+        }
+
+        // Plane equation of a homogeneous point, positive in front of the plane
+        float distance(const vml::vec4& plane, const vml::vec4& p) {
+            return plane[0] * p[0] + plane[1] * p[1] + plane[2] * p[2] + plane[3] * p[3];
+        }
+
+        /**
+         * casts_onto - Casts Onto function returns whether the given light projects the whole of a caster onto the given
+         * plane without odd projections: a point light must be further from the plane than every corner of the caster's
+         * bounds, a directional light must shine towards the plane
+         * @param l - light, see light
+         * @param plane - plane of the receiver
+         * @param model - model matrix of the caster
+         * @param caster - bounds of the caster
+         * @return - whether the shadow is drawn
+         */
+        bool casts_onto(const vml::vec4& l, const vml::vec4& plane, const vml::mat4& model, const shadow_caster& caster) {
+            if (l[3] == 0.0F) {
+                return distance(plane, l) < 0.0F;
+            }
+            float light_distance = distance(plane, l);
+            for (int c = 0; c < 8; c++) {
+                vml::vec4 corner = vml::vec4((c & 1) ? caster.bounds_max[0] : caster.bounds_min[0], (c & 2) ? caster.bounds_max[1] : caster.bounds_min[1],
+                                             (c & 4) ? caster.bounds_max[2] : caster.bounds_min[2], 1.0F);
+                if (distance(plane, model * corner) >= light_distance) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+
+    /**
+     * apply_lights - Apply Lights function sends the lights of the scene to the render manager: the first directional
+     * light as the light direction and every point light as the light list. Shadow map settings (see use_shadow_maps and
+     * set_shadow_bounds) must be set first
+     * @param s - scene
+     */
+    void apply_lights(const scene& s) {
+        point_lights.clear();
+        bool directional = false;
+        for (uint32_t i = 0; i < s.lights.size(); i++) {
+            const vml::vec4& l = s.lights[i].l;
+            if (l[3] != 0.0F) {
+                point_lights.push_back(l);
+            }
+            else if (!directional) {
+                render::render_manager::set_light_dir(vml::vec3(l[0], l[1], l[2]));
+                directional = true;
+            }
+        }
+        if (!point_lights.empty()) {
+            render::render_manager::set_lights(point_lights.data(), static_cast<uint32_t>(point_lights.size()));
+        }
+    }
+
+    /**
+     * draw_renderables - Draw Renderables function draws every renderable of the scene with its transform (identity
+     * without one), shadow casters are also drawn into the shadow maps. Only the state which changes between
+     * renderables is set
+     * @param s - scene
+     */
+    void draw_renderables(const scene& s) {
+        uint32_t texture = 0;
+        bool is_static = false;
+        bool casts = false;
+        for (uint32_t i = 0; i < s.renderables.size(); i++) {
+            const renderable& r = s.renderables[i];
+            entity e = s.renderables.owner(i);
+            if (r.texture != texture) {
+                render::render_manager::set_texture(r.texture);
+                texture = r.texture;
+            }
+            if (r.is_static != is_static) {
+                render::render_manager::set_static(r.is_static);
+                is_static = r.is_static;
+            }
+            if (s.casters.has(e) != casts) {
+                casts = !casts;
+                render::render_manager::set_casts_shadow(casts);
+            }
+            render::render_manager::set_colour_mult(r.colour);
+            render::render_manager::set_model(s.transforms.has(e) ? s.transforms.get(e).model : vml::mat4::identity());
+            render::render_manager::draw_mesh(r.mesh);
+        }
+        render::render_manager::set_texture(0);
+        render::render_manager::set_static(false);
+        render::render_manager::set_casts_shadow(false);
+    }
+
+    /**
+     * draw_planar_shadows - Draw Planar Shadows function draws the shadow of every caster from every light onto every
+     * receiver it reaches (see casts_onto), flattened onto the receiver's plane. The projected model matrices are kept in
+     * the cache and built in one vml::plane_project batch over every light and receiver, for every caster when a light or
+     * receiver changed and otherwise only for the casters which changed, so a still scene projects nothing. The shadows
+     * are either blended straight onto their receiver, or marked in the stencil buffer and then resolved by redrawing the
+     * receiver once so overlapping shadows only darken it once. Every shadow on a receiver is drawn before moving on to
+     * the next receiver so each is resolved once
+     * @param s - scene
+     * @param cache - shadows of the last call, updated
+     * @param colour - colour multiplier of the shadows
+     * @param stencil - mark and resolve instead of blending, the stencil buffer must be supported
+     */
+    void draw_planar_shadows(const scene& s, shadow_cache& cache, const vml::mat4& colour, bool stencil) {
+        // Entries are found by position, a change in the arrays only means the values compared below differ
+        uint32_t light_count = s.lights.size();
+        uint32_t receiver_count = s.receivers.size();
+        uint32_t caster_count = s.casters.size();
+        bool moved = cache.lights.size() != light_count || cache.planes.size() != receiver_count || cache.casters.size() != caster_count;
+        cache.lights.resize(light_count);
+        cache.planes.resize(receiver_count);
+        cache.casters.resize(caster_count);
+        cache.shadows.resize(light_count * receiver_count * caster_count);
+        for (uint32_t i = 0; i < light_count; i++) {
+            if (!same(cache.lights[i], s.lights[i].l)) {
+                cache.lights[i] = s.lights[i].l;
+                moved = true;
+            }
+        }
+        for (uint32_t j = 0; j < receiver_count; j++) {
+            if (!same(cache.planes[j], s.receivers[j].plane)) {
+                cache.planes[j] = s.receivers[j].plane;
+                moved = true;
+            }
+        }
+        cache.changed.clear();
+        cache.models.clear();
+        for (uint32_t k = 0; k < caster_count; k++) {
+            entity caster = s.casters.owner(k);
+            const vml::mat4& model = s.transforms.has(caster) ? s.transforms.get(caster).model : vml::mat4::identity();
+            const shadow_caster& bounds = s.casters[k];
+            shadow_cache::caster& c = cache.casters[k];
+            if (moved || !same(c.model, model) || !same(c.bounds_min, bounds.bounds_min) || !same(c.bounds_max, bounds.bounds_max)) {
+                c = {model, bounds.bounds_min, bounds.bounds_max};
+                cache.changed.push_back(k);
+                cache.models.push_back(model);
+            }
+        }
+
+        // Project the changed casters from every light onto every receiver in one batch, then spread them into the cache
+        uint32_t changed_count = cache.changed.size();
+        cache.recomputed = light_count * receiver_count * changed_count;
+        if (cache.recomputed > 0) {
+            cache.projected.resize(cache.recomputed);
+            vml::plane_project(cache.lights.data(), nullptr, light_count, cache.planes.data(), receiver_count, cache.models.data(), changed_count, cache.projected.data());
+            for (uint32_t p = 0; p < light_count * receiver_count; p++) {
+                const vml::vec4& l = cache.lights[p / receiver_count];
+                const vml::vec4& plane = cache.planes[p % receiver_count];
+                for (uint32_t c = 0; c < changed_count; c++) {
+                    uint32_t k = cache.changed[c];
+                    cache.shadows[p * caster_count + k] = {cache.projected[p * changed_count + c], casts_onto(l, plane, cache.models[c], s.casters[k])};
+                }
+            }
+        }
+
+        render::render_manager::set_colour_mult(colour);
+        render::render_manager::set_is_shadow(true);
+        render::render_manager::set_draw_pass(stencil ? render::render_manager::draw_pass::shadow_mark : render::render_manager::draw_pass::shadow_blend);
+        for (uint32_t j = 0; j < receiver_count; j++) {
+            bool drawn = false;
+            for (uint32_t i = 0; i < light_count; i++) {
+                for (uint32_t k = 0; k < caster_count; k++) {
+                    entity caster = s.casters.owner(k);
+                    const shadow_cache::shadow& shadow = cache.shadows[(i * receiver_count + j) * caster_count + k];
+                    if (shadow.casts && s.renderables.has(caster)) {
+                        render::render_manager::set_model(shadow.m);
+                        render::render_manager::draw_mesh(s.renderables.get(caster).mesh);
+                        drawn = true;
+                    }
+                }
+            }
+            entity receiver = s.receivers.owner(j);
+            if (drawn && stencil && s.renderables.has(receiver)) {
+                render::render_manager::set_draw_pass(render::render_manager::draw_pass::shadow_resolve);
+                render::render_manager::set_model(s.transforms.has(receiver) ? s.transforms.get(receiver).model : vml::mat4::identity());
+                render::render_manager::draw_mesh(s.renderables.get(receiver).mesh);
+                render::render_manager::set_draw_pass(render::render_manager::draw_pass::shadow_mark);
+            }
+        }
+        render::render_manager::set_draw_pass(render::render_manager::draw_pass::normal);
+    }
+}
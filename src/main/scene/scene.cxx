@@ -0,0 +1,49 @@
+#include "scene/scene.hxx"
+
+/**
+ * scene - Scene namespace stores the contents of a scene as entities with components, kept in contiguous arrays so the
+ * systems drawing them scale to thousands of objects
+ */
+namespace scene {
+    /**
+     * create - Create function returns a new entity without any components, ids of destroyed entities are reused
+     * @return - the entity
+     */
+    entity scene::create() {
+        if (!free.empty()) {
+            entity e = free.back();
+            free.pop_back();
+            alive[e] = true;
+            return e;
+        }
+        alive.push_back(true);
+        return next++;
+    }
+    /**
+     * destroy - Destroy function removes every component of the given entity and frees its id, its descendants in the
+     * hierarchy are taken out of the hierarchy but keep their last transform. Entities which are not alive (never
+     * created or already destroyed) are ignored
+     * @param e - entity to destroy
+     */
+    void scene::destroy(entity e) {
+        if (!is_alive(e)) {
+            return;
+        }
+        alive[e] = false;
+        hierarchy.remove(e);
+        transforms.remove(e);
+        renderables.remove(e);
+        lights.remove(e);
+        casters.remove(e);
+        receivers.remove(e);
+        free.push_back(e);
+    }
+    // Returns whether the entity has been created and not destroyed since
+    bool scene::is_alive(entity e) const {
+        return e < next && alive[e];
+    }
+    // Returns the number of entities alive
+    uint32_t scene::get_entity_count() const {
+        return next - static_cast<uint32_t>(free.size());
+    }
+}
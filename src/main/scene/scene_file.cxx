@@ -0,0 +1,210 @@
+#include "scene/scene_file.hxx"
+
+#include <algorithm>
+#include <cstring>
+
+/**
+ * scene::scene_file - Scene File reads and writes the binary scene format: a header followed by fixed layout sections
+ * of records (entities, transforms, lights, planes, meshes, casters) and the strings they name, each section aligned so
+ * it is used straight from the file. Loading only checks the header and that every section lies within the file, the
+ * records are then read where they are. The text format they are converted from is described in
+ * src/tools/scene_converter.cxx
+ */
+namespace scene {
+    namespace {
+        // Size of the record each section holds, the strings section holds characters
+        const uint32_t RECORD_SIZES[] = {sizeof(entity_record), sizeof(transform_record), sizeof(light_record), sizeof(plane_record),
+                                         sizeof(mesh_record), sizeof(caster_record), 1};
+
+        // Round the offset up to the section alignment
+        uint32_t align(uint32_t offset) {
+            return (offset + SCENE_FILE_ALIGNMENT - 1) & ~(SCENE_FILE_ALIGNMENT - 1);
+        }
+
+        // Copy a section's records to the output at the offset and fill in its place in the header
+        template<typename T>
+        void write_section(std::vector<uint8_t>& out, scene_file_header& header, scene_section section, uint32_t& offset, const T* records, uint32_t count) {
+            scene_file_section& s = header.sections[static_cast<uint32_t>(section)];
+            s.offset = offset;
+            s.count = count;
+            s.stride = sizeof(T);
+            out.resize(offset + count * sizeof(T));
+            if (count) {
+                memcpy(out.data() + offset, records, count * sizeof(T));
+            }
+            offset = align(static_cast<uint32_t>(out.size()));
+        }
+    }
+
+    /**
+     * load - Load function checks a binary scene file is one this version reads: the magic, version and size match,
+     * every section is aligned and within the file and its records are at least as large as this version's and the
+     * strings end in a null. The records themselves are not read
+     * @param data - start of the file, aligned to SCENE_FILE_ALIGNMENT
+     * @param size - size of the file in bytes
+     * @return - whether the file can be used
+     */
+    bool scene_file::load(const uint8_t* data, size_t size) {
+        base = nullptr;
+        header = nullptr;
+        if (!data || size < sizeof(scene_file_header) || reinterpret_cast<uintptr_t>(data) % SCENE_FILE_ALIGNMENT != 0) {
+            return false;
+        }
+        const auto* h = reinterpret_cast<const scene_file_header*>(data);
+        if (memcmp(h->magic, SCENE_FILE_MAGIC, sizeof(SCENE_FILE_MAGIC)) != 0 || h->version != SCENE_FILE_VERSION || h->file_size != size) {
+            return false;
+        }
+        for (uint32_t i = 0; i < static_cast<uint32_t>(scene_section::count); i++) {
+            const scene_file_section& s = h->sections[i];
+            if (s.offset % SCENE_FILE_ALIGNMENT != 0 || s.stride < RECORD_SIZES[i] || s.offset > size ||
+                static_cast<uint64_t>(s.count) * s.stride > size - s.offset) {
+                return false;
+            }
+        }
+        const scene_file_section& strings = h->sections[static_cast<uint32_t>(scene_section::strings)];
+        if (strings.count == 0 || data[strings.offset + strings.count - 1] != '\0' || h->module >= strings.count) {
+            return false;
+        }
+        base = data;
+        header = h;
+        return true;
+    }
+
+    // The module the scene is for, e.g "directional"
+    const char* scene_file::get_module() const {
+        return get_string(header->module);
+    }
+    vml::vec3 scene_file::get_bounds_min() const {
+        return vml::vec3(header->bounds_min[0], header->bounds_min[1], header->bounds_min[2]);
+    }
+    vml::vec3 scene_file::get_bounds_max() const {
+        return vml::vec3(header->bounds_max[0], header->bounds_max[1], header->bounds_max[2]);
+    }
+    // Returns the number of records in the section
+    uint32_t scene_file::get_count(scene_section section) const {
+        return header->sections[static_cast<uint32_t>(section)].count;
+    }
+    const char* scene_file::get_entity_name(uint32_t i) const {
+        return get_string(get<entity_record>(scene_section::entities, i).name);
+    }
+    // Returns the index of the first entity with the name, NO_ENTITY if there is none
+    uint32_t scene_file::find_entity(const std::string& name) const {
+        for (uint32_t i = 0; i < get_count(scene_section::entities); i++) {
+            if (name == get_entity_name(i)) {
+                return i;
+            }
+        }
+        return NO_ENTITY;
+    }
+
+    /**
+     * instantiate - Instantiate function creates every entity of the file in the scene and gives them their
+     * components, transforms go into the scene's hierarchy. Records naming an entity (or parent) which does not exist,
+     * or a mesh which is not found, are skipped
+     * @param s - scene to add to
+     * @param find_mesh - returns the mesh with the given name, NO_MESH if there is none
+     * @return - the scene entity of each of the file's entities
+     */
+    std::vector<entity> scene_file::instantiate(scene& s, const std::function<uint32_t(const char*)>& find_mesh) const {
+        uint32_t entity_count = get_count(scene_section::entities);
+        std::vector<entity> entities(entity_count);
+        for (entity& e : entities) {
+            e = s.create();
+        }
+        // Every component array is sized once
+        entity max_entity = entities.empty() ? 0 : *std::max_element(entities.begin(), entities.end());
+        s.transforms.reserve(s.transforms.size() + get_count(scene_section::transforms), max_entity);
+        s.hierarchy.reserve(s.hierarchy.size() + get_count(scene_section::transforms), max_entity);
+        s.lights.reserve(s.lights.size() + get_count(scene_section::lights), max_entity);
+        s.receivers.reserve(s.receivers.size() + get_count(scene_section::planes), max_entity);
+        s.renderables.reserve(s.renderables.size() + get_count(scene_section::meshes), max_entity);
+        s.casters.reserve(s.casters.size() + get_count(scene_section::casters), max_entity);
+        for (uint32_t i = 0; i < get_count(scene_section::transforms); i++) {
+            const auto& r = get<transform_record>(scene_section::transforms, i);
+            if (r.entity >= entity_count || (r.parent != NO_ENTITY && (r.parent >= entity_count || !s.hierarchy.has(entities[r.parent])))) {
+                continue;
+            }
+            s.transforms.add(entities[r.entity]);
+            s.hierarchy.add(entities[r.entity], r.parent == NO_ENTITY ? NO_ENTITY : entities[r.parent], vml::vec3(r.translation[0], r.translation[1], r.translation[2]),
+                            vml::quaternion(r.rotation[0], r.rotation[1], r.rotation[2], r.rotation[3]), vml::vec3(r.scale[0], r.scale[1], r.scale[2]));
+        }
+        for (uint32_t i = 0; i < get_count(scene_section::lights); i++) {
+            const auto& r = get<light_record>(scene_section::lights, i);
+            if (r.entity < entity_count) {
+                s.lights.add(entities[r.entity], {vml::vec4(r.l[0], r.l[1], r.l[2], r.l[3])});
+            }
+        }
+        for (uint32_t i = 0; i < get_count(scene_section::planes); i++) {
+            const auto& r = get<plane_record>(scene_section::planes, i);
+            if (r.entity < entity_count) {
+                s.receivers.add(entities[r.entity], {vml::vec4(r.plane[0], r.plane[1], r.plane[2], r.plane[3])});
+            }
+        }
+        for (uint32_t i = 0; i < get_count(scene_section::meshes); i++) {
+            const auto& r = get<mesh_record>(scene_section::meshes, i);
+            uint32_t mesh = r.entity < entity_count ? find_mesh(get_string(r.name)) : NO_MESH;
+            if (mesh != NO_MESH) {
+                vml::mat4 colour = vml::mat4::identity();
+                for (int c = 0; c < 4; c++) {
+                    colour[c][c] = r.colour[c];
+                }
+                s.renderables.add(entities[r.entity], {mesh, 0, colour, (r.flags & MESH_STATIC) != 0});
+            }
+        }
+        for (uint32_t i = 0; i < get_count(scene_section::casters); i++) {
+            const auto& r = get<caster_record>(scene_section::casters, i);
+            if (r.entity < entity_count) {
+                s.casters.add(entities[r.entity], {vml::vec3(r.bounds_min[0], r.bounds_min[1], r.bounds_min[2]), vml::vec3(r.bounds_max[0], r.bounds_max[1], r.bounds_max[2])});
+            }
+        }
+        return entities;
+    }
+
+    // Returns the string at the offset into the strings section, an empty string if it is outside
+    const char* scene_file::get_string(uint32_t offset) const {
+        const scene_file_section& strings = header->sections[static_cast<uint32_t>(scene_section::strings)];
+        return reinterpret_cast<const char*>(base + strings.offset + (offset < strings.count ? offset : strings.count - 1));
+    }
+
+    // Add a string to the strings section, returns its offset
+    uint32_t scene_file_writer::add_string(const std::string& value) {
+        auto offset = static_cast<uint32_t>(strings.size());
+        strings.append(value).push_back('\0');
+        return offset;
+    }
+    // Add an entity, returns its index
+    uint32_t scene_file_writer::add_entity(const std::string& name) {
+        entities.push_back({add_string(name)});
+        return static_cast<uint32_t>(entities.size() - 1);
+    }
+    /**
+     * write - Write function lays out the header and every section as a binary scene file
+     * @param module - module the scene is for
+     * @param bounds_min - lowest corner of the scene's bounds
+     * @param bounds_max - highest corner of the scene's bounds
+     * @return - the file
+     */
+    std::vector<uint8_t> scene_file_writer::write(const std::string& module, const vml::vec3& bounds_min, const vml::vec3& bounds_max) {
+        scene_file_header header = {};
+        memcpy(header.magic, SCENE_FILE_MAGIC, sizeof(SCENE_FILE_MAGIC));
+        header.version = SCENE_FILE_VERSION;
+        header.module = add_string(module);
+        for (int c = 0; c < 3; c++) {
+            header.bounds_min[c] = bounds_min[c];
+            header.bounds_max[c] = bounds_max[c];
+        }
+
+        std::vector<uint8_t> out;
+        uint32_t offset = align(sizeof(scene_file_header));
+        write_section(out, header, scene_section::entities, offset, entities.data(), static_cast<uint32_t>(entities.size()));
+        write_section(out, header, scene_section::transforms, offset, transforms.data(), static_cast<uint32_t>(transforms.size()));
+        write_section(out, header, scene_section::lights, offset, lights.data(), static_cast<uint32_t>(lights.size()));
+        write_section(out, header, scene_section::planes, offset, planes.data(), static_cast<uint32_t>(planes.size()));
+        write_section(out, header, scene_section::meshes, offset, meshes.data(), static_cast<uint32_t>(meshes.size()));
+        write_section(out, header, scene_section::casters, offset, casters.data(), static_cast<uint32_t>(casters.size()));
+        write_section(out, header, scene_section::strings, offset, strings.data(), static_cast<uint32_t>(strings.size()));
+        header.file_size = static_cast<uint32_t>(out.size());
+        memcpy(out.data(), &header, sizeof(header));
+        return out;
+    }
+}
@@ -0,0 +1,381 @@
+#include "scene/transform_hierarchy.hxx"
+
+#include <vml/transform.hxx>
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+
+/**
+ * scene::transform_hierarchy - Transform Hierarchy stores each node's parent, local translation, rotation and scale and
+ * world matrix in separate arrays, ordered depth first so a node's descendants are the nodes up to its end and every
+ * parent comes before its children. Changing a node only marks it dirty, update then recalculates the dirty subtrees in
+ * one linear walk each so the cost follows what moved rather than the size of the scene. Changing the shape of the
+ * hierarchy moves whole subtrees and is linear in the number of nodes
+ */
+namespace scene {
+    namespace {
+        // Updates smaller than this many nodes are not worth starting threads for
+        const uint32_t PARALLEL_MIN = 4096;
+
+        // Move the block of count elements at first to before element pos, which is not inside the block
+        template<typename T>
+        void rotate_block(std::vector<T>& v, uint32_t first, uint32_t count, uint32_t pos) {
+            if (pos < first) {
+                std::rotate(v.begin() + pos, v.begin() + first, v.begin() + first + count);
+            }
+            else if (pos > first + count) {
+                std::rotate(v.begin() + first, v.begin() + first + count, v.begin() + pos);
+            }
+        }
+
+        // The local matrix of a node, translation * rotation * scale. The scale and translation are written straight
+        // into the columns of the rotation
+        vml::mat4 local_matrix(const vml::vec3& t, const vml::quaternion& r, const vml::vec3& s) {
+            vml::mat4 m = vml::rotate(r);
+            for (int c = 0; c < 3; c++) {
+                for (int i = 0; i < 3; i++) {
+                    m.cols[c].data[i] *= s.data[c];
+                }
+                m.cols[3].data[c] = t.data[c];
+            }
+            return m;
+        }
+        // Multiply two affine matrices (bottom row 0, 0, 0, 1), as p * l but skipping the terms which are always 0
+        void affine_multiply(const vml::mat4& p, const vml::mat4& l, vml::mat4& out) {
+            for (int c = 0; c < 4; c++) {
+                for (int i = 0; i < 3; i++) {
+                    out.cols[c].data[i] = p.cols[0].data[i] * l.cols[c].data[0] + p.cols[1].data[i] * l.cols[c].data[1] + p.cols[2].data[i] * l.cols[c].data[2];
+                }
+                out.cols[c].data[3] = 0.0F;
+            }
+            for (int i = 0; i < 3; i++) {
+                out.cols[3].data[i] += p.cols[3].data[i];
+            }
+            out.cols[3].data[3] = 1.0F;
+        }
+    }
+
+    /**
+     * add - Add function puts an entity into the hierarchy as the last child of the given parent, its world matrix is
+     * calculated on the next update. An entity already in the hierarchy is moved and given the new local values
+     * @param e - entity to add
+     * @param parent - parent entity which must be in the hierarchy, or NO_ENTITY for a root
+     * @param translation - local translation
+     * @param rotation - local rotation, a unit quaternion
+     * @param scale - local scale along each axis
+     */
+    void transform_hierarchy::add(entity e, entity parent, const vml::vec3& translation, const vml::quaternion& rotation, const vml::vec3& scale) {
+        if (has(e)) {
+            set_parent(e, parent);
+        }
+        else {
+            auto i = static_cast<uint32_t>(entities.size());
+            if (e >= sparse.size()) {
+                sparse.resize(e + 1, NO_INDEX);
+            }
+            entities.push_back(e);
+            parents.push_back(NO_INDEX);
+            ends.push_back(i + 1);
+            translations.push_back(translation);
+            rotations.push_back(rotation);
+            scales.push_back(scale);
+            worlds.push_back(vml::mat4::identity());
+            dirty.push_back(0);
+            sparse[e] = i;
+            // A new root goes on the end as it is, as does a child whose parent's descendants are the last nodes (so
+            // adding depth first is cheap), any other child is moved after the last of its parent's descendants
+            if (parent != NO_ENTITY) {
+                uint32_t p = index(parent);
+                if (ends[p] == i) {
+                    parents[i] = p;
+                    for (uint32_t a = p; a != NO_INDEX; a = parents[a]) {
+                        ends[a] = i + 1;
+                    }
+                }
+                else {
+                    std::vector<entity> parent_entities = get_parent_entities();
+                    parent_entities[i] = parent;
+                    move_block(parent_entities, i, 1, ends[p]);
+                    rebuild(parent_entities);
+                }
+            }
+        }
+        uint32_t i = index(e);
+        translations[i] = translation;
+        rotations[i] = rotation;
+        scales[i] = scale;
+        mark_dirty(i);
+    }
+    /**
+     * remove - Remove function takes an entity and all of its descendants out of the hierarchy, their transforms keep
+     * their last value
+     * @param e - entity to remove
+     */
+    void transform_hierarchy::remove(entity e) {
+        if (!has(e)) {
+            return;
+        }
+        uint32_t first = index(e);
+        uint32_t count = ends[first] - first;
+        auto size = static_cast<uint32_t>(entities.size());
+        std::vector<entity> parent_entities = get_parent_entities();
+        move_block(parent_entities, first, count, size);
+        size -= count;
+        for (uint32_t i = size; i < size + count; i++) {
+            sparse[entities[i]] = NO_INDEX;
+        }
+        entities.resize(size);
+        parent_entities.resize(size);
+        parents.resize(size);
+        ends.resize(size);
+        translations.resize(size);
+        rotations.resize(size);
+        scales.resize(size);
+        worlds.resize(size);
+        dirty.resize(size);
+        rebuild(parent_entities);
+    }
+    /**
+     * set_parent - Set Parent function moves an entity and its descendants under another parent, keeping their local
+     * values. Nothing changes if the parent is the entity or one of its descendants
+     * @param e - entity to move, must be in the hierarchy
+     * @param parent - new parent entity which must be in the hierarchy, or NO_ENTITY to make it a root
+     */
+    void transform_hierarchy::set_parent(entity e, entity parent) {
+        uint32_t first = index(e);
+        uint32_t count = ends[first] - first;
+        uint32_t pos = static_cast<uint32_t>(entities.size());
+        if (parent != NO_ENTITY) {
+            uint32_t p = index(parent);
+            if (p >= first && p < first + count) {
+                return;
+            }
+            pos = ends[p];
+        }
+        std::vector<entity> parent_entities = get_parent_entities();
+        parent_entities[first] = parent;
+        move_block(parent_entities, first, count, pos);
+        rebuild(parent_entities);
+        mark_dirty(index(e));
+    }
+    bool transform_hierarchy::has(entity e) const {
+        return e < sparse.size() && sparse[e] != NO_INDEX;
+    }
+    // Returns the parent of the entity, NO_ENTITY for a root
+    entity transform_hierarchy::get_parent(entity e) const {
+        uint32_t p = parents[index(e)];
+        return p == NO_INDEX ? NO_ENTITY : entities[p];
+    }
+
+    // Local values of an entity in the hierarchy, setting one recalculates the entity's subtree on the next update
+    void transform_hierarchy::set_translation(entity e, const vml::vec3& translation) {
+        uint32_t i = index(e);
+        translations[i] = translation;
+        mark_dirty(i);
+    }
+    void transform_hierarchy::set_rotation(entity e, const vml::quaternion& rotation) {
+        uint32_t i = index(e);
+        rotations[i] = rotation;
+        mark_dirty(i);
+    }
+    void transform_hierarchy::set_scale(entity e, const vml::vec3& scale) {
+        uint32_t i = index(e);
+        scales[i] = scale;
+        mark_dirty(i);
+    }
+    const vml::vec3& transform_hierarchy::get_translation(entity e) const {
+        return translations[index(e)];
+    }
+    const vml::quaternion& transform_hierarchy::get_rotation(entity e) const {
+        return rotations[index(e)];
+    }
+    const vml::vec3& transform_hierarchy::get_scale(entity e) const {
+        return scales[index(e)];
+    }
+    // Returns the world matrix of the entity as of the last update
+    const vml::mat4& transform_hierarchy::get_world(entity e) const {
+        return worlds[index(e)];
+    }
+
+    /**
+     * update - Update function recalculates the world matrix of every dirty node and its descendants and writes it to
+     * the node's transform, if it has one. Dirty subtrees are independent of each other so with more than one thread
+     * they are shared out between threads, a subtree larger than a thread's share is split into its children's subtrees
+     * @param transforms - transforms to write to, no transforms may be added or removed during the update
+     * @param thread_count - number of threads to use, 1 runs on the calling thread
+     */
+    void transform_hierarchy::update(component_array<transform>& transforms, uint32_t thread_count) {
+        if (dirty_nodes.empty()) {
+            return;
+        }
+        // Only the top most dirty nodes are needed, the rest are inside their subtrees
+        std::sort(dirty_nodes.begin(), dirty_nodes.end());
+        roots.clear();
+        uint32_t covered = 0;
+        uint32_t total = 0;
+        for (uint32_t i : dirty_nodes) {
+            dirty[i] = 0;
+            if (i >= covered) {
+                roots.push_back(i);
+                covered = ends[i];
+                total += ends[i] - i;
+            }
+        }
+        dirty_nodes.clear();
+
+        thread_count = std::max(1U, thread_count);
+        if (thread_count == 1 || total < PARALLEL_MIN) {
+            update_range(roots.data(), roots.data() + roots.size(), transforms);
+            return;
+        }
+        // Split the subtrees until none is larger than a thread's share, the nodes above them are done here
+        uint32_t share = (total + thread_count - 1) / thread_count;
+        std::vector<uint32_t> dirty_roots;
+        dirty_roots.swap(roots);
+        for (uint32_t root : dirty_roots) {
+            split(root, share, transforms);
+        }
+        // Each thread takes a contiguous run of subtrees holding about a share of the nodes
+        std::vector<std::thread> threads;
+        const uint32_t* first = roots.data();
+        const uint32_t* end = roots.data() + roots.size();
+        while (first != end) {
+            const uint32_t* last = first;
+            uint32_t nodes = 0;
+            while (last != end && nodes < share) {
+                nodes += ends[*last] - *last;
+                last++;
+            }
+            if (last == end) {
+                update_range(first, last, transforms);
+            }
+            else {
+                threads.emplace_back(&transform_hierarchy::update_range, this, first, last, std::ref(transforms));
+            }
+            first = last;
+        }
+        for (std::thread& t : threads) {
+            t.join();
+        }
+    }
+    // Make room for count nodes and entities up to max_entity without reallocating
+    void transform_hierarchy::reserve(uint32_t count, entity max_entity) {
+        entities.reserve(count);
+        parents.reserve(count);
+        ends.reserve(count);
+        translations.reserve(count);
+        rotations.reserve(count);
+        scales.reserve(count);
+        worlds.reserve(count);
+        dirty.reserve(count);
+        dirty_nodes.reserve(count);
+        if (max_entity >= sparse.size()) {
+            sparse.resize(max_entity + 1, NO_INDEX);
+        }
+    }
+    // Returns the number of nodes in the hierarchy
+    uint32_t transform_hierarchy::size() const {
+        return static_cast<uint32_t>(entities.size());
+    }
+
+    // Returns the node index of an entity in the hierarchy
+    uint32_t transform_hierarchy::index(entity e) const {
+        return sparse[e];
+    }
+    // Marks the node's subtree to be recalculated on the next update
+    void transform_hierarchy::mark_dirty(uint32_t i) {
+        if (!dirty[i]) {
+            dirty[i] = 1;
+            dirty_nodes.push_back(i);
+        }
+    }
+    // Moves the count nodes at first to before node pos, parents are given as entities and fixed by rebuild
+    void transform_hierarchy::move_block(std::vector<entity>& parent_entities, uint32_t first, uint32_t count, uint32_t pos) {
+        rotate_block(entities, first, count, pos);
+        rotate_block(parent_entities, first, count, pos);
+        rotate_block(translations, first, count, pos);
+        rotate_block(rotations, first, count, pos);
+        rotate_block(scales, first, count, pos);
+        rotate_block(worlds, first, count, pos);
+        rotate_block(dirty, first, count, pos);
+    }
+    /**
+     * rebuild - Rebuild function recalculates the indices of every node after nodes have been moved: the index of each
+     * entity, each node's parent and end, and the list of dirty nodes
+     * @param parent_entities - parent entity of every node, NO_ENTITY for roots
+     */
+    void transform_hierarchy::rebuild(const std::vector<entity>& parent_entities) {
+        auto size = static_cast<uint32_t>(entities.size());
+        for (uint32_t i = 0; i < size; i++) {
+            sparse[entities[i]] = i;
+        }
+        dirty_nodes.clear();
+        for (uint32_t i = 0; i < size; i++) {
+            parents[i] = parent_entities[i] == NO_ENTITY ? NO_INDEX : sparse[parent_entities[i]];
+            ends[i] = i + 1;
+            if (dirty[i]) {
+                dirty_nodes.push_back(i);
+            }
+        }
+        // Children come after their parents, so walking backwards every end is final before it is given to the parent
+        for (uint32_t i = size; i-- > 0;) {
+            if (parents[i] != NO_INDEX) {
+                ends[parents[i]] = std::max(ends[parents[i]], ends[i]);
+            }
+        }
+    }
+    // Returns the parent entity of every node, NO_ENTITY for roots
+    std::vector<entity> transform_hierarchy::get_parent_entities() const {
+        std::vector<entity> parent_entities(entities.size());
+        for (size_t i = 0; i < entities.size(); i++) {
+            parent_entities[i] = parents[i] == NO_INDEX ? NO_ENTITY : entities[parents[i]];
+        }
+        return parent_entities;
+    }
+
+    /**
+     * split - Split function adds the subtree to the roots to update if it fits in a thread's share, otherwise it
+     * updates the root itself and splits each child's subtree
+     * @param root - node at the top of the subtree
+     * @param share - most nodes a thread should be given
+     * @param transforms - transforms to write to
+     */
+    void transform_hierarchy::split(uint32_t root, uint32_t share, component_array<transform>& transforms) {
+        if (ends[root] - root <= share || ends[root] == root + 1) {
+            roots.push_back(root);
+            return;
+        }
+        update_node(root, transforms);
+        for (uint32_t child = root + 1; child < ends[root]; child = ends[child]) {
+            split(child, share, transforms);
+        }
+    }
+    /**
+     * update_range - Update Range function recalculates the world matrix of every node in each of the given subtrees.
+     * Every node's parent is before it, so one walk from each root gets every parent's world matrix before its children
+     * @param first - first root
+     * @param last - one past the last root
+     * @param transforms - transforms to write to
+     */
+    void transform_hierarchy::update_range(const uint32_t* first, const uint32_t* last, component_array<transform>& transforms) {
+        for (const uint32_t* root = first; root != last; root++) {
+            for (uint32_t i = *root; i < ends[*root]; i++) {
+                update_node(i, transforms);
+            }
+        }
+    }
+    // Recalculates the world matrix of a node whose parent is up to date
+    void transform_hierarchy::update_node(uint32_t i, component_array<transform>& transforms) {
+        vml::mat4 local = local_matrix(translations[i], rotations[i], scales[i]);
+        if (parents[i] == NO_INDEX) {
+            worlds[i] = local;
+        }
+        else {
+            affine_multiply(worlds[parents[i]], local, worlds[i]);
+        }
+        if (transforms.has(entities[i])) {
+            transforms.get(entities[i]).model = worlds[i];
+        }
+    }
+}
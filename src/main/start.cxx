@@ -1,8 +1,11 @@
+#include "frame_limiter.hxx"
 #include "game.hxx"
 #include "glfw_wrapper.hxx"
 #include "vulkan_wrapper.hxx"
 #include "platform/platform.hxx"
+#include "render/mesh_manager.hxx"
 #include "render/render_manager.hxx"
+#include "render/texture_manager.hxx"
 #include "resource/resource_manager.hxx"
 
 /**
@@ -26,16 +29,22 @@ int main(int argc, char** args) {
     // Initialise the resource manager to read binary files
     resource::resource_manager::init(platform::files::get_resource_folder(), platform::files::FILE_SEPARATOR);
 
-    // Initialise the render manager and load all shaders
+    // Initialise the texture manager (which starts its decode threads), then the render manager and load all shaders
+    render::texture_manager::init();
+    render::mesh_manager::init();
     render::render_manager::init();
     render::render_manager::load_shaders();
 
-    // Initialise the game which includes all three example modules
+    // Initialise the frame limiter (uncapped until a present policy asks for a cap) and the game which includes all
+    // three example modules
+    frame_limiter::init();
     game::init();
 
     // Game loop, simple way to calculate the change in time to update the scenes precisely
     double old_time = glfw_wrapper::get_time();
     while (!(glfw_wrapper::should_quit() || game::should_quit())) {
+        // In latency mode wait for a free frame before sampling input, otherwise render_frame waits
+        vulkan_wrapper::pace_frame();
         // Check for user inputs
         glfw_wrapper::poll_events();
         double new_time = glfw_wrapper::get_time();
@@ -45,12 +54,17 @@ int main(int argc, char** args) {
         if (!vulkan_wrapper::render_frame(game::render)) {
             break;
         }
+        // Hold the loop to the frame cap, if any
+        frame_limiter::wait();
     }
     // Wait until all Vulkan processes have stopped
     vulkan_wrapper::wait_idle();
 
     // Terminate everything
     render::render_manager::terminate();
+    render::mesh_manager::terminate();
+    render::texture_manager::terminate();
+    frame_limiter::terminate();
     vulkan_wrapper::terminate();
     glfw_wrapper::terminate();
     return 0;
@@ -0,0 +1,122 @@
+#include "vml/frustum.hxx"
+
+#include <cmath>
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define VML_FRUSTUM_SSE
+#endif
+
+/**
+ * vml - VML (Vector Maths Library) namespace stores all linear algebra methods and types
+ * the following file defines the frustum 'type' and the visibility tests used for culling, this is the CPU reference for
+ * the cull compute shader and must give the same answers
+ */
+namespace vml {
+    vec4& frustum::operator[](int i) {
+        return this->planes[i];
+    }
+    vec4 const& frustum::operator[](int i) const {
+        return this->planes[i];
+    }
+
+    // Extracts the six planes (left, right, bottom, top, near, far) from a projection * view matrix, each plane is stored
+    // as (a, b, c, d) with a unit normal pointing inwards so a point p is inside when a*x + b*y + c*z + d >= 0.
+    // Uses the Vulkan clip volume: -w <= x <= w, -w <= y <= w and 0 <= z <= w
+    frustum extract_frustum(const mat4& m) {
+        vec4 row0 = vec4(m[0][0], m[1][0], m[2][0], m[3][0]);
+        vec4 row1 = vec4(m[0][1], m[1][1], m[2][1], m[3][1]);
+        vec4 row2 = vec4(m[0][2], m[1][2], m[2][2], m[3][2]);
+        vec4 row3 = vec4(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+        frustum out;
+        out[0] = row3 + row0;
+        out[1] = row3 - row0;
+        out[2] = row3 + row1;
+        out[3] = row3 - row1;
+        out[4] = row2;
+        out[5] = row3 - row2;
+        for (vec4& plane : out.planes) {
+            float length = vec3(plane[0], plane[1], plane[2]).magnitude();
+            if (length > 0.0F) {
+                plane /= length;
+            }
+        }
+        return out;
+    }
+
+    // Returns false only if the sphere is completely outside one of the planes
+    bool intersects_sphere(const frustum& f, const vec3& centre, float radius) {
+        for (const vec4& plane : f.planes) {
+            if (plane[0] * centre[0] + plane[1] * centre[1] + plane[2] * centre[2] + plane[3] < -radius) {
+                return false;
+            }
+        }
+        return true;
+    }
+    // Returns false only if the box is completely outside one of the planes, tests the corner furthest along each normal
+    bool intersects_aabb(const frustum& f, const vec3& min, const vec3& max) {
+        for (const vec4& plane : f.planes) {
+            float x = plane[0] >= 0.0F ? max[0] : min[0];
+            float y = plane[1] >= 0.0F ? max[1] : min[1];
+            float z = plane[2] >= 0.0F ? max[2] : min[2];
+            if (plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < 0.0F) {
+                return false;
+            }
+        }
+        return true;
+    }
+    // Tests count spheres stored as (x, y, z, radius), writes 1 into visible for each sphere that intersects and 0 otherwise.
+    // Four spheres are tested at once with SSE when available
+    void intersects_spheres(const frustum& f, const vec4* spheres, uint32_t count, uint8_t* visible) {
+        uint32_t i = 0;
+#ifdef VML_FRUSTUM_SSE
+        for (; i + 4 <= count; i += 4) {
+            // Transpose four (x, y, z, r) spheres into x, y, z and r lanes
+            __m128 x = _mm_load_ps(spheres[i].data);
+            __m128 y = _mm_load_ps(spheres[i + 1].data);
+            __m128 z = _mm_load_ps(spheres[i + 2].data);
+            __m128 r = _mm_load_ps(spheres[i + 3].data);
+            _MM_TRANSPOSE4_PS(x, y, z, r);
+            __m128 neg_r = _mm_sub_ps(_mm_setzero_ps(), r);
+
+            __m128 outside = _mm_setzero_ps();
+            for (const vec4& plane : f.planes) {
+                __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane[0])), _mm_mul_ps(y, _mm_set1_ps(plane[1]))),
+                                      _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane[2])), _mm_set1_ps(plane[3])));
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(d, neg_r));
+            }
+            int mask = _mm_movemask_ps(outside);
+            visible[i] = (mask & 1) ? 0 : 1;
+            visible[i + 1] = (mask & 2) ? 0 : 1;
+            visible[i + 2] = (mask & 4) ? 0 : 1;
+            visible[i + 3] = (mask & 8) ? 0 : 1;
+        }
+#endif
+        for (; i < count; i++) {
+            visible[i] = intersects_sphere(f, vec3(spheres[i][0], spheres[i][1], spheres[i][2]), spheres[i][3]) ? 1 : 0;
+        }
+    }
+
+    // Creates a sphere (x, y, z, radius) enclosing the box min to max after it has been transformed by m, m may be a
+    // projective matrix (e.g a shadow projection) so every corner is divided by w. Corners with w <= 0 have no valid
+    // image and give an infinite sphere so the object is never culled
+    vec4 bounding_sphere(const mat4& m, const vec3& min, const vec3& max) {
+        vec3 corners[8];
+        for (int i = 0; i < 8; i++) {
+            vec4 corner = m * vec4((i & 1) ? max[0] : min[0], (i & 2) ? max[1] : min[1], (i & 4) ? max[2] : min[2], 1.0F);
+            if (corner[3] <= 0.0F) {
+                return vec4(0.0F, 0.0F, 0.0F, INFINITY);
+            }
+            corners[i] = vec3(corner[0] / corner[3], corner[1] / corner[3], corner[2] / corner[3]);
+        }
+        vec3 centre;
+        for (const vec3& corner : corners) {
+            centre += corner / 8.0F;
+        }
+        float radius = 0.0F;
+        for (const vec3& corner : corners) {
+            radius = std::fmax(radius, (corner - centre).magnitude());
+        }
+        return vec4(centre, radius);
+    }
+}
@@ -0,0 +1,125 @@
+#include "vml/planar_shadow.hxx"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define VML_PLANAR_SHADOW_SSE
+#endif
+
+/**
+ * vml - VML (Vector Maths Library) namespace stores all linear algebra methods and types
+ * the following file defines the general planar shadow projection, any number of lights (point or directional) onto
+ * any number of planes. For a light L = (x, y, z, w) (w = 1 point, w = 0 directional) and a plane P = (a, b, c, d) the
+ * projection is S = (P.L)I - L P^T, which maps every point onto the plane along the ray from the light
+ */
+namespace vml {
+    namespace {
+        // Dot product of every component, used for planes and homogeneous points
+        float dot4(const vec4& v0, const vec4& v1) {
+            return v0[0] * v1[0] + v0[1] * v1[1] + v0[2] * v1[2] + v0[3] * v1[3];
+        }
+
+        /**
+         * project_range - Project Range function fills the output for lights first to last, the plane and caster
+         * terms (P.C for each caster column) do not depend on the light so they are computed once by the caller and
+         * each shadow column is then just d * C - L * (P.C)
+         * @param pc - P.C for every plane and caster, plane_count * caster_count vec4s
+         */
+        void project_range(const vec4* lights, const float* offsets, uint32_t first, uint32_t last, const vec4* planes, uint32_t plane_count, const mat4* casters, uint32_t caster_count, const vec4* pc, mat4* out) {
+            for (uint32_t i = first; i < last; i++) {
+                const vec4& l = lights[i];
+                // Moving the plane towards the light by the offset only changes the w term of the plane
+                float offset = offsets ? offsets[i] : 0.0F;
+                for (uint32_t j = 0; j < plane_count; j++) {
+                    float d = dot4(planes[j], l) - offset * l[3];
+                    const vec4* pc_j = pc + j * caster_count;
+                    mat4* out_j = out + (i * plane_count + j) * caster_count;
+#ifdef VML_PLANAR_SHADOW_SSE
+                    __m128 light = _mm_load_ps(l.data);
+                    __m128 dv = _mm_set1_ps(d);
+                    __m128 ov = _mm_set1_ps(offset);
+                    for (uint32_t k = 0; k < caster_count; k++) {
+                        // (P.C) for each of the four columns, shifted the same way as d
+                        __m128 p = _mm_sub_ps(_mm_load_ps(pc_j[k].data), _mm_mul_ps(ov, _mm_set_ps(casters[k][3][3], casters[k][2][3], casters[k][1][3], casters[k][0][3])));
+                        for (int c = 0; c < 4; c++) {
+                            __m128 col = _mm_load_ps(casters[k][c].data);
+                            __m128 s = _mm_shuffle_ps(p, p, _MM_SHUFFLE(0, 0, 0, 0));
+                            p = _mm_shuffle_ps(p, p, _MM_SHUFFLE(0, 3, 2, 1));
+                            _mm_store_ps(out_j[k][c].data, _mm_sub_ps(_mm_mul_ps(dv, col), _mm_mul_ps(light, s)));
+                        }
+                    }
+#else
+                    for (uint32_t k = 0; k < caster_count; k++) {
+                        for (int c = 0; c < 4; c++) {
+                            out_j[k][c] = d * casters[k][c] - l * (pc_j[k][c] - offset * casters[k][c][3]);
+                        }
+                    }
+#endif
+                }
+            }
+        }
+    }
+
+    // Creates the plane (a, b, c, d) through the given point with the given normal, the normal should face the lights
+    // so that every point between a light and the plane gives a positive w after projection
+    vec4 plane(const vec3& normal, const vec3& point) {
+        vec3 n = normal / normal.magnitude();
+        return vec4(n, -(n[0] * point[0] + n[1] * point[1] + n[2] * point[2]));
+    }
+
+    // Creates the projection matrix of the given light (w = 1 point, w = 0 directional) onto the given plane
+    mat4 plane_project(const vec4& light, const vec4& plane) {
+        float d = dot4(plane, light);
+        mat4 out;
+        for (int c = 0; c < 4; c++) {
+            for (int r = 0; r < 4; r++) {
+                out[c][r] = (c == r ? d : 0.0F) - light[r] * plane[c];
+            }
+        }
+        return out;
+    }
+
+    /**
+     * plane_project - Plane Project function creates the shadow matrix of every caster from every light onto every
+     * plane in one batch, out[(light * plane_count + plane) * caster_count + caster] = plane_project(light, plane) * caster.
+     * Uses SSE where available and splits the lights across threads when asked to
+     * @param lights - lights, (x, y, z, 1) for a point light or (x, y, z, 0) for a directional light
+     * @param offsets - distance to lift each light's shadows off the planes (towards the light), may be nullptr
+     * @param light_count - number of lights
+     * @param planes - planes, see plane
+     * @param plane_count - number of planes
+     * @param casters - model matrices of the objects casting the shadows
+     * @param caster_count - number of casters
+     * @param out - light_count * plane_count * caster_count matrices
+     * @param thread_count - number of threads to use, 1 runs on the calling thread
+     */
+    void plane_project(const vec4* lights, const float* offsets, uint32_t light_count, const vec4* planes, uint32_t plane_count, const mat4* casters, uint32_t caster_count, mat4* out, uint32_t thread_count) {
+        // P.C (the bottom row of P^T C) is shared by every light
+        std::vector<vec4> pc(plane_count * caster_count);
+        for (uint32_t j = 0; j < plane_count; j++) {
+            for (uint32_t k = 0; k < caster_count; k++) {
+                for (int c = 0; c < 4; c++) {
+                    pc[j * caster_count + k][c] = dot4(planes[j], casters[k][c]);
+                }
+            }
+        }
+
+        thread_count = std::max(1U, std::min(thread_count, light_count));
+        if (thread_count == 1) {
+            project_range(lights, offsets, 0, light_count, planes, plane_count, casters, caster_count, pc.data(), out);
+            return;
+        }
+        // Each thread takes a contiguous run of lights, so they never write the same output
+        std::vector<std::thread> threads;
+        uint32_t per_thread = (light_count + thread_count - 1) / thread_count;
+        for (uint32_t first = per_thread; first < light_count; first += per_thread) {
+            threads.emplace_back(project_range, lights, offsets, first, std::min(first + per_thread, light_count), planes, plane_count, casters, caster_count, pc.data(), out);
+        }
+        project_range(lights, offsets, 0, std::min(per_thread, light_count), planes, plane_count, casters, caster_count, pc.data(), out);
+        for (std::thread& t : threads) {
+            t.join();
+        }
+    }
+}
@@ -68,14 +68,15 @@ namespace vml {
             0.0f, 0.0f, 1.0f, 0.0f,
             0.0f, 0.0f, 0.0f, 1.0f);
     }
-    // Creates an orthographic matrix used in most 2D games, not used in this application
+    // Creates an orthographic matrix used in most 2D games, used for directional shadow maps. Like perspective the
+    // camera looks down -z so near and far are distances in front of it
     mat4 orthographic(float left, float right, float bottom, float top, float near, float far) {
         mat4 out;
         out[0][0] = 2.0f / (right - left);
         out[3][0] = (left + right) / (left - right);
         out[1][1] = 2.0f / (bottom - top);
         out[3][1] = (top + bottom) / (top - bottom);
-        out[2][2] = 1.0f / (far - near);
+        out[2][2] = 1.0f / (near - far);
         out[3][2] = near / (near - far);
         out[3][3] = 1.0f;
         return out;
@@ -102,6 +103,20 @@ namespace vml {
         out[2][3] = -1.0f;
         return out;
     }
+    // Creates a view matrix for a camera at eye looking towards centre, the camera looks down its -z axis like the
+    // matrices given to perspective expect
+    mat4 look_at(const vec3& eye, const vec3& centre, const vec3& up) {
+        vec3 f = centre - eye;
+        f /= f.magnitude();
+        vec3 s = vec3(f[1] * up[2] - f[2] * up[1], f[2] * up[0] - f[0] * up[2], f[0] * up[1] - f[1] * up[0]);
+        s /= s.magnitude();
+        vec3 u = vec3(s[1] * f[2] - s[2] * f[1], s[2] * f[0] - s[0] * f[2], s[0] * f[1] - s[1] * f[0]);
+        return mat4(
+                s[0], u[0], -f[0], 0.0f,
+                s[1], u[1], -f[1], 0.0f,
+                s[2], u[2], -f[2], 0.0f,
+                -(s[0] * eye[0] + s[1] * eye[1] + s[2] * eye[2]), -(u[0] * eye[0] + u[1] * eye[1] + u[2] * eye[2]), f[0] * eye[0] + f[1] * eye[1] + f[2] * eye[2], 1.0f);
+    }
     // Rotate the object about the given axis by rad amount
     mat4 rotate(float rad, const vec3 &axis) {
         vec3 unit = axis / axis.magnitude();
@@ -1,8 +1,15 @@
 #include "vulkan_wrapper.hxx"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <deque>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <set>
+#include <variant>
 
 /**
  * vulkan_wrapper - Namespace which acts like a singleton class. Provides all functions to interact with Vulkan
@@ -12,12 +19,66 @@ namespace vulkan_wrapper {
      * Anonymous namespace to hold 'private' variables
      */
     namespace {
-        const int MAX_FRAMES_IN_FLIGHT = 3;
+        // Per-frame resources are created for the most frames which may be in flight, how many are actually allowed in
+        // flight is chosen at runtime with set_frames_in_flight
+        const int MAX_FRAMES_IN_FLIGHT = 4;
+        const uint32_t TIMESTAMP_QUERIES = 2;
+        // Command buffers allocated up front for each frame: work before the main render pass, the pass itself, and
+        // work after it
+        const uint32_t COMMAND_BUFFERS_PER_FRAME = 3;
+        // Initial size of each frame's region of the ring buffer, doubled whenever a frame runs out
+        const vk::DeviceSize RING_REGION_SIZE = 1U << 20U;
+        // Staging buffers are at least this size (rounded up to a power of two) so they can be reused by other
+        // uploads, at most STAGING_POOL_LIMIT bytes of them are kept once released
+        const vk::DeviceSize STAGING_MIN_SIZE = 1U << 16U;
+        const vk::DeviceSize STAGING_POOL_LIMIT = 1U << 26U;
+        // Attachment memory blocks kept once released, a block is only reused for an image needing at least half of it
+        const uint32_t ATTACHMENT_POOL_LIMIT = 4;
+        // Dynamic resolution ignores GPU times within RESOLUTION_DEADBAND of the target and moves RESOLUTION_DAMPING of
+        // the way to the scale it asks for, the scale used is rounded to 1 / RESOLUTION_STEPS so the render extent (and
+        // the cached commands recorded against it) only changes when the scale really moves
+        const double RESOLUTION_DEADBAND = 0.05;
+        const double RESOLUTION_DAMPING = 0.25;
+        const float RESOLUTION_STEPS = 32.0F;
+        const float MIN_RESOLUTION_SCALE = 0.25F;
+        const float MAX_RESOLUTION_SCALE = 2.0F;
         void (*resolution_function)(int*, int*);
-        // Structure used to hold both the command pool and its buffers
+        // A block of memory behind a render pass attachment, deferring one returns it to the attachment pool rather
+        // than freeing it (see create_attachment)
+        struct attachment_memory {
+            vk::DeviceMemory memory;
+            vk::DeviceSize size = 0;
+            uint32_t type = 0;
+        };
+        // An image only used within the main render pass, along with its view and memory
+        struct attachment {
+            vk::Image image;
+            vk::ImageView view;
+            attachment_memory memory;
+        };
+        // Any object which can be handed to the deferred destruction queue
+        using deferred_object = std::variant<vk::Pipeline, vk::PipelineLayout, vk::Buffer, vk::DeviceMemory, vk::Image, vk::ImageView, vk::Framebuffer, vk::Sampler, vk::RenderPass, vk::SwapchainKHR,
+                                             attachment_memory>;
+        // An object waiting for the GPU to finish the last frame which may use it (frame timeline value)
+        struct deferred_destruction {
+            uint64_t value;
+            deferred_object object;
+        };
+        // An upload submitted to the transfer queue, its command buffer and staging buffer are released once the
+        // transfer timeline reaches its value
+        struct transfer {
+            uint64_t value;
+            vk::CommandBuffer buffer;
+            staging_buffer staging;
+        };
+        // Structure used to hold both the command pool and its buffers, buffers are handed out in order each frame and
+        // recycled when the pool is reset, more are only allocated if a frame needs more than ever before
         struct Command {
             vk::CommandPool pool;
             std::vector<vk::CommandBuffer> buffers;
+            uint32_t used = 0;
+            std::vector<vk::CommandBuffer> secondary;
+            uint32_t secondary_used = 0;
         };
         // Holds all 'private' variables used by Vulkan
         struct info {
@@ -32,26 +93,130 @@ namespace vulkan_wrapper {
             uint32_t graphics_id = 0;
             uint32_t present_id = 0;
 
+            // Uploads run on the transfer queue, a family of its own where the device has one, and signal the transfer
+            // timeline. Resources uploaded from another family are acquired by the graphics queue at the start of the
+            // next frame, which waits for the transfer timeline to reach acquire_value
+            vk::Queue transfer_queue;
+            uint32_t transfer_id = 0;
+            vk::CommandPool transfer_pool;
+            vk::Semaphore transfer_timeline;
+            uint64_t transfer_value = 0;
+            std::deque<transfer> transfers;
+            std::vector<vk::BufferMemoryBarrier> acquire_buffers;
+            std::vector<vk::ImageMemoryBarrier> acquire_images;
+            vk::PipelineStageFlags acquire_stages;
+            uint64_t acquire_value = 0;
+            // Released staging buffers kept for the next uploads, guarded by the mutex as they may be acquired from
+            // worker threads (see acquire_staging)
+            std::vector<staging_buffer> staging_pool;
+            vk::DeviceSize staging_pooled = 0;
+            std::mutex staging_mutex;
+
+            // Work recorded between begin_async_compute and end_async_compute is submitted to the compute queue straight
+            // away, a family without graphics where the device has one, so it overlaps the previous frame's rendering.
+            // It signals the compute timeline and the frame's graphics work waits for compute_wait_value
+            vk::Queue compute_queue;
+            uint32_t compute_id = 0;
+            std::vector<Command> compute_commands;
+            vk::Semaphore compute_timeline;
+            uint64_t compute_value = 0;
+            vk::PipelineStageFlags compute_stages;
+            uint64_t compute_wait_value = 0;
+
             vk::SwapchainKHR swapchain;
+            present_policy policy = present_policy::low_latency;
+            vk::PresentModeKHR present_mode = vk::PresentModeKHR::eFifo;
             std::vector<vk::Image> swapchain_images;
             vk::Format swapchain_image_format = vk::Format::eB8G8R8A8Unorm;
             vk::Extent2D swapchain_extent;
             std::vector<vk::ImageView> swapchain_image_views;
             std::vector<vk::Framebuffer> swapchain_framebuffers;
             vk::RenderPass render_pass;
+            // Set when the swapchain no longer matches the surface (resized, suboptimal or a new present mode), it is
+            // rebuilt at the start of the next frame
+            bool swapchain_dirty = false;
+            // Samples per pixel of the main render pass, with more than one the pass renders into a multisampled colour
+            // attachment resolved into the swapchain image at the end of the pass. Changing it also rebuilds the render
+            // pass and attachments (attachments_dirty)
+            vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e1;
+            vk::SampleCountFlagBits max_samples = vk::SampleCountFlagBits::e1;
+            bool attachments_dirty = false;
+            // Dynamic resolution, when offscreen the pass renders into the offscreen image (allocated at target_extent,
+            // the swapchain size at max_scale) within render_extent, which is blitted into the swapchain image after the
+            // pass. Otherwise both extents are the swapchain's
+            resolution_settings resolution;
+            bool resolution_supported = false;
+            bool offscreen = false;
+            float resolution_scale = 1.0F;
+            bool gpu_time_fresh = false;
+            vk::Extent2D render_extent;
+            vk::Extent2D target_extent;
 
             std::vector<Command> commands;
+            // Command buffer currently being recorded into and the command statistics of the frame, while a secondary
+            // command buffer is recorded the primary it belongs to is kept aside
+            vk::CommandBuffer recording;
+            vk::CommandBuffer primary;
+            command_stats stats;
+            // Pool of the cached secondary command buffers, which outlive any one frame and are reset individually. The
+            // version changes whenever the main render pass is recreated, invalidating everything recorded against it
+            vk::CommandPool cached_pool;
+            uint32_t render_pass_version = 1;
             std::vector<vk::Semaphore> image_available_semaphores;
             std::vector<vk::Semaphore> render_finished_semaphores;
-            std::vector<vk::Fence> in_flight_fences;
-            std::vector<vk::Fence> images_in_flight;
 
-            vk::Image depth_image;
-            vk::DeviceMemory depth_image_memory;
-            vk::ImageView depth_image_view;
+            // Frame pacing, every submitted frame signals the next value of the timeline semaphore, a frame slot (or
+            // swapchain image) can be reused once the value it was last submitted with has been reached
+            vk::Semaphore frame_timeline;
+            uint64_t frame_value = 0;
+            std::vector<uint64_t> frame_values;
+            std::vector<uint64_t> image_values;
+            uint32_t frames_in_flight = 3;
+            bool latency_mode = false;
+            bool frame_ready = false;
+
+            // GPU timestamps at the start and end of every frame, read back once the frame's slot is waited on
+            std::vector<vk::QueryPool> timestamp_pools;
+            std::vector<bool> timestamps_written;
+            bool timestamps = false;
+            double timestamp_period = 0.0;
+            uint64_t last_gpu_end = 0;
+            frame_timings timings;
+
+            // Ring buffer for transient per-frame data, persistently mapped with one region per frame slot. Allocations
+            // are linear within the current frame's region which is reset once the slot's last frame has finished
+            vk::Buffer ring;
+            vk::DeviceMemory ring_memory;
+            uint8_t* ring_mapped = nullptr;
+            vk::DeviceSize ring_region_size = 0;
+            vk::DeviceSize ring_offset = 0;
+            vk::DeviceSize ring_alignment = 16;
+            vk::DeviceSize ring_high_water = 0;
+            vk::DeviceSize ring_required = 0;
+
+            // Objects destroyed once the frame timeline reaches their value, in the order they were queued
+            std::deque<deferred_destruction> deferred;
+
+            attachment depth;
+            attachment colour;
+            attachment offscreen_image;
+            std::vector<attachment_memory> attachment_pool;
+            vk::Format depth_format = vk::Format::eUndefined;
+            bool stencil = false;
+
+            // Render pass shared by every depth_target, it does not depend on the swapchain
+            vk::RenderPass depth_render_pass;
+            vk::Format depth_target_format = vk::Format::eUndefined;
 
             size_t current_frame = 0;
+            uint32_t image_index = 0;
             bool draw = false;
+            bool in_render_pass = false;
+
+            bool multi_draw_indirect = false;
+            bool draw_indirect_count = false;
+            bool descriptor_indexing = false;
+            uint32_t max_sampled_images = 0;
 
             vk::DispatchLoaderDynamic dldi;
             // If DEBUG is enabled, also include the messenger
@@ -81,6 +246,8 @@ namespace vulkan_wrapper {
         struct queue_family_indices {
             std::optional<uint32_t> graphics_family;
             std::optional<uint32_t> present_family;
+            std::optional<uint32_t> transfer_family;
+            std::optional<uint32_t> compute_family;
             [[nodiscard]] bool is_complete() const {
                 return graphics_family.has_value() && present_family.has_value();
             }
@@ -106,6 +273,38 @@ namespace vulkan_wrapper {
                 }
                 i++;
             }
+            // A transfer only family is a dedicated copy engine, otherwise any other family still runs alongside the
+            // graphics queue, failing that uploads share the graphics queue
+            i = 0;
+            for (const vk::QueueFamilyProperties& properties : queue_families) {
+                bool transfer = static_cast<bool>(properties.queueFlags & (vk::QueueFlagBits::eTransfer | vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute));
+                bool dedicated = !(properties.queueFlags & (vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute));
+                if (properties.queueCount > 0 && transfer && i != indices.graphics_family) {
+                    if (dedicated) {
+                        indices.transfer_family = i;
+                        break;
+                    }
+                    if (!indices.transfer_family.has_value()) {
+                        indices.transfer_family = i;
+                    }
+                }
+                i++;
+            }
+            if (!indices.transfer_family.has_value()) {
+                indices.transfer_family = indices.graphics_family;
+            }
+            // A compute family without graphics runs asynchronously to it, otherwise compute shares the graphics family
+            i = 0;
+            for (const vk::QueueFamilyProperties& properties : queue_families) {
+                if (properties.queueCount > 0 && (properties.queueFlags & vk::QueueFlagBits::eCompute) && !(properties.queueFlags & vk::QueueFlagBits::eGraphics)) {
+                    indices.compute_family = i;
+                    break;
+                }
+                i++;
+            }
+            if (!indices.compute_family.has_value()) {
+                indices.compute_family = indices.graphics_family;
+            }
             return indices;
         }
         // 'private' function only called from within this file, checks to see if the given physical device has all of
@@ -152,16 +351,22 @@ namespace vulkan_wrapper {
             }
             return available_formats[0];
         }
-        // 'private' function only called from within this file, chooses the best present mode given the available modes,
-        // the preferred mode is Mailbox, then Immediate and finally First-in-First-out is chosen as a fallback
-        vk::PresentModeKHR choose_swapchain_present_mode(const std::vector<vk::PresentModeKHR>& availableModes) {
+        // 'private' function only called from within this file, chooses the present mode for the given policy from the
+        // available modes. Low latency prefers Mailbox then Immediate, throughput prefers Immediate then Mailbox and
+        // power saving always uses First-in-First-out, which is also the fallback as it is always available
+        vk::PresentModeKHR choose_swapchain_present_mode(const std::vector<vk::PresentModeKHR>& availableModes, present_policy policy) {
+            if (policy == present_policy::power_saving) {
+                return vk::PresentModeKHR::eFifo;
+            }
+            vk::PresentModeKHR first = policy == present_policy::low_latency ? vk::PresentModeKHR::eMailbox : vk::PresentModeKHR::eImmediate;
+            vk::PresentModeKHR second = policy == present_policy::low_latency ? vk::PresentModeKHR::eImmediate : vk::PresentModeKHR::eMailbox;
             vk::PresentModeKHR bestMode = vk::PresentModeKHR::eFifo;
 
             for (const vk::PresentModeKHR mode : availableModes) {
-                if (mode == vk::PresentModeKHR::eMailbox) {
+                if (mode == first) {
                     return mode;
                 }
-                if (mode == vk::PresentModeKHR::eImmediate) {
+                if (mode == second) {
                     bestMode = mode;
                 }
             }
@@ -196,7 +401,18 @@ namespace vulkan_wrapper {
                 swapchain_adequate = !swapchain_support.formats.empty() && !swapchain_support.present_modes.empty();
             }
 
-            return indices.is_complete() && extensions_supported && swapchain_adequate;
+            // Frame pacing is built on timeline semaphores, core in Vulkan 1.2
+            bool timeline_semaphores = false;
+            if (physcial_device.getProperties().apiVersion >= VK_API_VERSION_1_2) {
+                auto features = physcial_device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceTimelineSemaphoreFeatures>();
+                timeline_semaphores = features.get<vk::PhysicalDeviceTimelineSemaphoreFeatures>().timelineSemaphore == VK_TRUE;
+            }
+
+            // Draws index their per-draw data by first instance and pick textures from an array by a per-draw index
+            vk::PhysicalDeviceFeatures features = physcial_device.getFeatures();
+            bool draw_features = features.drawIndirectFirstInstance == VK_TRUE && features.shaderSampledImageArrayDynamicIndexing == VK_TRUE;
+
+            return indices.is_complete() && extensions_supported && swapchain_adequate && timeline_semaphores && draw_features;
         }
         // 'private' function only called from within this file, returns the best format from the given formats for
         // the provided image tiling and feature flags, this is used to create the depth buffer
@@ -211,6 +427,496 @@ namespace vulkan_wrapper {
             }
             return vk::Format::eUndefined;
         }
+        // 'private' function only called from within this file, returns true if the given physical device offers the
+        // named (optional) device extension
+        bool has_device_extension(vk::PhysicalDevice pd, const char* name) {
+            for (const vk::ExtensionProperties& properties : pd.enumerateDeviceExtensionProperties(nullptr)) {
+                if (strcmp(properties.extensionName, name) == 0) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        // 'private' function only called from within this file, blocks until the frame timeline reaches the given value
+        void wait_timeline(uint64_t value) {
+            vk::SemaphoreWaitInfo semaphore_wait_info = {vk::SemaphoreWaitFlags(), 1, &info_p->frame_timeline, &value};
+            info_p->device.waitSemaphores(&semaphore_wait_info, std::numeric_limits<uint64_t>::max());
+        }
+        /**
+         * create_swapchain_images - Create Swapchain Images function creates the swapchain and an image view for each of
+         * its images, this is the only part of the swapchain resources which depends on the present mode
+         * @param old_swapchain - swapchain being replaced (may be null), its images can still be presented meanwhile
+         * @return - successful or not
+         */
+        bool create_swapchain_images(const vk::SwapchainKHR& old_swapchain) {
+            ///////////////////
+            //// SWAPCHAIN ////
+            ///////////////////
+
+            // Using all of the details provided by the functions above, the swapchain is created and swapchain images are
+            // retrieved
+            swapchain_support_details swapchain_support = query_swapchain_support(info_p->physical_device);
+
+            vk::SurfaceFormatKHR surface_format = choose_swapchain_surface_format(swapchain_support.formats);
+            vk::PresentModeKHR present_mode = choose_swapchain_present_mode(swapchain_support.present_modes, info_p->policy);
+            vk::Extent2D extent = choose_swapchain_extent(swapchain_support.capabilities);
+            // A minimised window has no area, there is nothing to present to until it is restored
+            if (extent.width == 0 || extent.height == 0) {
+                return false;
+            }
+
+            uint32_t image_count = swapchain_support.capabilities.minImageCount + 1;
+            if (swapchain_support.capabilities.maxImageCount > 0 && image_count > swapchain_support.capabilities.maxImageCount) {
+                image_count = swapchain_support.capabilities.maxImageCount;
+            }
+
+            queue_family_indices indices = find_queue_families(info_p->physical_device);
+            uint32_t  queue_family_indices[] = {indices.graphics_family.value(), indices.present_family.value()};
+            bool queue_different = indices.graphics_family != indices.present_family;
+
+            // Dynamic resolution blits the offscreen image into the swapchain image, so it needs to be a transfer
+            // destination and the format must be blittable with linear filtering
+            vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eColorAttachment;
+            bool transfer_dst = static_cast<bool>(swapchain_support.capabilities.supportedUsageFlags & vk::ImageUsageFlagBits::eTransferDst);
+            if (transfer_dst) {
+                usage |= vk::ImageUsageFlagBits::eTransferDst;
+            }
+            const vk::FormatFeatureFlags blit = vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst | vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+            info_p->resolution_supported = transfer_dst && (info_p->physical_device.getFormatProperties(surface_format.format).optimalTilingFeatures & blit) == blit;
+
+            vk::SwapchainCreateInfoKHR swapchain_create_info = {vk::SwapchainCreateFlagsKHR(), info_p->surface, image_count, surface_format.format,
+                                                                surface_format.colorSpace, extent, 1, usage,
+                                                                queue_different ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive,
+                                                                queue_different ? 2U : 0U, queue_different ? queue_family_indices : nullptr,
+                                                                swapchain_support.capabilities.currentTransform, vk::CompositeAlphaFlagBitsKHR::eOpaque,
+                                                                present_mode, VK_TRUE, old_swapchain};
+
+            info_p->swapchain = info_p->device.createSwapchainKHR(swapchain_create_info);
+
+            info_p->swapchain_images = info_p->device.getSwapchainImagesKHR(info_p->swapchain);
+            info_p->swapchain_image_format = surface_format.format;
+            info_p->swapchain_extent = extent;
+            info_p->present_mode = present_mode;
+
+            /////////////////////
+            //// IMAGE VIEWS ////
+            /////////////////////
+
+            // For all of the swapchain images their image view is created and stored so they can be bound to the framebuffers
+            info_p->swapchain_image_views.resize(info_p->swapchain_images.size());
+            for (uint32_t i = 0; i < info_p->swapchain_images.size(); i++) {
+                vk::ImageViewCreateInfo image_view_create_info = {vk::ImageViewCreateFlags(), info_p->swapchain_images[i], vk::ImageViewType::e2D, info_p->swapchain_image_format,
+                                                                {vk::ComponentSwizzle::eIdentity, vk::ComponentSwizzle::eIdentity, vk::ComponentSwizzle::eIdentity, vk::ComponentSwizzle::eIdentity},
+                                                                {vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1}};
+
+
+                info_p->swapchain_image_views[i] = info_p->device.createImageView(image_view_create_info);
+            }
+            return !!info_p->swapchain;
+        }
+        // 'private' function only called from within this file, creates the main render pass from the swapchain and
+        // depth formats
+        void create_render_pass() {
+            /////////////////////
+            //// RENDER PASS ////
+            /////////////////////
+
+            // A renderpass is created which is told about the swapchain and also the depth image, this is a simple
+            // implementation used for basic rendering. With multisampling the colour attachment is the multisampled
+            // image instead, it is never stored and the swapchain image (attachment 2) receives its resolve as the
+            // subpass ends, so the samples never leave the GPU's attachment memory. With dynamic resolution the image
+            // the pass ends in is the offscreen image instead of the swapchain's, left ready to be blitted from
+            bool multisampled = info_p->samples != vk::SampleCountFlagBits::e1;
+            vk::ImageLayout final_layout = info_p->offscreen ? vk::ImageLayout::eTransferSrcOptimal : vk::ImageLayout::ePresentSrcKHR;
+            vk::AttachmentDescription attachment_description = {vk::AttachmentDescriptionFlags(), info_p->swapchain_image_format, info_p->samples,
+                                                                vk::AttachmentLoadOp::eClear, multisampled ? vk::AttachmentStoreOp::eDontCare : vk::AttachmentStoreOp::eStore, vk::AttachmentLoadOp::eDontCare,
+                                                                vk::AttachmentStoreOp::eDontCare, vk::ImageLayout::eUndefined, multisampled ? vk::ImageLayout::eColorAttachmentOptimal : final_layout};
+            vk::AttachmentDescription depth_attachment_description = {vk::AttachmentDescriptionFlags(), info_p->depth_format, info_p->samples, vk::AttachmentLoadOp::eClear, vk::AttachmentStoreOp::eDontCare,
+                                                                      info_p->stencil ? vk::AttachmentLoadOp::eClear : vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eDontCare, vk::ImageLayout::eUndefined, vk::ImageLayout::eDepthStencilAttachmentOptimal};
+            vk::AttachmentDescription resolve_attachment_description = {vk::AttachmentDescriptionFlags(), info_p->swapchain_image_format, vk::SampleCountFlagBits::e1,
+                                                                        vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eStore, vk::AttachmentLoadOp::eDontCare,
+                                                                        vk::AttachmentStoreOp::eDontCare, vk::ImageLayout::eUndefined, final_layout};
+
+            vk::AttachmentReference attachment_reference = {0, vk::ImageLayout::eColorAttachmentOptimal};
+            vk::AttachmentReference depth_attachment_reference = {1, vk::ImageLayout::eDepthStencilAttachmentOptimal};
+            vk::AttachmentReference resolve_attachment_reference = {2, vk::ImageLayout::eColorAttachmentOptimal};
+
+            vk::SubpassDescription subpass_description = {vk::SubpassDescriptionFlags(), vk::PipelineBindPoint::eGraphics, 0, nullptr, 1, &attachment_reference, multisampled ? &resolve_attachment_reference : nullptr, &depth_attachment_reference, 0, nullptr};
+
+            // The offscreen image is reused every frame, so the pass also waits for the previous frame's blit to have read
+            // it, and the blit after the pass waits for the pass to have written it
+            vk::PipelineStageFlags src_stages = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+            if (info_p->offscreen) {
+                src_stages |= vk::PipelineStageFlagBits::eTransfer;
+            }
+            std::array<vk::SubpassDependency, 2> subpass_dependencies = {vk::SubpassDependency(~0U, 0, src_stages, vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::AccessFlags(),
+                                                                                               vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite, vk::DependencyFlags()),
+                                                                         vk::SubpassDependency(0, ~0U, vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eTransfer,
+                                                                                               vk::AccessFlagBits::eColorAttachmentWrite, vk::AccessFlagBits::eTransferRead, vk::DependencyFlags())};
+
+            std::array<vk::AttachmentDescription, 3> attachments = {attachment_description, depth_attachment_description, resolve_attachment_description};
+            vk::RenderPassCreateInfo render_pass_create_info = {vk::RenderPassCreateFlags(), multisampled ? 3U : 2U, attachments.data(), 1, &subpass_description,
+                                                                info_p->offscreen ? 2U : 1U, subpass_dependencies.data()};
+
+            info_p->render_pass = info_p->device.createRenderPass(render_pass_create_info);
+            info_p->render_pass_version++;
+        }
+        // 'private' function only called from within this file, creates a framebuffer for each swapchain image view
+        // using the render pass and depth image
+        void create_framebuffers() {
+            //////////////////////
+            //// FRAMEBUFFERS ////
+            //////////////////////
+
+            // For each of the swapchain images a framebuffer is created which references the depth image, and with
+            // multisampling the multisampled colour image which is resolved into the swapchain image. With dynamic
+            // resolution every framebuffer ends in the offscreen image instead, kept per image so indexing is unchanged
+            info_p->swapchain_framebuffers.resize(info_p->swapchain_image_views.size());
+
+            for (uint32_t i = 0; i < info_p->swapchain_framebuffers.size(); i++) {
+                vk::ImageView target = info_p->offscreen ? info_p->offscreen_image.view : info_p->swapchain_image_views[i];
+                std::vector<vk::ImageView> views = {target, info_p->depth.view};
+                if (info_p->colour.view) {
+                    views = {info_p->colour.view, info_p->depth.view, target};
+                }
+                vk::FramebufferCreateInfo framebuffer_create_info = {vk::FramebufferCreateFlags(), info_p->render_pass, static_cast<uint32_t>(views.size()), views.data(),
+                                                                    info_p->target_extent.width, info_p->target_extent.height, 1};
+
+                info_p->swapchain_framebuffers[i] = info_p->device.createFramebuffer(framebuffer_create_info);
+            }
+        }
+        // 'private' function only called from within this file, returns the last value the frame timeline has reached
+        uint64_t completed_frame_value() {
+            uint64_t value = 0;
+            info_p->device.getSemaphoreCounterValue(info_p->frame_timeline, &value);
+            return value;
+        }
+        // 'private' function only called from within this file, returns attachment memory to the pool, freeing the
+        // smallest block if the pool is full
+        void release_attachment_memory(const attachment_memory& memory) {
+            if (!memory.memory) return;
+            info_p->attachment_pool.push_back(memory);
+            if (info_p->attachment_pool.size() > ATTACHMENT_POOL_LIMIT) {
+                auto smallest = std::min_element(info_p->attachment_pool.begin(), info_p->attachment_pool.end(), [](const attachment_memory& a, const attachment_memory& b) { return a.size < b.size; });
+                info_p->device.freeMemory(smallest->memory);
+                info_p->attachment_pool.erase(smallest);
+            }
+        }
+        // 'private' function only called from within this file, destroys any object held by the deferred queue
+        void destroy_object(const deferred_object& object) {
+            struct destroyer {
+                const vk::Device& device;
+                void operator()(const vk::Pipeline& o) const { device.destroyPipeline(o); }
+                void operator()(const vk::PipelineLayout& o) const { device.destroyPipelineLayout(o); }
+                void operator()(const vk::Buffer& o) const { device.destroyBuffer(o); }
+                void operator()(const vk::DeviceMemory& o) const { device.freeMemory(o); }
+                void operator()(const vk::Image& o) const { device.destroyImage(o); }
+                void operator()(const vk::ImageView& o) const { device.destroyImageView(o); }
+                void operator()(const vk::Framebuffer& o) const { device.destroyFramebuffer(o); }
+                void operator()(const vk::Sampler& o) const { device.destroySampler(o); }
+                void operator()(const vk::RenderPass& o) const { device.destroyRenderPass(o); }
+                void operator()(const vk::SwapchainKHR& o) const { device.destroySwapchainKHR(o); }
+                void operator()(const attachment_memory& o) const { release_attachment_memory(o); }
+            };
+            std::visit(destroyer{info_p->device}, object);
+        }
+        // 'private' function only called from within this file, queues the object to be destroyed once the frame
+        // timeline reaches the given value
+        void defer(uint64_t value, const deferred_object& object) {
+            info_p->deferred.push_back({value, object});
+        }
+        /**
+         * collect_deferred - Collect Deferred function destroys the queued objects whose frames have finished on the
+         * GPU, values are queued in order (at most one frame apart) so it stops at the first one still in use
+         * @param all - destroy everything regardless, only when the device is idle
+         */
+        void collect_deferred(bool all) {
+            if (info_p->deferred.empty()) return;
+            uint64_t completed = all ? std::numeric_limits<uint64_t>::max() : completed_frame_value();
+            while (!info_p->deferred.empty() && info_p->deferred.front().value <= completed) {
+                destroy_object(info_p->deferred.front().object);
+                info_p->deferred.pop_front();
+            }
+        }
+        // 'private' function only called from within this file, starts recording a command buffer for the transfer
+        // queue, the transfer's staging buffer already holds the data
+        void record_transfer(transfer& t) {
+            vk::CommandBufferAllocateInfo command_buffer_allocate_info = {info_p->transfer_pool, vk::CommandBufferLevel::ePrimary, 1};
+            t.buffer = info_p->device.allocateCommandBuffers(command_buffer_allocate_info)[0];
+            vk::CommandBufferBeginInfo command_buffer_begin_info = {vk::CommandBufferUsageFlagBits::eOneTimeSubmit};
+            t.buffer.begin(command_buffer_begin_info);
+        }
+        /**
+         * begin_transfer - Begin Transfer function copies the given data into a pooled staging buffer and starts
+         * recording a command buffer for the transfer queue
+         * 'private' function only called from within this file
+         * @param size - size (in bytes) of the data
+         * @param data - data to upload
+         * @param t - returns the transfer, finished with end_transfer
+         * @return - successful or not
+         */
+        bool begin_transfer(vk::DeviceSize size, const void* data, transfer& t) {
+            if (!acquire_staging(size, t.staging)) {
+                return false;
+            }
+            memcpy(t.staging.data, data, size);
+            record_transfer(t);
+            return true;
+        }
+        // 'private' function only called from within this file, submits the transfer started by begin_transfer with the
+        // next value of the transfer timeline, the next frame waits for it
+        void end_transfer(transfer& t) {
+            t.buffer.end();
+            t.value = ++info_p->transfer_value;
+            vk::TimelineSemaphoreSubmitInfo timeline_submit_info = {0, nullptr, 1, &t.value};
+            vk::SubmitInfo submit_info = {0, nullptr, nullptr, 1, &t.buffer, 1, &info_p->transfer_timeline};
+            submit_info.pNext = &timeline_submit_info;
+            info_p->transfer_queue.submit(1, &submit_info, vk::Fence());
+            info_p->transfers.push_back(t);
+            info_p->acquire_value = t.value;
+        }
+        /**
+         * collect_transfers - Collect Transfers function releases the staging buffers and command buffers of uploads the
+         * transfer queue has finished, they finish in order so it stops at the first one still running
+         * 'private' function only called from within this file
+         * @param all - release everything regardless, only when the device is idle
+         */
+        void collect_transfers(bool all) {
+            if (info_p->transfers.empty()) return;
+            uint64_t completed = std::numeric_limits<uint64_t>::max();
+            if (!all) {
+                info_p->device.getSemaphoreCounterValue(info_p->transfer_timeline, &completed);
+            }
+            while (!info_p->transfers.empty() && info_p->transfers.front().value <= completed) {
+                transfer& t = info_p->transfers.front();
+                info_p->device.freeCommandBuffers(info_p->transfer_pool, 1, &t.buffer);
+                release_staging(t.staging);
+                info_p->transfers.pop_front();
+            }
+        }
+        /**
+         * create_ring - Create Ring function creates the ring buffer with a region of the given size for every frame slot
+         * and maps it for the lifetime of the buffer
+         * @param region_size - size (in bytes) of each frame's region
+         * @return - successful or not
+         */
+        bool create_ring(vk::DeviceSize region_size) {
+            region_size = (region_size + info_p->ring_alignment - 1) / info_p->ring_alignment * info_p->ring_alignment;
+            if (!create_shared_buffer(info_p->ring, info_p->ring_memory, region_size * MAX_FRAMES_IN_FLIGHT,
+                               vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer,
+                               vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent)) {
+                info_p->ring_region_size = 0;
+                return false;
+            }
+            info_p->ring_mapped = static_cast<uint8_t*>(info_p->device.mapMemory(info_p->ring_memory, 0, VK_WHOLE_SIZE));
+            info_p->ring_region_size = region_size;
+            return true;
+        }
+        /**
+         * grow_ring - Grow Ring function replaces the ring buffer with one whose regions are at least the given size,
+         * doubling the current size. The old ring stays mapped until it is destroyed once every frame submitted so far
+         * and the one being recorded have finished, so allocations already made from it stay valid
+         * @param required - size (in bytes) each region must hold
+         * @return - successful or not
+         */
+        bool grow_ring(vk::DeviceSize required) {
+            vk::DeviceSize region_size = std::max(info_p->ring_region_size, info_p->ring_alignment);
+            while (region_size < required) {
+                region_size *= 2;
+            }
+            defer(info_p->frame_value + 1, info_p->ring);
+            defer(info_p->frame_value + 1, info_p->ring_memory);
+            info_p->ring_offset = 0;
+            info_p->ring_required = 0;
+            return create_ring(region_size);
+        }
+        /**
+         * begin_command_buffer - Begin Command Buffer function ends the command buffer being recorded (if any) and starts
+         * recording into the next free one of the current frame, allocating another only if every one is in use
+         * 'private' function only called from within this file
+         */
+        void begin_command_buffer() {
+            if (info_p->recording) {
+                info_p->recording.end();
+            }
+            Command& cmd = info_p->commands[info_p->current_frame];
+            if (cmd.used == cmd.buffers.size()) {
+                vk::CommandBufferAllocateInfo command_buffer_allocate_info = {cmd.pool, vk::CommandBufferLevel::ePrimary, 1};
+                cmd.buffers.push_back(info_p->device.allocateCommandBuffers(command_buffer_allocate_info)[0]);
+                info_p->stats.allocations++;
+            }
+            info_p->recording = cmd.buffers[cmd.used++];
+            vk::CommandBufferBeginInfo command_buffer_begin_info = {vk::CommandBufferUsageFlagBits::eOneTimeSubmit};
+            info_p->recording.begin(command_buffer_begin_info);
+        }
+        // 'private' function only called from within this file, returns the index of a memory type matching both the
+        // requirement bits and all of the given property flags, or uint32_t max if none match
+        uint32_t find_memory_type(uint32_t type_bits, const vk::MemoryPropertyFlags& properties) {
+            vk::PhysicalDeviceMemoryProperties physcial_device_memory_properties = info_p->physical_device.getMemoryProperties();
+            for (uint32_t i = 0; i < physcial_device_memory_properties.memoryTypeCount; i++) {
+                if ((type_bits & (1u << i)) && (physcial_device_memory_properties.memoryTypes[i].propertyFlags & properties) == properties) {
+                    return i;
+                }
+            }
+            return std::numeric_limits<uint32_t>::max();
+        }
+        /**
+         * create_attachment - Create Attachment function creates an image the size of the main render pass (see
+         * target_extent), when it is only used within the pass its contents never need to reach memory. It is then
+         * marked transient and bound to lazily allocated memory where the device has it (tile based GPUs may then never
+         * back it at all), and takes a block from the attachment pool when one fits so resizing rarely allocates
+         * 'private' function only called from within this file
+         * @param a - returns the attachment
+         * @param format - format of the image
+         * @param usage - attachment usage (depth stencil or colour), anything else makes it a regular image
+         * @param aspect - aspect of the view
+         * @param samples - samples per pixel
+         */
+        void create_attachment(attachment& a, vk::Format format, vk::ImageUsageFlags usage, vk::ImageAspectFlags aspect, vk::SampleCountFlagBits samples) {
+            const vk::ImageUsageFlags attachment_usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eDepthStencilAttachment;
+            bool transient = !(usage & ~attachment_usage);
+            vk::ImageCreateInfo image_create_info = {vk::ImageCreateFlags(), vk::ImageType::e2D, format, vk::Extent3D(info_p->target_extent.width, info_p->target_extent.height, 1), 1, 1, samples,
+                                                     vk::ImageTiling::eOptimal, transient ? usage | vk::ImageUsageFlagBits::eTransientAttachment : usage, vk::SharingMode::eExclusive};
+            a.image = info_p->device.createImage(image_create_info);
+            vk::MemoryRequirements memory_requirements = info_p->device.getImageMemoryRequirements(a.image);
+            uint32_t chosen = std::numeric_limits<uint32_t>::max();
+            if (transient) {
+                chosen = find_memory_type(memory_requirements.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal | vk::MemoryPropertyFlagBits::eLazilyAllocated);
+            }
+            if (chosen == std::numeric_limits<uint32_t>::max()) {
+                chosen = find_memory_type(memory_requirements.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal);
+            }
+
+            // Smallest pooled block of the same type which fits without wasting more than half of it
+            auto best = info_p->attachment_pool.end();
+            for (auto it = info_p->attachment_pool.begin(); it != info_p->attachment_pool.end(); ++it) {
+                if (it->type == chosen && it->size >= memory_requirements.size && it->size <= memory_requirements.size * 2 && (best == info_p->attachment_pool.end() || it->size < best->size)) {
+                    best = it;
+                }
+            }
+            if (best != info_p->attachment_pool.end()) {
+                a.memory = *best;
+                info_p->attachment_pool.erase(best);
+            }
+            else {
+                vk::MemoryAllocateInfo memory_allocate_info = {memory_requirements.size, chosen};
+                a.memory = {info_p->device.allocateMemory(memory_allocate_info), memory_requirements.size, chosen};
+            }
+            info_p->device.bindImageMemory(a.image, a.memory.memory, 0);
+
+            vk::ImageViewCreateInfo image_view_create_info = {vk::ImageViewCreateFlags(), a.image, vk::ImageViewType::e2D, format, vk::ComponentMapping(), vk::ImageSubresourceRange(aspect, 0, 1, 0, 1)};
+            a.view = info_p->device.createImageView(image_view_create_info);
+        }
+        // 'private' function only called from within this file, creates the depth attachment at the size of the
+        // main render pass
+        void create_depth_image() {
+            /////////////////////
+            //// DEPTH IMAGE ////
+            /////////////////////
+
+            // A simple depth image is created allong with its image view, this is used in the framebuffer to perform
+            // depth testing. A format with a stencil aspect is preferred so shadows can be marked in the stencil buffer,
+            // falling back to depth only if the device has none. It is cleared at the start of the pass and never
+            // stored, so it is a transient attachment (see create_attachment)
+            vk::Format depth_format = find_supported_format({vk::Format::eD24UnormS8Uint, vk::Format::eD32SfloatS8Uint, vk::Format::eD16UnormS8Uint}, vk::ImageTiling::eOptimal, vk::FormatFeatureFlagBits::eDepthStencilAttachment);
+            info_p->stencil = depth_format != vk::Format::eUndefined;
+            if (!info_p->stencil) {
+                depth_format = find_supported_format({vk::Format::eD32Sfloat, vk::Format::eD16Unorm}, vk::ImageTiling::eOptimal, vk::FormatFeatureFlagBits::eDepthStencilAttachment);
+            }
+            info_p->depth_format = depth_format;
+            vk::ImageAspectFlags depth_aspect = info_p->stencil ? vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil : vk::ImageAspectFlagBits::eDepth;
+            create_attachment(info_p->depth, depth_format, vk::ImageUsageFlagBits::eDepthStencilAttachment, depth_aspect, info_p->samples);
+        }
+        // 'private' function only called from within this file, creates the multisampled colour attachment when
+        // multisampling, it is resolved into the swapchain image so never needs memory of its own (see create_attachment)
+        void create_colour_image() {
+            info_p->colour = {};
+            if (info_p->samples != vk::SampleCountFlagBits::e1) {
+                create_attachment(info_p->colour, info_p->swapchain_image_format, vk::ImageUsageFlagBits::eColorAttachment, vk::ImageAspectFlagBits::eColor, info_p->samples);
+            }
+        }
+        // 'private' function only called from within this file, decides whether the main render pass renders offscreen
+        // and the size its attachments are allocated at, large enough for the largest scale dynamic resolution may pick
+        void choose_target_extent() {
+            info_p->offscreen = info_p->resolution.enabled && info_p->resolution_supported;
+            info_p->target_extent = info_p->swapchain_extent;
+            if (info_p->offscreen) {
+                const vk::PhysicalDeviceLimits limits = info_p->physical_device.getProperties().limits;
+                info_p->target_extent.width = std::min(static_cast<uint32_t>(std::ceil(static_cast<float>(info_p->swapchain_extent.width) * info_p->resolution.max_scale)), limits.maxFramebufferWidth);
+                info_p->target_extent.height = std::min(static_cast<uint32_t>(std::ceil(static_cast<float>(info_p->swapchain_extent.height) * info_p->resolution.max_scale)), limits.maxFramebufferHeight);
+            }
+        }
+        // 'private' function only called from within this file, creates the image the main render pass ends in with
+        // dynamic resolution, it outlives the pass as it is blitted from afterwards so it is not transient
+        void create_offscreen_image() {
+            info_p->offscreen_image = {};
+            if (info_p->offscreen) {
+                create_attachment(info_p->offscreen_image, info_p->swapchain_image_format, vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc,
+                                  vk::ImageAspectFlagBits::eColor, vk::SampleCountFlagBits::e1);
+            }
+        }
+        /**
+         * update_render_extent - Update Render Extent function picks the extent the frame is rendered at. With dynamic
+         * resolution the scale follows the GPU time of the most recently finished frame, the pixel count goes with the
+         * square of the scale so it moves by the square root of how far the frame was from the target. Each GPU time is
+         * only used once, small errors are ignored and the move is damped so the scale settles rather than hunting
+         * 'private' function only called from within this file
+         */
+        void update_render_extent() {
+            if (!info_p->offscreen) {
+                info_p->resolution_scale = 1.0F;
+                info_p->render_extent = info_p->swapchain_extent;
+                return;
+            }
+            const resolution_settings& settings = info_p->resolution;
+            if (info_p->gpu_time_fresh && info_p->timings.gpu_time > 0.0) {
+                double ratio = settings.target_time / info_p->timings.gpu_time;
+                if (std::abs(ratio - 1.0) > RESOLUTION_DEADBAND) {
+                    double wanted = info_p->resolution_scale * std::sqrt(ratio);
+                    info_p->resolution_scale += static_cast<float>((wanted - info_p->resolution_scale) * RESOLUTION_DAMPING);
+                }
+            }
+            info_p->gpu_time_fresh = false;
+            info_p->resolution_scale = std::clamp(info_p->resolution_scale, settings.min_scale, settings.max_scale);
+
+            float scale = std::clamp(std::round(info_p->resolution_scale * RESOLUTION_STEPS) / RESOLUTION_STEPS, settings.min_scale, settings.max_scale);
+            uint32_t width = static_cast<uint32_t>(std::lround(static_cast<float>(info_p->swapchain_extent.width) * scale));
+            uint32_t height = static_cast<uint32_t>(std::lround(static_cast<float>(info_p->swapchain_extent.height) * scale));
+            info_p->render_extent = vk::Extent2D(std::clamp(width, 1U, info_p->target_extent.width), std::clamp(height, 1U, info_p->target_extent.height));
+        }
+        // 'private' function only called from within this file, sets the viewport and scissor of the main render pass
+        // to the render extent, they are dynamic so every command buffer recording into the pass needs them
+        void set_render_viewport() {
+            vk::Viewport viewport = {0.0F, 0.0F, static_cast<float>(info_p->render_extent.width), static_cast<float>(info_p->render_extent.height), 0.0F, 1.0F};
+            vk::Rect2D scissor = {{0, 0}, info_p->render_extent};
+            info_p->recording.setViewport(0, 1, &viewport);
+            info_p->recording.setScissor(0, 1, &scissor);
+        }
+        /**
+         * allocate_buffer - Allocate Buffer function creates a buffer from the given create info and binds it to newly
+         * allocated memory with the given properties
+         * 'private' function only called from within this file
+         * @return - successful or not
+         */
+        bool allocate_buffer(vk::Buffer& buffer, vk::DeviceMemory& memory, const vk::BufferCreateInfo& buffer_create_info, const vk::MemoryPropertyFlags& properties) {
+            if (!(buffer = info_p->device.createBuffer(buffer_create_info))) {
+                return false;
+            }
+            vk::MemoryRequirements memory_requirements = info_p->device.getBufferMemoryRequirements(buffer);
+
+            uint32_t chosen = find_memory_type(memory_requirements.memoryTypeBits, properties);
+            if (chosen == std::numeric_limits<uint32_t>::max()) {
+                info_p->device.destroyBuffer(buffer);
+                return false;
+            }
+            vk::MemoryAllocateInfo memory_allocate_info = {memory_requirements.size, chosen};
+            if (!(memory = info_p->device.allocateMemory(memory_allocate_info))) {
+                info_p->device.destroyBuffer(buffer);
+                return false;
+            }
+            info_p->device.bindBufferMemory(buffer, memory, 0);
+            return true;
+        }
     }
     /**
      * create_instance - Create Instance function creates a Vulkan instance using the given extensions
@@ -244,7 +950,7 @@ namespace vulkan_wrapper {
         extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 #endif
         // Create the instance, if DEBUG enabled include validation layers
-        vk::ApplicationInfo app_info = {"DMFP", 0x00400000/* 0000000000,0000000000,000000000000 */, "No Engine", 0x00400000, 0x00401000};
+        vk::ApplicationInfo app_info = {"DMFP", 0x00400000/* 0000000000,0000000000,000000000000 */, "No Engine", 0x00400000, VK_API_VERSION_1_2};
         vk::InstanceCreateInfo create_info = {vk::InstanceCreateFlags(), &app_info,
 #ifdef DEBUG_MODE
         static_cast<uint32_t>(validation_layers.size()), validation_layers.data(),
@@ -280,7 +986,7 @@ namespace vulkan_wrapper {
      * Firstly it finds a suitable physical device by checking each one with the @link is_device_suitable function.
      * Secondly it creates a virtual device and the graphics and present queues.
      * Thirdly it creates the command pools and buffers in order to send render commands to the GPU.
-     * Fourthly it creates synchronisation objects (semaphores and fences) in order to utilise double/triple buffering.
+     * Fourthly it creates synchronisation objects (semaphores and the frame timeline) in order to pace the frames in flight.
      * Lastly it calls the @link create_swapchain function to load the rest of the objects.
      * @return - If it successfully loaded everything
      */
@@ -309,21 +1015,69 @@ namespace vulkan_wrapper {
         queue_family_indices indices = find_queue_families(info_p->physical_device);
 
         std::vector<vk::DeviceQueueCreateInfo> queue_create_infos;
-        std::set<uint32_t> unique_queue_families = {indices.graphics_family.value(), indices.present_family.value()};
+        std::set<uint32_t> unique_queue_families = {indices.graphics_family.value(), indices.present_family.value(), indices.transfer_family.value(), indices.compute_family.value()};
 
-        // Create the graphics and present queues
+        // Create the graphics, present, transfer and compute queues
         float queue_priority = 1.0f;
         for (uint32_t queue_family : unique_queue_families) {
             vk::DeviceQueueCreateInfo queue_create_info = {vk::DeviceQueueCreateFlags(), queue_family, 1, &queue_priority};
                 queue_create_infos.push_back(queue_create_info);
         }
 
+        // Multi draw indirect lets a whole bucket of draws be submitted with a single call, draw indirect count lets
+        // the GPU decide how many of them to draw, both are optional and fallbacks are used when missing.
+        // First instance indexes the per-draw data and textures are picked from an array of samplers by an index which
+        // is uniform across each draw, both are required (see is_device_suitable)
+        vk::PhysicalDeviceFeatures supported_features = info_p->physical_device.getFeatures();
         vk::PhysicalDeviceFeatures device_features = {};
-        const std::vector<const char*> device_extensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+        device_features.multiDrawIndirect = supported_features.multiDrawIndirect;
+        device_features.drawIndirectFirstInstance = VK_TRUE;
+        device_features.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
+        info_p->multi_draw_indirect = supported_features.multiDrawIndirect == VK_TRUE;
+
+        std::vector<const char*> device_extensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+        if (has_device_extension(info_p->physical_device, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME)) {
+            device_extensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+            info_p->draw_indirect_count = true;
+        }
 #ifdef DEBUG_MODE
         const std::vector<const char*> validation_layers = {"VK_LAYER_LUNARG_standard_validation"};
 #endif
 
+        // Timeline semaphores are required (see is_device_suitable)
+        vk::PhysicalDeviceTimelineSemaphoreFeatures timeline_semaphore_features = {VK_TRUE};
+
+        // Descriptor indexing lets the texture array be large, only partly written and updated after it is bound, so it
+        // is bound once per frame however many textures there are. Optional, without it the array is kept small
+        auto indexing_features = info_p->physical_device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceDescriptorIndexingFeatures>().get<vk::PhysicalDeviceDescriptorIndexingFeatures>();
+        vk::PhysicalDeviceDescriptorIndexingFeatures descriptor_indexing_features;
+        if (indexing_features.descriptorBindingSampledImageUpdateAfterBind == VK_TRUE && indexing_features.descriptorBindingPartiallyBound == VK_TRUE) {
+            descriptor_indexing_features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+            descriptor_indexing_features.descriptorBindingPartiallyBound = VK_TRUE;
+            info_p->descriptor_indexing = true;
+        }
+        timeline_semaphore_features.pNext = &descriptor_indexing_features;
+        // Multisampling needs the colour, depth and stencil attachments to all support the sample count, 8 is plenty
+        vk::PhysicalDeviceLimits device_limits = info_p->physical_device.getProperties().limits;
+        vk::SampleCountFlags sample_counts = device_limits.framebufferColorSampleCounts & device_limits.framebufferDepthSampleCounts & device_limits.framebufferStencilSampleCounts;
+        for (vk::SampleCountFlagBits count : {vk::SampleCountFlagBits::e8, vk::SampleCountFlagBits::e4, vk::SampleCountFlagBits::e2}) {
+            if (static_cast<bool>(sample_counts & count)) {
+                info_p->max_samples = count;
+                break;
+            }
+        }
+        // Combined image samplers count against both the sampler and sampled image limits of the fragment stage
+        auto properties = info_p->physical_device.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceDescriptorIndexingProperties>();
+        if (info_p->descriptor_indexing) {
+            const vk::PhysicalDeviceDescriptorIndexingProperties& indexing_properties = properties.get<vk::PhysicalDeviceDescriptorIndexingProperties>();
+            info_p->max_sampled_images = std::min({indexing_properties.maxPerStageDescriptorUpdateAfterBindSamplers, indexing_properties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                                                   indexing_properties.maxDescriptorSetUpdateAfterBindSamplers, indexing_properties.maxDescriptorSetUpdateAfterBindSampledImages});
+        }
+        else {
+            const vk::PhysicalDeviceLimits& limits = properties.get<vk::PhysicalDeviceProperties2>().properties.limits;
+            info_p->max_sampled_images = std::min({limits.maxPerStageDescriptorSamplers, limits.maxPerStageDescriptorSampledImages, limits.maxDescriptorSetSamplers, limits.maxDescriptorSetSampledImages});
+        }
+
         vk::DeviceCreateInfo device_create_info = {vk::DeviceCreateFlags(), static_cast<uint32_t>(queue_create_infos.size()), queue_create_infos.data(),
             
 #ifdef  DEBUG_MODE
@@ -332,14 +1086,20 @@ namespace vulkan_wrapper {
             0, nullptr,
 #endif
                                                  static_cast<uint32_t>(device_extensions.size()), device_extensions.data(), &device_features};
+        device_create_info.pNext = &timeline_semaphore_features;
 
         // Create the device from the given physical device and get the queues and ids
         info_p->device = info_p->physical_device.createDevice(device_create_info);
+        info_p->dldi.init(info_p->instance, info_p->device);
 
         info_p->graphics_queue = info_p->device.getQueue(indices.graphics_family.value(), 0);
         info_p->present_queue = info_p->device.getQueue(indices.present_family.value(), 0);
         info_p->graphics_id = indices.graphics_family.value();
         info_p->present_id = indices.present_family.value();
+        info_p->transfer_queue = info_p->device.getQueue(indices.transfer_family.value(), 0);
+        info_p->transfer_id = indices.transfer_family.value();
+        info_p->compute_queue = info_p->device.getQueue(indices.compute_family.value(), 0);
+        info_p->compute_id = indices.compute_family.value();
 
         ///////////////////////
         //// COMMAND POOLS ////
@@ -353,15 +1113,26 @@ namespace vulkan_wrapper {
         for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
             info_p->commands[i].pool = info_p->device.createCommandPool(command_pool_create_info);
         }
+        vk::CommandPoolCreateInfo cached_pool_create_info = {vk::CommandPoolCreateFlagBits::eResetCommandBuffer, indices.graphics_family.value()};
+        info_p->cached_pool = info_p->device.createCommandPool(cached_pool_create_info);
+        // Upload command buffers are short lived and freed individually
+        vk::CommandPoolCreateInfo transfer_pool_create_info = {vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer, indices.transfer_family.value()};
+        info_p->transfer_pool = info_p->device.createCommandPool(transfer_pool_create_info);
+        // Each frame also has a pool for its async compute work, reset along with the frame's graphics pool
+        info_p->compute_commands.resize(MAX_FRAMES_IN_FLIGHT);
+        vk::CommandPoolCreateInfo compute_pool_create_info = {vk::CommandPoolCreateFlags(), indices.compute_family.value()};
+        for (Command& cmd : info_p->compute_commands) {
+            cmd.pool = info_p->device.createCommandPool(compute_pool_create_info);
+        }
 
         /////////////////////////
         //// COMMAND BUFFERS ////
         /////////////////////////
 
-        // Create one command buffer for each pool, this stores the rendering commands before they are sent to the GPU
+        // Allocate the command buffers each frame normally uses up front, these store the rendering commands before
+        // they are sent to the GPU and are reused every time the frame slot comes around
         for (Command& cmd : info_p->commands) {
-            cmd.buffers.resize(1);
-            vk::CommandBufferAllocateInfo command_buffer_allocate_info = {cmd.pool, vk::CommandBufferLevel::ePrimary, 1};
+            vk::CommandBufferAllocateInfo command_buffer_allocate_info = {cmd.pool, vk::CommandBufferLevel::ePrimary, COMMAND_BUFFERS_PER_FRAME};
             cmd.buffers = info_p->device.allocateCommandBuffers(command_buffer_allocate_info);
         }
 
@@ -373,19 +1144,68 @@ namespace vulkan_wrapper {
         // this is used as a barrier to prevent rendering to an in use framebuffer
         // The render finished semaphore is used to signal that the chosen image has finished being displayed,
         // this is used as a barrier to prevent deletion of an in use framebuffer
-        // The in flight fences are used as a way to communicate between the multiple framebuffers, keeping
-        // them synchronised
-        // One of each is needed per framebuffer used
+        // One of each is needed per frame slot, the swapchain only accepts binary semaphores
         info_p->image_available_semaphores.resize(MAX_FRAMES_IN_FLIGHT);
         info_p->render_finished_semaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        info_p->in_flight_fences.resize(MAX_FRAMES_IN_FLIGHT);
 
         vk::SemaphoreCreateInfo semaphore_create_info = {vk::SemaphoreCreateFlags()};
-        vk::FenceCreateInfo fence_create_info = {vk::FenceCreateFlagBits::eSignaled};
         for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
             info_p->image_available_semaphores[i] = info_p->device.createSemaphore(semaphore_create_info);
             info_p->render_finished_semaphores[i] = info_p->device.createSemaphore(semaphore_create_info);
-            info_p->in_flight_fences[i] = info_p->device.createFence(fence_create_info);
+        }
+
+        // A single timeline semaphore replaces the per-frame fences, the CPU waits on the value of the frame it needs
+        // finished instead of on a particular fence
+        vk::SemaphoreTypeCreateInfo semaphore_type_create_info = {vk::SemaphoreType::eTimeline, 0};
+        vk::SemaphoreCreateInfo timeline_create_info = {vk::SemaphoreCreateFlags()};
+        timeline_create_info.pNext = &semaphore_type_create_info;
+        info_p->frame_timeline = info_p->device.createSemaphore(timeline_create_info);
+        info_p->frame_values.resize(MAX_FRAMES_IN_FLIGHT, 0);
+        info_p->transfer_timeline = info_p->device.createSemaphore(timeline_create_info);
+        info_p->compute_timeline = info_p->device.createSemaphore(timeline_create_info);
+
+        // Timestamps are optional, without them the GPU times are reported as 0
+        info_p->timestamps = info_p->physical_device.getQueueFamilyProperties()[indices.graphics_family.value()].timestampValidBits > 0;
+        info_p->timestamp_period = info_p->physical_device.getProperties().limits.timestampPeriod;
+        if (info_p->timestamps) {
+            vk::QueryPoolCreateInfo query_pool_create_info = {vk::QueryPoolCreateFlags(), vk::QueryType::eTimestamp, TIMESTAMP_QUERIES};
+            info_p->timestamp_pools.resize(MAX_FRAMES_IN_FLIGHT);
+            for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+                info_p->timestamp_pools[i] = info_p->device.createQueryPool(query_pool_create_info);
+            }
+        }
+        info_p->timestamps_written.resize(MAX_FRAMES_IN_FLIGHT, false);
+
+        /////////////////////
+        //// RING BUFFER ////
+        /////////////////////
+
+        // Sub-allocations must satisfy the offset alignment of every use the ring allows
+        vk::PhysicalDeviceLimits limits = info_p->physical_device.getProperties().limits;
+        info_p->ring_alignment = std::max({static_cast<vk::DeviceSize>(16), limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment});
+        if (!create_ring(RING_REGION_SIZE)) {
+            return false;
+        }
+
+        ///////////////////////////
+        //// DEPTH RENDER PASS ////
+        ///////////////////////////
+
+        // Depth only passes (shadow maps) clear and write a single depth attachment which is then sampled, the
+        // dependencies make a new pass wait for last frame's reads and make its writes visible to this frame's reads
+        info_p->depth_target_format = find_supported_format({vk::Format::eD32Sfloat, vk::Format::eD16Unorm}, vk::ImageTiling::eOptimal, vk::FormatFeatureFlagBits::eDepthStencilAttachment | vk::FormatFeatureFlagBits::eSampledImage);
+        if (info_p->depth_target_format != vk::Format::eUndefined) {
+            vk::AttachmentDescription depth_target_description = {vk::AttachmentDescriptionFlags(), info_p->depth_target_format, vk::SampleCountFlagBits::e1, vk::AttachmentLoadOp::eClear, vk::AttachmentStoreOp::eStore,
+                                                                  vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eDontCare, vk::ImageLayout::eUndefined, vk::ImageLayout::eShaderReadOnlyOptimal};
+            vk::AttachmentReference depth_target_reference = {0, vk::ImageLayout::eDepthStencilAttachmentOptimal};
+            vk::SubpassDescription depth_subpass_description = {vk::SubpassDescriptionFlags(), vk::PipelineBindPoint::eGraphics, 0, nullptr, 0, nullptr, nullptr, &depth_target_reference, 0, nullptr};
+            std::array<vk::SubpassDependency, 2> depth_dependencies = {
+                    vk::SubpassDependency(~0U, 0, vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests,
+                                          vk::AccessFlagBits::eShaderRead, vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite, vk::DependencyFlags()),
+                    vk::SubpassDependency(0, ~0U, vk::PipelineStageFlagBits::eLateFragmentTests, vk::PipelineStageFlagBits::eFragmentShader,
+                                          vk::AccessFlagBits::eDepthStencilAttachmentWrite, vk::AccessFlagBits::eShaderRead, vk::DependencyFlags())};
+            vk::RenderPassCreateInfo depth_render_pass_create_info = {vk::RenderPassCreateFlags(), 1, &depth_target_description, 1, &depth_subpass_description, static_cast<uint32_t>(depth_dependencies.size()), depth_dependencies.data()};
+            info_p->depth_render_pass = info_p->device.createRenderPass(depth_render_pass_create_info);
         }
 
         // Create the swap chain (found below)
@@ -403,161 +1223,124 @@ namespace vulkan_wrapper {
      * @return successful or not
      */
     bool create_swapchain() {
-        info_p->device.waitIdle();
-        ///////////////////
-        //// SWAPCHAIN ////
-        ///////////////////
-
-        // Using all of the details provided by the functions above, the swapchain is created and swapchain images are
-        // retrieved
-        swapchain_support_details swapchain_support = query_swapchain_support(info_p->physical_device);
-
-        vk::SurfaceFormatKHR surface_format = choose_swapchain_surface_format(swapchain_support.formats);
-        vk::PresentModeKHR present_mode = choose_swapchain_present_mode(swapchain_support.present_modes);
-        vk::Extent2D extent = choose_swapchain_extent(swapchain_support.capabilities);
-
-        uint32_t image_count = swapchain_support.capabilities.minImageCount + 1;
-        if (swapchain_support.capabilities.maxImageCount > 0 && image_count > swapchain_support.capabilities.maxImageCount) {
-            image_count = swapchain_support.capabilities.maxImageCount;
-        }
-
-        queue_family_indices indices = find_queue_families(info_p->physical_device);
-        uint32_t  queue_family_indices[] = {indices.graphics_family.value(), indices.present_family.value()};
-        bool queue_different = indices.graphics_family != indices.present_family;
-
-        vk::SwapchainCreateInfoKHR swapchain_create_info = {vk::SwapchainCreateFlagsKHR(), info_p->surface, image_count, surface_format.format,
-                                                            surface_format.colorSpace, extent, 1, vk::ImageUsageFlagBits::eColorAttachment,
-                                                            queue_different ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive,
-                                                            queue_different ? 2U : 0U, queue_different ? queue_family_indices : nullptr,
-                                                            swapchain_support.capabilities.currentTransform, vk::CompositeAlphaFlagBitsKHR::eOpaque,
-                                                            present_mode, VK_TRUE};
-
-        info_p->swapchain = info_p->device.createSwapchainKHR(swapchain_create_info);
-
-        info_p->swapchain_images = info_p->device.getSwapchainImagesKHR(info_p->swapchain);
-        info_p->swapchain_image_format = surface_format.format;
-        info_p->swapchain_extent = extent;
-
-        /////////////////////
-        //// IMAGE VIEWS ////
-        /////////////////////
-
-        // For all of the swapchain images their image view is created and stored so they can be bound to the framebuffers
-        info_p->swapchain_image_views.resize(info_p->swapchain_images.size());
-        for (uint32_t i = 0; i < info_p->swapchain_images.size(); i++) {
-            vk::ImageViewCreateInfo image_view_create_info = {vk::ImageViewCreateFlags(), info_p->swapchain_images[i], vk::ImageViewType::e2D, info_p->swapchain_image_format,
-                                                            {vk::ComponentSwizzle::eIdentity, vk::ComponentSwizzle::eIdentity, vk::ComponentSwizzle::eIdentity, vk::ComponentSwizzle::eIdentity},
-                                                            {vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1}};
-
-
-            info_p->swapchain_image_views[i] = info_p->device.createImageView(image_view_create_info);
-        }
-
-        /////////////////////
-        //// DEPTH IMAGE ////
-        /////////////////////
-
-        // A simple depth image is created allong with its image view, this is used in the framebuffer to perform
-        // depth testing
-        vk::Format depth_format = find_supported_format({vk::Format::eD32Sfloat, vk::Format::eD32SfloatS8Uint, vk::Format::eD24UnormS8Uint}, vk::ImageTiling::eOptimal, vk::FormatFeatureFlagBits::eDepthStencilAttachment);
-
-        vk::ImageCreateInfo depth_image_create_info = {vk::ImageCreateFlags(), vk::ImageType::e2D, depth_format, vk::Extent3D(info_p->swapchain_extent.width, info_p->swapchain_extent.width, 1), 1, 1, vk::SampleCountFlagBits::e1, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eDepthStencilAttachment, vk::SharingMode::eExclusive};
-        info_p->depth_image = info_p->device.createImage(depth_image_create_info);
-        vk::MemoryRequirements memory_requirements = info_p->device.getImageMemoryRequirements(info_p->depth_image);
-
-        vk::PhysicalDeviceMemoryProperties physcial_device_memory_properties = info_p->physical_device.getMemoryProperties();
-
-        uint32_t chosen = std::numeric_limits<uint32_t>::max();
-        for (uint32_t i = 0; i < physcial_device_memory_properties.memoryTypeCount; i++) {
-            if ((memory_requirements.memoryTypeBits & (1u << i)) && (physcial_device_memory_properties.memoryTypes[i].propertyFlags & vk::MemoryPropertyFlagBits::eDeviceLocal) == vk::MemoryPropertyFlagBits::eDeviceLocal) {
-                chosen = i;
-            }
+        // Create the swapchain and its image views, see create_swapchain_images
+        if (!create_swapchain_images(vk::SwapchainKHR())) {
+            return false;
         }
 
-        vk::MemoryAllocateInfo memory_allocate_info = {memory_requirements.size, chosen};
-        info_p->depth_image_memory = info_p->device.allocateMemory(memory_allocate_info);
-        info_p->device.bindImageMemory(info_p->depth_image, info_p->depth_image_memory, 0);
-
-        vk::ImageViewCreateInfo depth_image_view_create_info = {vk::ImageViewCreateFlags(), info_p->depth_image, vk::ImageViewType::e2D, depth_format, vk::ComponentMapping(), vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eDepth, 0, 1, 0, 1)};
-        info_p->depth_image_view = info_p->device.createImageView(depth_image_view_create_info);
-
-
-        /////////////////////
-        //// RENDER PASS ////
-        /////////////////////
-
-        // A renderpass is created which is told about the swapchain and also the depth image, this is a simple
-        // implementation used for basic rendering
-
-        vk::AttachmentDescription attachment_description = {vk::AttachmentDescriptionFlags(), info_p->swapchain_image_format, vk::SampleCountFlagBits::e1,
-                                                            vk::AttachmentLoadOp::eClear, vk::AttachmentStoreOp::eStore, vk::AttachmentLoadOp::eDontCare,
-                                                            vk::AttachmentStoreOp::eDontCare, vk::ImageLayout::eUndefined, vk::ImageLayout::ePresentSrcKHR};
-        vk::AttachmentDescription depth_attachment_description = {vk::AttachmentDescriptionFlags(), depth_format, vk::SampleCountFlagBits::e1, vk::AttachmentLoadOp::eClear, vk::AttachmentStoreOp::eDontCare, vk::AttachmentLoadOp::eDontCare, vk::AttachmentStoreOp::eDontCare, vk::ImageLayout::eUndefined, vk::ImageLayout::eDepthStencilAttachmentOptimal};
-
-
-        vk::AttachmentReference attachment_reference = {0, vk::ImageLayout::eColorAttachmentOptimal};
-        vk::AttachmentReference depth_attachment_reference = {1, vk::ImageLayout::eDepthStencilAttachmentOptimal};
-
-        vk::SubpassDescription subpass_description = {vk::SubpassDescriptionFlags(), vk::PipelineBindPoint::eGraphics, 0, nullptr, 1, &attachment_reference, nullptr, &depth_attachment_reference, 0, nullptr};
-
-        vk::SubpassDependency subpass_dependency = {~0U, 0, vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::AccessFlags(),
-                                                    vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite, vk::DependencyFlags()};
-
-        std::array<vk::AttachmentDescription, 2> attachments = {attachment_description, depth_attachment_description};
-        vk::RenderPassCreateInfo render_pass_create_info = {vk::RenderPassCreateFlags(), attachments.size(), attachments.data(), 1, &subpass_description, 1, &subpass_dependency};
-
-        info_p->render_pass = info_p->device.createRenderPass(render_pass_create_info);
-
-        //////////////////////
-        //// FRAMEBUFFERS ////
-        //////////////////////
-
-        // For each of the swapchain images a framebuffer is created which references the depth image
-        info_p->swapchain_framebuffers.resize(info_p->swapchain_image_views.size());
-
-        for (uint32_t i = 0; i < info_p->swapchain_framebuffers.size(); i++) {
-            std::array<vk::ImageView, 2> views = {info_p->swapchain_image_views[i], info_p->depth_image_view};
-            vk::FramebufferCreateInfo framebuffer_create_info = {vk::FramebufferCreateFlags(), info_p->render_pass, views.size(), views.data(),
-                                                                info_p->swapchain_extent.width, info_p->swapchain_extent.height, 1};
-
-            info_p->swapchain_framebuffers[i] = info_p->device.createFramebuffer(framebuffer_create_info);
-        }
-        info_p->images_in_flight.resize(info_p->swapchain_images.size(), vk::Fence());
+        // Create the depth, colour and offscreen images, render pass and framebuffers, see the functions of the same name
+        choose_target_extent();
+        create_depth_image();
+        create_colour_image();
+        create_offscreen_image();
+        create_render_pass();
+        create_framebuffers();
+        info_p->image_values.assign(info_p->swapchain_images.size(), 0);
         return true;
     }
     /**
-     * create_vertex_buffer - Create Vertex Buffer function that creates a vertex buffer of the given size
+     * create_buffer - Create Buffer function creates a buffer of the given size and usage, backed by memory with all of
+     * the requested properties
      * @param buffer - returns the buffer
      * @param memory - returns the memory
      * @param size - size of the buffer
-     * @return successfuly or not
+     * @param usage - how the buffer will be used (vertex, storage, indirect...)
+     * @param properties - required memory properties (host visible, device local...)
+     * @return successful or not
      */
-    bool create_vertex_buffer(vk::Buffer& buffer, vk::DeviceMemory& memory, uint32_t size) {
-        vk::BufferCreateInfo buffer_create_info = {vk::BufferCreateFlags(), size, vk::BufferUsageFlagBits::eVertexBuffer, vk::SharingMode::eExclusive, 1, &info_p->graphics_id};
-        if (!(buffer = info_p->device.createBuffer(buffer_create_info))) {
+    bool create_buffer(vk::Buffer& buffer, vk::DeviceMemory& memory, vk::DeviceSize size, const vk::BufferUsageFlags& usage, const vk::MemoryPropertyFlags& properties) {
+        vk::BufferCreateInfo buffer_create_info = {vk::BufferCreateFlags(), size, usage, vk::SharingMode::eExclusive, 1, &info_p->graphics_id};
+        return allocate_buffer(buffer, memory, buffer_create_info, properties);
+    }
+    /**
+     * create_shared_buffer - Create Shared Buffer function is the same as create_buffer except that the buffer may be
+     * used by both the graphics and compute queues without ownership transfers, for buffers async compute work writes
+     * or reads every frame
+     * @param buffer - returns the buffer
+     * @param memory - returns the memory
+     * @param size - size (in bytes) of the buffer
+     * @param usage - how the buffer is used
+     * @param properties - required memory properties
+     * @return - successful or not
+     */
+    bool create_shared_buffer(vk::Buffer& buffer, vk::DeviceMemory& memory, vk::DeviceSize size, const vk::BufferUsageFlags& usage, const vk::MemoryPropertyFlags& properties) {
+        std::array<uint32_t, 2> families = {info_p->graphics_id, info_p->compute_id};
+        bool shared = info_p->graphics_id != info_p->compute_id;
+        vk::BufferCreateInfo buffer_create_info = {vk::BufferCreateFlags(), size, usage, shared ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive, shared ? 2U : 1U, families.data()};
+        return allocate_buffer(buffer, memory, buffer_create_info, properties);
+    }
+    /**
+     * create_depth_target - Create Depth Target function creates a layered depth image which can be rendered to one
+     * layer at a time with begin_depth_pass and sampled as a 2D array afterwards
+     * @param target - returns the image, memory, views and framebuffers
+     * @param size - width and height of every layer
+     * @param layers - number of layers
+     * @return - successful or not
+     */
+    bool create_depth_target(depth_target& target, uint32_t size, uint32_t layers) {
+        if (!info_p->depth_render_pass) {
             return false;
         }
-        vk::MemoryRequirements memory_requirements = info_p->device.getBufferMemoryRequirements(buffer);
-        vk::PhysicalDeviceMemoryProperties physcial_device_memory_properties = info_p->physical_device.getMemoryProperties();
-
-        uint32_t chosen = std::numeric_limits<uint32_t>::max();
-        for (uint32_t i = 0; i < physcial_device_memory_properties.memoryTypeCount; i++) {
-            if ((memory_requirements.memoryTypeBits & (1u << i)) && (physcial_device_memory_properties.memoryTypes[i].propertyFlags & (vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent))) {
-                chosen = i;
-            }
-        }
+        vk::ImageCreateInfo image_create_info = {vk::ImageCreateFlags(), vk::ImageType::e2D, info_p->depth_target_format, vk::Extent3D(size, size, 1), 1, layers, vk::SampleCountFlagBits::e1,
+                                                 vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eSampled, vk::SharingMode::eExclusive};
+        target.image = info_p->device.createImage(image_create_info);
+        vk::MemoryRequirements memory_requirements = info_p->device.getImageMemoryRequirements(target.image);
+        uint32_t chosen = find_memory_type(memory_requirements.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal);
         if (chosen == std::numeric_limits<uint32_t>::max()) {
-            info_p->device.destroyBuffer(buffer);
+            info_p->device.destroyImage(target.image);
             return false;
         }
         vk::MemoryAllocateInfo memory_allocate_info = {memory_requirements.size, chosen};
-        if (!(memory = info_p->device.allocateMemory(memory_allocate_info))) {
-            info_p->device.destroyBuffer(buffer);
-            return false;
+        target.memory = info_p->device.allocateMemory(memory_allocate_info);
+        info_p->device.bindImageMemory(target.image, target.memory, 0);
+
+        // One view of every layer for sampling and one view and framebuffer per layer for rendering
+        vk::ImageViewCreateInfo view_create_info = {vk::ImageViewCreateFlags(), target.image, vk::ImageViewType::e2DArray, info_p->depth_target_format, vk::ComponentMapping(), vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eDepth, 0, 1, 0, layers)};
+        target.view = info_p->device.createImageView(view_create_info);
+        target.layer_views.resize(layers);
+        target.framebuffers.resize(layers);
+        for (uint32_t i = 0; i < layers; i++) {
+            vk::ImageViewCreateInfo layer_view_create_info = {vk::ImageViewCreateFlags(), target.image, vk::ImageViewType::e2D, info_p->depth_target_format, vk::ComponentMapping(), vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eDepth, 0, 1, i, 1)};
+            target.layer_views[i] = info_p->device.createImageView(layer_view_create_info);
+            vk::FramebufferCreateInfo framebuffer_create_info = {vk::FramebufferCreateFlags(), info_p->depth_render_pass, 1, &target.layer_views[i], size, size, 1};
+            target.framebuffers[i] = info_p->device.createFramebuffer(framebuffer_create_info);
         }
-        info_p->device.bindBufferMemory(buffer, memory, 0);
+        target.size = size;
+        target.layers = layers;
         return true;
     }
+    /**
+     * destroy_depth_target - Destroy Depth Target function destroys everything created by create_depth_target
+     * @param target - depth target to destroy
+     */
+    void destroy_depth_target(const depth_target& target) {
+        for (uint32_t i = 0; i < target.layers; i++) {
+            info_p->device.destroyFramebuffer(target.framebuffers[i]);
+            info_p->device.destroyImageView(target.layer_views[i]);
+        }
+        info_p->device.destroyImageView(target.view);
+        info_p->device.destroyImage(target.image);
+        info_p->device.freeMemory(target.memory);
+    }
+    // Creates a sampler from the provided create info
+    bool create_sampler(vk::Sampler& sampler, const vk::SamplerCreateInfo& sampler_create_info) {
+        sampler = info_p->device.createSampler(sampler_create_info);
+        return !!sampler;
+    }
+    // Destroys the provided sampler
+    void destroy_sampler(const vk::Sampler& sampler) {
+        info_p->device.destroySampler(sampler);
+    }
+    /**
+     * create_vertex_buffer - Create Vertex Buffer function that creates a host visible vertex buffer of the given size
+     * @param buffer - returns the buffer
+     * @param memory - returns the memory
+     * @param size - size of the buffer
+     * @return successfuly or not
+     */
+    bool create_vertex_buffer(vk::Buffer& buffer, vk::DeviceMemory& memory, uint32_t size) {
+        return create_buffer(buffer, memory, size, vk::BufferUsageFlagBits::eVertexBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+    }
     /**
      * map_vertex_buffer - Map Vertex Buffer function copies the provided data into the provided device memory which is
      * given from the function above
@@ -566,9 +1349,7 @@ namespace vulkan_wrapper {
      * @param data - data to copy
      */
     void map_vertex_buffer(const vk::DeviceMemory& memory, uint32_t size, const void* data) {
-        void* mapped_memory = info_p->device.mapMemory(memory, 0, size);
-        memcpy(mapped_memory, data, size);
-        info_p->device.unmapMemory(memory);
+        map_buffer(memory, 0, size, data);
     }
     /**
      * destroy_vertex_buffer - Destroy Vertex Buffer function removes the allocated memory from the device
@@ -576,10 +1357,86 @@ namespace vulkan_wrapper {
      * @param memory - device memory provided
      */
     void destroy_vertex_buffer(const vk::Buffer& buffer, const vk::DeviceMemory& memory) {
+        destroy_buffer(buffer, memory);
+    }
+    /**
+     * map_buffer - Map Buffer function copies the provided data into host visible device memory at the given offset
+     * @param memory - memory to copy into
+     * @param offset - offset (in bytes) into the memory
+     * @param size - size (in bytes) to copy
+     * @param data - data to copy
+     */
+    void map_buffer(const vk::DeviceMemory& memory, vk::DeviceSize offset, vk::DeviceSize size, const void* data) {
+        void* mapped_memory = info_p->device.mapMemory(memory, offset, size);
+        memcpy(mapped_memory, data, size);
+        info_p->device.unmapMemory(memory);
+    }
+    /**
+     * map_memory - Map Memory function maps the whole of the given host visible memory and keeps it mapped, for buffers
+     * rewritten every frame. Host coherent memory needs no flushing. Unmap it with unmap_memory before it is freed
+     * @param memory - memory to map
+     * @return - pointer to the start of the memory
+     */
+    void* map_memory(const vk::DeviceMemory& memory) {
+        return info_p->device.mapMemory(memory, 0, VK_WHOLE_SIZE);
+    }
+    // Unmap memory mapped by map_memory
+    void unmap_memory(const vk::DeviceMemory& memory) {
+        info_p->device.unmapMemory(memory);
+    }
+    /**
+     * destroy_buffer - Destroy Buffer function removes the buffer and its allocated memory from the device
+     * @param buffer - buffer provided
+     * @param memory - device memory provided
+     */
+    void destroy_buffer(const vk::Buffer& buffer, const vk::DeviceMemory& memory) {
         info_p->device.destroyBuffer(buffer);
         info_p->device.freeMemory(memory);
     }
 
+    /**
+     * create_descriptor_set_layout - Create Descriptor Set Layout function creates a layout from the provided create info
+     * @param layout - created descriptor set layout
+     * @param layout_create_info - creation info
+     * @return successful or not
+     */
+    bool create_descriptor_set_layout(vk::DescriptorSetLayout& layout, const vk::DescriptorSetLayoutCreateInfo& layout_create_info) {
+        layout = info_p->device.createDescriptorSetLayout(layout_create_info);
+        return !!layout;
+    }
+    // Destroy the provided descriptor set layout
+    void destroy_descriptor_set_layout(const vk::DescriptorSetLayout& layout) {
+        info_p->device.destroyDescriptorSetLayout(layout);
+    }
+    /**
+     * create_descriptor_pool - Create Descriptor Pool function creates a pool to allocate descriptor sets from
+     * @param pool - created descriptor pool
+     * @param pool_create_info - creation info
+     * @return successful or not
+     */
+    bool create_descriptor_pool(vk::DescriptorPool& pool, const vk::DescriptorPoolCreateInfo& pool_create_info) {
+        pool = info_p->device.createDescriptorPool(pool_create_info);
+        return !!pool;
+    }
+    // Destroy the provided descriptor pool, this frees every set allocated from it
+    void destroy_descriptor_pool(const vk::DescriptorPool& pool) {
+        info_p->device.destroyDescriptorPool(pool);
+    }
+    /**
+     * allocate_descriptor_sets - Allocate Descriptor Sets function allocates sets from a pool
+     * @param sets - allocated sets, one per layout in the allocate info
+     * @param allocate_info - allocation info
+     * @return successful or not
+     */
+    bool allocate_descriptor_sets(std::vector<vk::DescriptorSet>& sets, const vk::DescriptorSetAllocateInfo& allocate_info) {
+        sets = info_p->device.allocateDescriptorSets(allocate_info);
+        return sets.size() == allocate_info.descriptorSetCount;
+    }
+    // Write the given buffer/image bindings into descriptor sets
+    void update_descriptor_sets(uint32_t count, const vk::WriteDescriptorSet* writes) {
+        info_p->device.updateDescriptorSets(count, writes, 0, nullptr);
+    }
+
     /**
      * create_shader_module - Create Shader Module creates a shader module from the given binary source
      * @param shader_module - created shader module
@@ -617,7 +1474,8 @@ namespace vulkan_wrapper {
     }
     /**
      * create_pipeline - Create Pipeline function creates the shader pipeline from the provided parameters, this is
-     * where certain aspects like alpha blending are enabled for shadows to work
+     * where certain aspects like alpha blending are enabled for shadows to work. The depth, stencil and colour write
+     * state comes from the given pipeline_state so shadow passes can share shaders with the normal pipeline
      * @param pipeline
      * @param pipeline_layout
      * @param shader_module_count
@@ -627,27 +1485,51 @@ namespace vulkan_wrapper {
      * @param vertex_attribute_description_count
      * @param vertex_attribute_descriptions
      * @param target_aspect
+     * @param state - depth, stencil and colour write state
      * @return - successful or not
      */
-    bool create_pipeline(vk::Pipeline& pipeline, const vk::PipelineLayout& pipeline_layout, uint32_t shader_module_count, const vk::PipelineShaderStageCreateInfo* shader_modules, uint32_t vertex_binding_description_count, const vk::VertexInputBindingDescription* vertex_binding_descriptions, uint32_t vertex_attribute_description_count, const vk::VertexInputAttributeDescription* vertex_attribute_descriptions, float target_aspect) {
+    bool create_pipeline(vk::Pipeline& pipeline, const vk::PipelineLayout& pipeline_layout, uint32_t shader_module_count, const vk::PipelineShaderStageCreateInfo* shader_modules, uint32_t vertex_binding_description_count, const vk::VertexInputBindingDescription* vertex_binding_descriptions, uint32_t vertex_attribute_description_count, const vk::VertexInputAttributeDescription* vertex_attribute_descriptions, float target_aspect, const pipeline_state& state) {
+        // Stencil state can only be used when the depth image has a stencil aspect
+        if (state.stencil_test && !info_p->stencil) {
+            return false;
+        }
+        // Depth only pipelines need the depth render pass
+        if (state.depth_only && !info_p->depth_render_pass) {
+            return false;
+        }
         vk::PipelineVertexInputStateCreateInfo pipeline_vertex_input_state_create_info = {vk::PipelineVertexInputStateCreateFlags(), vertex_binding_description_count, vertex_binding_descriptions, vertex_attribute_description_count, vertex_attribute_descriptions};
         vk::PipelineInputAssemblyStateCreateInfo pipeline_assembly_state_create_info = {vk::PipelineInputAssemblyStateCreateFlags(), vk::PrimitiveTopology::eTriangleList, VK_FALSE};
 
-        float width = info_p->swapchain_extent.width;
-        float height = info_p->swapchain_extent.height;
-        vk::Viewport viewport = {0.0f, 0.0f, width, height, 0.0f, 1.0f};
-        vk::Rect2D scissor = {{0, 0}, info_p->swapchain_extent};
-        vk::PipelineViewportStateCreateInfo pipeline_viewport_state_create_info = {vk::PipelineViewportStateCreateFlags(), 1, &viewport, 1, &scissor};
-        vk::PipelineRasterizationStateCreateInfo pipeline_rasterization_state_create_info = {vk::PipelineRasterizationStateCreateFlags(), VK_FALSE, VK_FALSE, vk::PolygonMode::eFill, vk::CullModeFlagBits::eNone, vk::FrontFace::eClockwise, VK_FALSE, 0.0f, 0.0f, 0.0f, 1.0f};
-        vk::PipelineMultisampleStateCreateInfo pipeline_multisample_state_create_info = {vk::PipelineMultisampleStateCreateFlags(), vk::SampleCountFlagBits::e1, VK_FALSE, 1.0f, nullptr, VK_FALSE, VK_FALSE};
-        vk::PipelineColorBlendAttachmentState pipeline_color_blend_attachment_state = {VK_TRUE, vk::BlendFactor::eSrcAlpha, vk::BlendFactor::eOneMinusSrcAlpha, vk::BlendOp::eAdd, vk::BlendFactor::eOne, vk::BlendFactor::eOneMinusSrcAlpha, vk::BlendOp::eAdd, vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA};
-        vk::PipelineColorBlendStateCreateInfo pipeline_color_blend_state_create_info = {vk::PipelineColorBlendStateCreateFlags(), VK_FALSE, vk::LogicOp::eCopy, 1, &pipeline_color_blend_attachment_state, {0.0f, 0.0f, 0.0f, 0.0f}};
-        vk::PipelineDepthStencilStateCreateInfo pipeline_depth_stencil_state_create_info = {vk::PipelineDepthStencilStateCreateFlags(), true, true, vk::CompareOp::eLess, false, false};
-
-        vk::GraphicsPipelineCreateInfo graphics_pipeline_create_info = {vk::PipelineCreateFlags(), shader_module_count, shader_modules, &pipeline_vertex_input_state_create_info, &pipeline_assembly_state_create_info, nullptr, &pipeline_viewport_state_create_info, &pipeline_rasterization_state_create_info, &pipeline_multisample_state_create_info, &pipeline_depth_stencil_state_create_info, &pipeline_color_blend_state_create_info, nullptr, pipeline_layout, info_p->render_pass, 0, vk::Pipeline(), -1};
+        // The viewport is dynamic, depth targets come in different sizes and the main render pass follows the render
+        // extent of dynamic resolution (see set_render_viewport)
+        vk::PipelineViewportStateCreateInfo pipeline_viewport_state_create_info = {vk::PipelineViewportStateCreateFlags(), 1, nullptr, 1, nullptr};
+        std::array<vk::DynamicState, 2> dynamic_states = {vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+        vk::PipelineDynamicStateCreateInfo pipeline_dynamic_state_create_info = {vk::PipelineDynamicStateCreateFlags(), static_cast<uint32_t>(dynamic_states.size()), dynamic_states.data()};
+        vk::PipelineRasterizationStateCreateInfo pipeline_rasterization_state_create_info = {vk::PipelineRasterizationStateCreateFlags(), VK_FALSE, VK_FALSE, vk::PolygonMode::eFill, vk::CullModeFlagBits::eNone, vk::FrontFace::eClockwise, state.depth_bias, state.depth_bias_constant, 0.0f, state.depth_bias_slope, 1.0f};
+        // Pipelines of the main render pass follow its sample count, depth targets are never multisampled
+        vk::PipelineMultisampleStateCreateInfo pipeline_multisample_state_create_info = {vk::PipelineMultisampleStateCreateFlags(), state.depth_only ? vk::SampleCountFlagBits::e1 : info_p->samples, VK_FALSE, 1.0f, nullptr, VK_FALSE, VK_FALSE};
+        vk::PipelineColorBlendAttachmentState pipeline_color_blend_attachment_state = {VK_TRUE, vk::BlendFactor::eSrcAlpha, vk::BlendFactor::eOneMinusSrcAlpha, vk::BlendOp::eAdd, vk::BlendFactor::eOne, vk::BlendFactor::eOneMinusSrcAlpha, vk::BlendOp::eAdd, state.colour_write ? vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA : vk::ColorComponentFlags()};
+        vk::PipelineColorBlendStateCreateInfo pipeline_color_blend_state_create_info = {vk::PipelineColorBlendStateCreateFlags(), VK_FALSE, vk::LogicOp::eCopy, state.depth_only ? 0U : 1U, &pipeline_color_blend_attachment_state, {0.0f, 0.0f, 0.0f, 0.0f}};
+        vk::PipelineDepthStencilStateCreateInfo pipeline_depth_stencil_state_create_info = {vk::PipelineDepthStencilStateCreateFlags(), true, state.depth_write, state.depth_compare, false, state.stencil_test, state.stencil, state.stencil};
+
+        vk::GraphicsPipelineCreateInfo graphics_pipeline_create_info = {vk::PipelineCreateFlags(), shader_module_count, shader_modules, &pipeline_vertex_input_state_create_info, &pipeline_assembly_state_create_info, nullptr, &pipeline_viewport_state_create_info, &pipeline_rasterization_state_create_info, &pipeline_multisample_state_create_info, &pipeline_depth_stencil_state_create_info, &pipeline_color_blend_state_create_info, &pipeline_dynamic_state_create_info, pipeline_layout, state.depth_only ? info_p->depth_render_pass : info_p->render_pass, 0, vk::Pipeline(), -1};
         pipeline = info_p->device.createGraphicsPipeline(vk::PipelineCache(), graphics_pipeline_create_info);
         return !!pipeline;
     }
+    /**
+     * create_compute_pipeline - Create Compute Pipeline function creates a compute pipeline from a single compute stage
+     * @param pipeline - created pipeline
+     * @param pipeline_layout - layout the compute shader uses
+     * @param shader_module - compute shader stage
+     * @return - successful or not
+     */
+    bool create_compute_pipeline(vk::Pipeline& pipeline, const vk::PipelineLayout& pipeline_layout, const vk::PipelineShaderStageCreateInfo& shader_module) {
+        vk::ComputePipelineCreateInfo compute_pipeline_create_info = {vk::PipelineCreateFlags(), shader_module, pipeline_layout, vk::Pipeline(), -1};
+        if (info_p->device.createComputePipelines(vk::PipelineCache(), 1, &compute_pipeline_create_info, nullptr, &pipeline) != vk::Result::eSuccess) {
+            return false;
+        }
+        return !!pipeline;
+    }
     /**
      * destroy_pipeline - Destroy Pipeline function destroys the provided pipeline
      * @param pipeline - pipeline to destroy
@@ -662,70 +1544,525 @@ namespace vulkan_wrapper {
      * @return successful or not
      */
     bool render_frame(void (*external_render)()) {
-        // Wait for image to become available
-        info_p->device.waitForFences(1, &info_p->in_flight_fences[info_p->current_frame], VK_TRUE, std::numeric_limits<uint64_t >::max());
-        // Retrieve the next available image
-        vk::ResultValue<uint32_t> result_value = info_p->device.acquireNextImageKHR(info_p->swapchain, std::numeric_limits<uint64_t >::max(), info_p->image_available_semaphores[info_p->current_frame], vk::Fence());
-        if (result_value.result == vk::Result::eErrorOutOfDateKHR) {
-            if (reload_swapchain()) {
-                return render_frame(external_render);
-            }
-            return false;
+        // Wait for the frame slot to become available, unless latency mode already waited before input was sampled
+        if (!info_p->frame_ready) {
+            wait_for_frame();
+        }
+        // Rebuild the swapchain if it was found to be out of date, the frame is skipped while there is nothing to
+        // present to (e.g the window is minimised)
+        if (info_p->swapchain_dirty && !reload_swapchain()) {
+            return true;
+        }
+        // Pick the extent this frame is rendered at, see update_render_extent
+        update_render_extent();
+        // Retrieve the next available image, if the swapchain is out of date it is rebuilt and this frame skipped, a
+        // suboptimal swapchain is still rendered to and rebuilt next frame
+        uint32_t currentIndex = 0;
+        vk::Result result = info_p->device.acquireNextImageKHR(info_p->swapchain, std::numeric_limits<uint64_t >::max(), info_p->image_available_semaphores[info_p->current_frame], vk::Fence(), &currentIndex);
+        if (result == vk::Result::eErrorOutOfDateKHR) {
+            info_p->swapchain_dirty = true;
+            return true;
         }
-        else if (result_value.result != vk::Result::eSuccess && result_value.result != vk::Result::eSuboptimalKHR) {
+        else if (result == vk::Result::eSuboptimalKHR) {
+            info_p->swapchain_dirty = true;
+        }
+        else if (result != vk::Result::eSuccess) {
             return false;
         }
         // Check if the image is ready to be rendered to
-        uint32_t currentIndex = result_value.value;
-        if (info_p->images_in_flight[currentIndex] != vk::Fence()) {
-            info_p->device.waitForFences(1, &info_p->images_in_flight[currentIndex], VK_TRUE, std::numeric_limits<uint64_t >::max());
+        info_p->image_index = currentIndex;
+        if (info_p->image_values[currentIndex] > 0) {
+            auto start = std::chrono::steady_clock::now();
+            wait_timeline(info_p->image_values[currentIndex]);
+            info_p->timings.cpu_wait += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
         }
-        info_p->images_in_flight[currentIndex] = info_p->in_flight_fences[info_p->current_frame];
-
-        // Remove all stored commands from last frame
-        info_p->device.resetCommandPool(info_p->commands[info_p->current_frame].pool, vk::CommandPoolResetFlagBits::eReleaseResources);
-
-        // Start a new command recording
-        vk::CommandBufferBeginInfo command_buffer_begin_info = {};
-        info_p->commands[info_p->current_frame].buffers[0].begin(command_buffer_begin_info);
-
-        // Clear the colour and depth images
-        std::array<vk::ClearValue, 2> clear_values{};
-        std::array<float, 4> colour = {0.0F, 0.0F, 0.0F, 1.0F};
-        clear_values[0].color = {colour};
-        clear_values[1].depthStencil = vk::ClearDepthStencilValue(1.0F, 0);
-
-        // Begin the render pass
-        vk::RenderPassBeginInfo render_pass_begin_info = {info_p->render_pass, info_p->swapchain_framebuffers[currentIndex], {{0, 0}, info_p->swapchain_extent}, clear_values.size(), clear_values.data()};
-        info_p->commands[info_p->current_frame].buffers[0].beginRenderPass(render_pass_begin_info, vk::SubpassContents::eInline);
+        info_p->image_values[currentIndex] = info_p->frame_value + 1;
+
+        // Remove all stored commands from last frame, the pool keeps its memory so recording the same amount again
+        // does not go back to the driver
+        Command& cmd = info_p->commands[info_p->current_frame];
+        info_p->device.resetCommandPool(cmd.pool, vk::CommandPoolResetFlags());
+        cmd.used = 0;
+        cmd.secondary_used = 0;
+        info_p->stats.allocations = 0;
+        Command& compute_cmd = info_p->compute_commands[info_p->current_frame];
+        info_p->device.resetCommandPool(compute_cmd.pool, vk::CommandPoolResetFlags());
+        compute_cmd.used = 0;
+
+        // Start a new command recording for the work before the render pass
+        info_p->recording = vk::CommandBuffer();
+        begin_command_buffer();
+        if (info_p->timestamps) {
+            info_p->recording.resetQueryPool(info_p->timestamp_pools[info_p->current_frame], 0, TIMESTAMP_QUERIES);
+            info_p->recording.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, info_p->timestamp_pools[info_p->current_frame], 0);
+        }
+        // Take ownership of everything uploaded from another queue family since the last frame, uploads started while
+        // this frame is recorded are left for the next one
+        vk::PipelineStageFlags acquire_stages = info_p->acquire_stages;
+        uint64_t acquire_value = info_p->acquire_value;
+        if (!info_p->acquire_buffers.empty() || !info_p->acquire_images.empty()) {
+            info_p->recording.pipelineBarrier(acquire_stages, acquire_stages, vk::DependencyFlags(), 0, nullptr, static_cast<uint32_t>(info_p->acquire_buffers.size()), info_p->acquire_buffers.data(),
+                                              static_cast<uint32_t>(info_p->acquire_images.size()), info_p->acquire_images.data());
+        }
+        info_p->acquire_buffers.clear();
+        info_p->acquire_images.clear();
+        info_p->acquire_stages = vk::PipelineStageFlags();
+        info_p->acquire_value = 0;
 
-        // Call the extenal renderer to add commands to the buffer
+        // Call the extenal renderer to add commands to the buffer, it may record work before the render pass and
+        // starts the pass itself with begin_render_pass, if it did not the pass is started here so the image is cleared
         info_p->draw = true;
         external_render();
+        if (!info_p->in_render_pass) {
+            begin_render_pass(false);
+        }
         info_p->draw = false;
 
-        // End the renderpass and finish the buffer
-        info_p->commands[info_p->current_frame].buffers[0].endRenderPass();
-        info_p->commands[info_p->current_frame].buffers[0].end();
-
-        // Tell the GPU how to use this command buffer by using the synchronisation objects
-        vk::Semaphore wait_semaphores[] = {info_p->image_available_semaphores[info_p->current_frame]};
-        vk::Semaphore signal_semaphores[] = {info_p->render_finished_semaphores[info_p->current_frame]};
-        vk::PipelineStageFlags pipeline_stage_flags[] = {vk::PipelineStageFlagBits::eColorAttachmentOutput};
-        vk::SubmitInfo submit_info = {1, wait_semaphores, pipeline_stage_flags, 1, &info_p->commands[info_p->current_frame].buffers[0], 1, signal_semaphores};
+        // End the renderpass (and any secondary command buffer left open) and record the work after it into its own buffer
+        end_secondary_commands();
+        info_p->recording.endRenderPass();
+        info_p->in_render_pass = false;
+        begin_command_buffer();
+        // With dynamic resolution the frame was rendered into part of the offscreen image, it is scaled up to fill the
+        // swapchain image which is then ready to present
+        if (info_p->offscreen) {
+            vk::Image swapchain_image = info_p->swapchain_images[currentIndex];
+            vk::ImageSubresourceRange range = {vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1};
+            vk::ImageMemoryBarrier to_transfer = {vk::AccessFlags(), vk::AccessFlagBits::eTransferWrite, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal,
+                                                  VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, swapchain_image, range};
+            info_p->recording.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags(), 0, nullptr, 0, nullptr, 1, &to_transfer);
+
+            vk::ImageSubresourceLayers layers = {vk::ImageAspectFlagBits::eColor, 0, 0, 1};
+            std::array<vk::Offset3D, 2> source = {vk::Offset3D(0, 0, 0), vk::Offset3D(static_cast<int32_t>(info_p->render_extent.width), static_cast<int32_t>(info_p->render_extent.height), 1)};
+            std::array<vk::Offset3D, 2> destination = {vk::Offset3D(0, 0, 0), vk::Offset3D(static_cast<int32_t>(info_p->swapchain_extent.width), static_cast<int32_t>(info_p->swapchain_extent.height), 1)};
+            vk::ImageBlit blit = {layers, source, layers, destination};
+            info_p->recording.blitImage(info_p->offscreen_image.image, vk::ImageLayout::eTransferSrcOptimal, swapchain_image, vk::ImageLayout::eTransferDstOptimal, 1, &blit, vk::Filter::eLinear);
+
+            vk::ImageMemoryBarrier to_present = {vk::AccessFlagBits::eTransferWrite, vk::AccessFlags(), vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::ePresentSrcKHR,
+                                                 VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, swapchain_image, range};
+            info_p->recording.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, vk::DependencyFlags(), 0, nullptr, 0, nullptr, 1, &to_present);
+        }
+        if (info_p->timestamps) {
+            info_p->recording.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, info_p->timestamp_pools[info_p->current_frame], 1);
+            info_p->timestamps_written[info_p->current_frame] = true;
+        }
+        info_p->recording.end();
+        info_p->recording = vk::CommandBuffer();
+        info_p->stats.buffers = cmd.used + cmd.secondary_used;
+
+        // Tell the GPU how to use the frame's command buffers by using the synchronisation objects, the frame signals the
+        // binary semaphore for presentation and the next value of the frame timeline. If anything was uploaded since the
+        // last frame it also waits for the transfer timeline, only where the uploads are first used
+        // The same goes for async compute work submitted during the frame
+        uint64_t frame_value = info_p->frame_value + 1;
+        uint32_t wait_count = 1;
+        std::array<vk::Semaphore, 3> wait_semaphores = {info_p->image_available_semaphores[info_p->current_frame]};
+        std::array<uint64_t, 3> wait_values = {0};
+        std::array<vk::PipelineStageFlags, 3> pipeline_stage_flags = {vk::PipelineStageFlagBits::eColorAttachmentOutput};
+        // The swapchain image is first written by the blit with dynamic resolution
+        if (info_p->offscreen) {
+            pipeline_stage_flags[0] |= vk::PipelineStageFlagBits::eTransfer;
+        }
+        if (acquire_value > 0) {
+            wait_semaphores[wait_count] = info_p->transfer_timeline;
+            wait_values[wait_count] = acquire_value;
+            pipeline_stage_flags[wait_count++] = acquire_stages ? acquire_stages : vk::PipelineStageFlags(vk::PipelineStageFlagBits::eTopOfPipe);
+        }
+        if (info_p->compute_wait_value > 0) {
+            wait_semaphores[wait_count] = info_p->compute_timeline;
+            wait_values[wait_count] = info_p->compute_wait_value;
+            pipeline_stage_flags[wait_count++] = info_p->compute_stages;
+        }
+        vk::Semaphore signal_semaphores[] = {info_p->render_finished_semaphores[info_p->current_frame], info_p->frame_timeline};
+        uint64_t signal_values[] = {0, frame_value};
+        vk::TimelineSemaphoreSubmitInfo timeline_submit_info = {wait_count, wait_values.data(), 2, signal_values};
+        vk::SubmitInfo submit_info = {wait_count, wait_semaphores.data(), pipeline_stage_flags.data(), cmd.used, cmd.buffers.data(), 2, signal_semaphores};
+        submit_info.pNext = &timeline_submit_info;
 
-        // Reset the fence currently in use
-        info_p->device.resetFences(1, &info_p->in_flight_fences[info_p->current_frame]);
         // Submit the commands to the GPU
-        info_p->graphics_queue.submit(1, &submit_info, info_p->in_flight_fences[info_p->current_frame]);
+        info_p->graphics_queue.submit(1, &submit_info, vk::Fence());
+        info_p->frame_value = frame_value;
+        info_p->frame_values[info_p->current_frame] = frame_value;
+        info_p->compute_stages = vk::PipelineStageFlags();
+        info_p->compute_wait_value = 0;
 
         // Tell the GPU to present the image
         vk::PresentInfoKHR present_info = {1, signal_semaphores, 1, &info_p->swapchain, &currentIndex};
-        info_p->present_queue.presentKHR(present_info);
+        result = info_p->present_queue.presentKHR(&present_info);
+        if (result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eSuboptimalKHR) {
+            info_p->swapchain_dirty = true;
+        }
+        else if (result != vk::Result::eSuccess) {
+            return false;
+        }
 
         (info_p->current_frame += 1) %= MAX_FRAMES_IN_FLIGHT;
+        info_p->frame_ready = false;
         return true;
     }
+    /**
+     * wait_for_frame - Wait For Frame function blocks until no more than the allowed number of frames are in flight
+     * and the next frame slot is free, the time spent waiting is recorded as the frame's CPU wait and the GPU timings
+     * of the frame last using the slot are read back. Called by render_frame unless already called this frame
+     */
+    void wait_for_frame() {
+        if (info_p->frame_ready) return;
+        // Frames are submitted in order, so waiting for the frame frames_in_flight - 1 before the next one also frees
+        // the slot being reused (which was last used MAX_FRAMES_IN_FLIGHT frames ago)
+        uint64_t next = info_p->frame_value + 1;
+        uint64_t wait_value = next > info_p->frames_in_flight ? next - info_p->frames_in_flight : 0;
+        wait_value = std::max(wait_value, info_p->frame_values[info_p->current_frame]);
+
+        auto start = std::chrono::steady_clock::now();
+        if (wait_value > 0) {
+            wait_timeline(wait_value);
+        }
+        info_p->timings.cpu_wait = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        // Anything queued for destruction by frames which have now finished can go, as can finished uploads
+        collect_deferred(false);
+        collect_transfers(false);
+
+        // The slot's region of the ring is free again, if the last frame ran out of room the ring is replaced by a
+        // larger one, the old one is destroyed once the frames using it have finished
+        info_p->ring_offset = 0;
+        if (info_p->ring_required > info_p->ring_region_size) {
+            grow_ring(info_p->ring_required);
+        }
+
+        // The GPU wait is the gap between the end of the previous frame and the start of this one on the GPU
+        if (info_p->timestamps && info_p->timestamps_written[info_p->current_frame]) {
+            std::array<uint64_t, TIMESTAMP_QUERIES> stamps = {};
+            if (info_p->device.getQueryPoolResults(info_p->timestamp_pools[info_p->current_frame], 0, TIMESTAMP_QUERIES, sizeof(stamps), stamps.data(), sizeof(uint64_t), vk::QueryResultFlagBits::e64) == vk::Result::eSuccess) {
+                double to_ms = info_p->timestamp_period / 1000000.0;
+                info_p->timings.gpu_time = static_cast<double>(stamps[1] - stamps[0]) * to_ms;
+                info_p->gpu_time_fresh = true;
+                info_p->timings.gpu_wait = info_p->last_gpu_end > 0 && stamps[0] > info_p->last_gpu_end ? static_cast<double>(stamps[0] - info_p->last_gpu_end) * to_ms : 0.0;
+                info_p->last_gpu_end = stamps[1];
+            }
+            info_p->timestamps_written[info_p->current_frame] = false;
+        }
+        info_p->frame_ready = true;
+    }
+    /**
+     * pace_frame - Pace Frame function is called by the game loop before input is sampled, in latency mode it waits for
+     * the frame here so the input used is as recent as possible when the frame is recorded
+     */
+    void pace_frame() {
+        if (info_p->latency_mode) {
+            wait_for_frame();
+        }
+    }
+    /**
+     * begin_render_pass - Begin Render Pass function clears the colour and depth images and starts the main render pass,
+     * anything recorded before this (e.g compute work) happens outside of the pass
+     * @param secondary - whether the pass is recorded in secondary command buffers (see begin_secondary_commands and
+     * execute_cached_commands), nothing can then be recorded into the pass directly
+     */
+    void begin_render_pass(bool secondary) {
+        if (!info_p->draw || info_p->in_render_pass) return;
+        // Clear the colour and depth images
+        std::array<vk::ClearValue, 2> clear_values{};
+        std::array<float, 4> colour = {0.0F, 0.0F, 0.0F, 1.0F};
+        clear_values[0].color = {colour};
+        clear_values[1].depthStencil = vk::ClearDepthStencilValue(1.0F, 0);
+
+        // Begin the render pass in a command buffer of its own
+        begin_command_buffer();
+        vk::RenderPassBeginInfo render_pass_begin_info = {info_p->render_pass, info_p->swapchain_framebuffers[info_p->image_index], {{0, 0}, info_p->render_extent}, clear_values.size(), clear_values.data()};
+        info_p->recording.beginRenderPass(render_pass_begin_info, secondary ? vk::SubpassContents::eSecondaryCommandBuffers : vk::SubpassContents::eInline);
+        if (!secondary) {
+            set_render_viewport();
+        }
+        info_p->in_render_pass = true;
+    }
+    /**
+     * begin_secondary_commands - Begin Secondary Commands function redirects recording into a secondary command buffer
+     * of the current frame, recycled like the frame's primary buffers. Must be inside a render pass begun for secondary
+     * command buffers, end_secondary_commands executes it in the pass
+     */
+    void begin_secondary_commands() {
+        if (!info_p->draw || !info_p->in_render_pass || info_p->primary) return;
+        Command& cmd = info_p->commands[info_p->current_frame];
+        if (cmd.secondary_used == cmd.secondary.size()) {
+            vk::CommandBufferAllocateInfo command_buffer_allocate_info = {cmd.pool, vk::CommandBufferLevel::eSecondary, 1};
+            cmd.secondary.push_back(info_p->device.allocateCommandBuffers(command_buffer_allocate_info)[0]);
+            info_p->stats.allocations++;
+        }
+        info_p->primary = info_p->recording;
+        info_p->recording = cmd.secondary[cmd.secondary_used++];
+        vk::CommandBufferInheritanceInfo inheritance_info = {info_p->render_pass, 0, info_p->swapchain_framebuffers[info_p->image_index]};
+        vk::CommandBufferBeginInfo command_buffer_begin_info = {vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue, &inheritance_info};
+        info_p->recording.begin(command_buffer_begin_info);
+        set_render_viewport();
+    }
+    // Ends the secondary command buffer started by begin_secondary_commands and executes it in the render pass
+    void end_secondary_commands() {
+        if (!info_p->primary) return;
+        info_p->recording.end();
+        info_p->primary.executeCommands(1, &info_p->recording);
+        info_p->recording = info_p->primary;
+        info_p->primary = vk::CommandBuffer();
+    }
+    /**
+     * begin_async_compute - Begin Async Compute function redirects recording into a command buffer of the current frame
+     * for the compute queue, so bind_compute_pipeline, dispatch and buffer_barrier record async compute work until
+     * end_async_compute. Must be outside of the render pass, buffers shared with graphics should be created with
+     * create_shared_buffer
+     */
+    void begin_async_compute() {
+        if (!info_p->draw || info_p->in_render_pass || info_p->primary) return;
+        Command& cmd = info_p->compute_commands[info_p->current_frame];
+        if (cmd.used == cmd.buffers.size()) {
+            vk::CommandBufferAllocateInfo command_buffer_allocate_info = {cmd.pool, vk::CommandBufferLevel::ePrimary, 1};
+            cmd.buffers.push_back(info_p->device.allocateCommandBuffers(command_buffer_allocate_info)[0]);
+            info_p->stats.allocations++;
+        }
+        info_p->primary = info_p->recording;
+        info_p->recording = cmd.buffers[cmd.used++];
+        vk::CommandBufferBeginInfo command_buffer_begin_info = {vk::CommandBufferUsageFlagBits::eOneTimeSubmit};
+        info_p->recording.begin(command_buffer_begin_info);
+    }
+    /**
+     * end_async_compute - End Async Compute function submits the work recorded since begin_async_compute to the compute
+     * queue straight away, the frame's graphics work waits for it at the given stages
+     * @param wait_stages - graphics stages which use the results (e.g draw indirect for culled commands), draw indirect
+     *                      when empty as a wait needs a stage
+     */
+    void end_async_compute(const vk::PipelineStageFlags& wait_stages) {
+        Command& cmd = info_p->compute_commands[info_p->current_frame];
+        if (!info_p->primary || cmd.used == 0 || info_p->recording != cmd.buffers[cmd.used - 1]) return;
+        info_p->recording.end();
+        uint64_t value = ++info_p->compute_value;
+        vk::TimelineSemaphoreSubmitInfo timeline_submit_info = {0, nullptr, 1, &value};
+        vk::SubmitInfo submit_info = {0, nullptr, nullptr, 1, &info_p->recording, 1, &info_p->compute_timeline};
+        submit_info.pNext = &timeline_submit_info;
+        info_p->compute_queue.submit(1, &submit_info, vk::Fence());
+        info_p->recording = info_p->primary;
+        info_p->primary = vk::CommandBuffer();
+        info_p->compute_wait_value = value;
+        info_p->compute_stages |= wait_stages ? wait_stages : vk::PipelineStageFlags(vk::PipelineStageFlagBits::eDrawIndirect);
+    }
+    // Returns whether async compute runs on a queue family of its own, alongside rendering
+    bool has_async_compute() {
+        return info_p->compute_id != info_p->graphics_id;
+    }
+    /**
+     * begin_cached_commands - Begin Cached Commands function (re)records the given cache, everything recorded until
+     * end_cached_commands goes into its secondary command buffer instead of the frame. The cache must not be in use by a
+     * frame still on the GPU, and may be recorded before the render pass begins
+     * @param cache - cache to record, its buffer is allocated the first time
+     */
+    void begin_cached_commands(cached_commands& cache) {
+        if (!info_p->draw || info_p->primary) return;
+        if (!cache.buffer) {
+            vk::CommandBufferAllocateInfo command_buffer_allocate_info = {info_p->cached_pool, vk::CommandBufferLevel::eSecondary, 1};
+            cache.buffer = info_p->device.allocateCommandBuffers(command_buffer_allocate_info)[0];
+        }
+        cache.buffer.reset(vk::CommandBufferResetFlags());
+        cache.recorded = false;
+        info_p->primary = info_p->recording;
+        info_p->recording = cache.buffer;
+        // Any framebuffer of the render pass may be used, so none is given
+        vk::CommandBufferInheritanceInfo inheritance_info = {info_p->render_pass, 0, vk::Framebuffer()};
+        vk::CommandBufferBeginInfo command_buffer_begin_info = {vk::CommandBufferUsageFlagBits::eRenderPassContinue, &inheritance_info};
+        info_p->recording.begin(command_buffer_begin_info);
+        set_render_viewport();
+    }
+    // Ends the recording started by begin_cached_commands, the cache stays valid until the render pass is recreated or
+    // the render extent changes
+    void end_cached_commands(cached_commands& cache) {
+        if (!info_p->primary || info_p->recording != cache.buffer) return;
+        info_p->recording.end();
+        info_p->recording = info_p->primary;
+        info_p->primary = vk::CommandBuffer();
+        cache.render_pass_version = info_p->render_pass_version;
+        cache.extent = info_p->render_extent;
+        cache.recorded = true;
+    }
+    // Returns whether the given cache has been recorded against the current render pass and render extent (its viewport
+    // is baked in) and can be executed
+    bool cached_commands_valid(const cached_commands& cache) {
+        return cache.recorded && cache.render_pass_version == info_p->render_pass_version && cache.extent == info_p->render_extent;
+    }
+    // Replays the given cache inside a render pass begun for secondary command buffers
+    void execute_cached_commands(const cached_commands& cache) {
+        if (!info_p->draw || !info_p->in_render_pass || info_p->primary || !cached_commands_valid(cache)) return;
+        info_p->recording.executeCommands(1, &cache.buffer);
+    }
+    // Frees the given cache's command buffer, it must no longer be in use by the GPU
+    void free_cached_commands(cached_commands& cache) {
+        if (cache.buffer) {
+            info_p->device.freeCommandBuffers(info_p->cached_pool, 1, &cache.buffer);
+        }
+        cache = cached_commands();
+    }
+    /**
+     * begin_depth_pass - Begin Depth Pass function clears one layer of the given depth target and starts rendering into
+     * it, must be ended with end_depth_pass before the main render pass begins
+     * @param target - depth target to render into
+     * @param layer - layer of the target
+     */
+    void begin_depth_pass(const depth_target& target, uint32_t layer) {
+        if (!info_p->draw || info_p->in_render_pass) return;
+        vk::ClearValue clear_value;
+        clear_value.depthStencil = vk::ClearDepthStencilValue(1.0F, 0);
+        vk::Rect2D area = {{0, 0}, {target.size, target.size}};
+        vk::RenderPassBeginInfo render_pass_begin_info = {info_p->depth_render_pass, target.framebuffers[layer], area, 1, &clear_value};
+        vk::CommandBuffer& buffer = info_p->recording;
+        buffer.beginRenderPass(render_pass_begin_info, vk::SubpassContents::eInline);
+        vk::Viewport viewport = {0.0F, 0.0F, static_cast<float>(target.size), static_cast<float>(target.size), 0.0F, 1.0F};
+        buffer.setViewport(0, 1, &viewport);
+        buffer.setScissor(0, 1, &area);
+        info_p->in_render_pass = true;
+    }
+    // Ends the depth pass started by begin_depth_pass
+    void end_depth_pass() {
+        if (!info_p->draw || !info_p->in_render_pass) return;
+        info_p->recording.endRenderPass();
+        info_p->in_render_pass = false;
+    }
+    // Returns whether a frame is being recorded, anything uploaded meanwhile is only acquired by the next frame
+    bool in_frame() {
+        return info_p->draw;
+    }
+    // Returns the index of the frame currently being recorded, used to pick per-frame resources
+    uint32_t get_frame_index() {
+        return static_cast<uint32_t>(info_p->current_frame);
+    }
+    // Returns the number of frames that may ever be in flight at once, i.e how many copies of per-frame resources are needed
+    uint32_t get_max_frames_in_flight() {
+        return MAX_FRAMES_IN_FLIGHT;
+    }
+    // Returns the number of frames currently allowed in flight
+    uint32_t get_frames_in_flight() {
+        return info_p->frames_in_flight;
+    }
+    // Sets the number of frames allowed in flight, between 1 (CPU and GPU never overlap) and get_max_frames_in_flight
+    void set_frames_in_flight(uint32_t count) {
+        info_p->frames_in_flight = std::max(1U, std::min(count, static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT)));
+    }
+    // Returns whether the frame wait happens before input is sampled (see pace_frame)
+    bool get_latency_mode() {
+        return info_p->latency_mode;
+    }
+    // Sets whether the frame wait happens before input is sampled (see pace_frame)
+    void set_latency_mode(bool enabled) {
+        info_p->latency_mode = enabled;
+    }
+    // Returns the current present policy
+    present_policy get_present_policy() {
+        return info_p->policy;
+    }
+    /**
+     * set_present_policy - Set Present Policy function changes how frames are presented, the swapchain is rebuilt at the
+     * start of the next frame (see reload_swapchain, the depth image and render pass are kept). Nothing is rebuilt if
+     * the policy resolves to the present mode already in use
+     * @param policy - new policy, the frame cap which goes with it is applied by the caller (see frame_limiter)
+     * @return - whether the policy's preferred present mode is available, false if it falls back (e.g low latency
+     * without Mailbox)
+     */
+    bool set_present_policy(present_policy policy) {
+        info_p->policy = policy;
+        std::vector<vk::PresentModeKHR> present_modes = info_p->physical_device.getSurfacePresentModesKHR(info_p->surface);
+        vk::PresentModeKHR present_mode = choose_swapchain_present_mode(present_modes, policy);
+        if (present_mode != info_p->present_mode) {
+            info_p->swapchain_dirty = true;
+        }
+        vk::PresentModeKHR preferred = policy == present_policy::low_latency ? vk::PresentModeKHR::eMailbox : policy == present_policy::throughput ? vk::PresentModeKHR::eImmediate : vk::PresentModeKHR::eFifo;
+        return present_mode == preferred;
+    }
+    // Returns the samples per pixel of the main render pass
+    uint32_t get_msaa_samples() {
+        return static_cast<uint32_t>(info_p->samples);
+    }
+    // Returns the most samples per pixel the main render pass may use on this device, at most 8
+    uint32_t get_max_msaa_samples() {
+        return static_cast<uint32_t>(info_p->max_samples);
+    }
+    /**
+     * set_msaa_samples - Set MSAA Samples function changes the samples per pixel of the main render pass, rounded down
+     * to 1, 2, 4 or 8 and clamped to get_max_msaa_samples. The render pass, attachments and framebuffers are rebuilt at
+     * the start of the next frame (see reload_swapchain), which changes the render pass version so pipelines must be
+     * created again
+     * @param samples - samples per pixel, 1 for no multisampling
+     * @return - the samples per pixel which will be used
+     */
+    uint32_t set_msaa_samples(uint32_t samples) {
+        uint32_t chosen = 1;
+        while (chosen * 2 <= std::min(samples, get_max_msaa_samples())) {
+            chosen *= 2;
+        }
+        if (chosen != get_msaa_samples()) {
+            info_p->samples = static_cast<vk::SampleCountFlagBits>(chosen);
+            info_p->attachments_dirty = true;
+            info_p->swapchain_dirty = true;
+        }
+        return chosen;
+    }
+    // Returns the version of the main render pass, it changes whenever the pass is recreated and every pipeline created
+    // for it must be created again
+    uint32_t get_render_pass_version() {
+        return info_p->render_pass_version;
+    }
+    // Returns whether the swapchain can be blitted into, which dynamic resolution needs
+    bool supports_dynamic_resolution() {
+        return info_p->resolution_supported;
+    }
+    // Returns the dynamic resolution settings, enabled is false if the device does not support it
+    const resolution_settings& get_resolution_settings() {
+        return info_p->resolution;
+    }
+    /**
+     * set_resolution_settings - Set Resolution Settings function changes the dynamic resolution settings, the scales are
+     * clamped to 0.25 - 1 (min_scale) and min_scale - 2 (max_scale). Turning it on or off or changing max_scale rebuilds
+     * the render pass and attachments at the start of the next frame (see reload_swapchain), which changes the render
+     * pass version so pipelines must be created again
+     * @param settings - new settings, only enabled if supports_dynamic_resolution
+     */
+    void set_resolution_settings(const resolution_settings& settings) {
+        resolution_settings chosen = settings;
+        chosen.enabled = chosen.enabled && info_p->resolution_supported;
+        chosen.min_scale = std::clamp(chosen.min_scale, MIN_RESOLUTION_SCALE, 1.0F);
+        chosen.max_scale = std::clamp(chosen.max_scale, chosen.min_scale, MAX_RESOLUTION_SCALE);
+        chosen.target_time = std::max(chosen.target_time, 0.1);
+        if (chosen.enabled != info_p->resolution.enabled || (chosen.enabled && chosen.max_scale != info_p->resolution.max_scale)) {
+            info_p->attachments_dirty = true;
+            info_p->swapchain_dirty = true;
+            // Start from the largest scale, the GPU times the controller sees until the rebuild are of the old extent
+            info_p->resolution_scale = chosen.max_scale;
+            info_p->gpu_time_fresh = false;
+        }
+        info_p->resolution = chosen;
+    }
+    // Returns the scale of the swapchain size the most recent frame was rendered at, 1 without dynamic resolution
+    float get_resolution_scale() {
+        return info_p->resolution_scale;
+    }
+    // Returns the number of command buffers the most recent frame used and how many had to be allocated for it
+    const command_stats& get_command_stats() {
+        return info_p->stats;
+    }
+    // Returns the CPU and GPU wait times of the most recent frame and GPU time of the most recently finished frame
+    const frame_timings& get_frame_timings() {
+        return info_p->timings;
+    }
+    // Returns whether draw_indirect_count is available on this device
+    bool supports_draw_indirect_count() {
+        return info_p->draw_indirect_count;
+    }
+    // Returns whether the depth image has a stencil aspect, pipelines using stencil_test need it
+    bool supports_stencil() {
+        return info_p->stencil;
+    }
+    // Returns whether sampled image descriptors can be partially bound and updated after being bound
+    bool supports_descriptor_indexing() {
+        return info_p->descriptor_indexing;
+    }
+    // Returns how many combined image samplers the fragment stage may see, the update after bind limits with descriptor
+    // indexing (see supports_descriptor_indexing)
+    uint32_t get_max_sampled_images() {
+        return info_p->max_sampled_images;
+    }
     // Returns the aspect ratio used to make correct perspective matrices
     float get_aspect_ratio() {
         return (float)info_p->swapchain_extent.width / (float)info_p->swapchain_extent.height;
@@ -733,33 +2070,198 @@ namespace vulkan_wrapper {
     // Bind the chosen pipeline to the command buffer
     void bind_pipeline(const vk::Pipeline& pipeline) {
         if (!info_p->draw) return;
-        info_p->commands[info_p->current_frame].buffers[0].bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+        info_p->recording.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
     }
     // Bind the chosen vertex buffer to the command buffer
     void bind_vertex_buffers(uint32_t count, const vk::Buffer* buffers, const vk::DeviceSize* offsets) {
         if (!info_p->draw) return;
-        info_p->commands[info_p->current_frame].buffers[0].bindVertexBuffers(0, count, buffers, offsets);
+        info_p->recording.bindVertexBuffers(0, count, buffers, offsets);
+    }
+    // Bind the chosen index buffer to the command buffer
+    void bind_index_buffer(const vk::Buffer& buffer, vk::DeviceSize offset, vk::IndexType type) {
+        if (!info_p->draw) return;
+        info_p->recording.bindIndexBuffer(buffer, offset, type);
     }
     // Push the constants to the command buffer
     void push_constants(const vk::PipelineLayout& layout, const vk::ShaderStageFlags& stage, uint32_t offset, uint32_t size, const void* ptr) {
         if (!info_p->draw) return;
-        info_p->commands[info_p->current_frame].buffers[0].pushConstants(layout, stage, offset, size, ptr);
+        info_p->recording.pushConstants(layout, stage, offset, size, ptr);
+    }
+    // Bind the chosen compute pipeline to the command buffer, must be called outside of the render pass
+    void bind_compute_pipeline(const vk::Pipeline& pipeline) {
+        if (!info_p->draw) return;
+        info_p->recording.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline);
+    }
+    // Bind descriptor sets for the given compute pipeline layout
+    void bind_compute_descriptor_sets(const vk::PipelineLayout& layout, uint32_t first_set, uint32_t count, const vk::DescriptorSet* sets) {
+        if (!info_p->draw) return;
+        info_p->recording.bindDescriptorSets(vk::PipelineBindPoint::eCompute, layout, first_set, count, sets, 0, nullptr);
+    }
+    // Dispatch the bound compute pipeline with the given number of workgroups
+    void dispatch(uint32_t x, uint32_t y, uint32_t z) {
+        if (!info_p->draw || info_p->in_render_pass) return;
+        info_p->recording.dispatch(x, y, z);
+    }
+    /**
+     * buffer_barrier - Buffer Barrier function makes writes to a buffer from one stage visible to reads in a later stage,
+     * e.g a compute shader writing indirect commands that are then read by draw_indirect
+     * @param buffer - buffer written and read
+     * @param src_stage - stage that wrote the buffer
+     * @param src_access - how it was written
+     * @param dst_stage - stage that will read the buffer
+     * @param dst_access - how it will be read
+     */
+    void buffer_barrier(const vk::Buffer& buffer, const vk::PipelineStageFlags& src_stage, const vk::AccessFlags& src_access, const vk::PipelineStageFlags& dst_stage, const vk::AccessFlags& dst_access) {
+        if (!info_p->draw || info_p->in_render_pass) return;
+        vk::BufferMemoryBarrier buffer_memory_barrier = {src_access, dst_access, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, buffer, 0, VK_WHOLE_SIZE};
+        info_p->recording.pipelineBarrier(src_stage, dst_stage, vk::DependencyFlags(), 0, nullptr, 1, &buffer_memory_barrier, 0, nullptr);
+    }
+    /**
+     * image_barrier - Image Barrier function transitions the given layers of an image to a new layout, making writes
+     * from one stage visible to a later stage. Used to give images their first layout before they are sampled
+     * @param image - image to transition
+     * @param range - aspect, mip levels and layers affected
+     * @param old_layout - current layout (eUndefined discards the contents)
+     * @param new_layout - layout after the barrier
+     * @param src_stage - stage that last used the image
+     * @param src_access - how it was used
+     * @param dst_stage - stage that will use the image
+     * @param dst_access - how it will be used
+     */
+    void image_barrier(const vk::Image& image, const vk::ImageSubresourceRange& range, vk::ImageLayout old_layout, vk::ImageLayout new_layout, const vk::PipelineStageFlags& src_stage, const vk::AccessFlags& src_access, const vk::PipelineStageFlags& dst_stage, const vk::AccessFlags& dst_access) {
+        if (!info_p->draw || info_p->in_render_pass) return;
+        vk::ImageMemoryBarrier image_memory_barrier = {src_access, dst_access, old_layout, new_layout, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, image, range};
+        info_p->recording.pipelineBarrier(src_stage, dst_stage, vk::DependencyFlags(), 0, nullptr, 0, nullptr, 1, &image_memory_barrier);
+    }
+    // Bind descriptor sets (e.g the per-draw storage buffer) for the given pipeline layout
+    void bind_descriptor_sets(const vk::PipelineLayout& layout, uint32_t first_set, uint32_t count, const vk::DescriptorSet* sets) {
+        if (!info_p->draw) return;
+        info_p->recording.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, layout, first_set, count, sets, 0, nullptr);
     }
     // Draw the supplied vertex buffer by submitting it to the command buffer
     void draw(uint32_t vertex_count, uint32_t instance_count, uint32_t first_vertex, uint32_t first_instance) {
         if (!info_p->draw) return;
-        info_p->commands[info_p->current_frame].buffers[0].draw(vertex_count, instance_count, first_vertex, first_instance);
+        info_p->recording.draw(vertex_count, instance_count, first_vertex, first_instance);
+    }
+    /**
+     * draw_indirect - Draw Indirect function draws using VkDrawIndirectCommand records stored in the given buffer, if the
+     * device lacks multiDrawIndirect the records are submitted one call each
+     * @param buffer - buffer holding the draw commands
+     * @param offset - offset (in bytes) of the first command
+     * @param draw_count - number of commands to draw
+     * @param stride - distance (in bytes) between commands
+     */
+    void draw_indirect(const vk::Buffer& buffer, vk::DeviceSize offset, uint32_t draw_count, uint32_t stride) {
+        if (!info_p->draw || draw_count == 0) return;
+        if (info_p->multi_draw_indirect) {
+            info_p->recording.drawIndirect(buffer, offset, draw_count, stride);
+            return;
+        }
+        for (uint32_t i = 0; i < draw_count; i++) {
+            info_p->recording.drawIndirect(buffer, offset + static_cast<vk::DeviceSize>(i) * stride, 1, stride);
+        }
+    }
+    /**
+     * draw_indirect_count - Draw Indirect Count function is the same as draw_indirect except that the number of commands
+     * is read by the GPU from count_buffer, see supports_draw_indirect_count
+     * @param buffer - buffer holding the draw commands
+     * @param offset - offset (in bytes) of the first command
+     * @param count_buffer - buffer holding the draw count
+     * @param count_offset - offset (in bytes) of the draw count
+     * @param max_draw_count - upper bound on the number of commands
+     * @param stride - distance (in bytes) between commands
+     */
+    void draw_indirect_count(const vk::Buffer& buffer, vk::DeviceSize offset, const vk::Buffer& count_buffer, vk::DeviceSize count_offset, uint32_t max_draw_count, uint32_t stride) {
+        if (!info_p->draw || max_draw_count == 0 || !info_p->draw_indirect_count) return;
+        info_p->recording.drawIndirectCountKHR(buffer, offset, count_buffer, count_offset, max_draw_count, stride, info_p->dldi);
+    }
+    /**
+     * draw_indexed_indirect - Draw Indexed Indirect function draws the bound index buffer using
+     * VkDrawIndexedIndirectCommand records stored in the given buffer, as with draw_indirect the records are submitted
+     * one call each if the device lacks multiDrawIndirect
+     * @param buffer - buffer holding the draw commands
+     * @param offset - offset (in bytes) of the first command
+     * @param draw_count - number of commands to draw
+     * @param stride - distance (in bytes) between commands
+     */
+    void draw_indexed_indirect(const vk::Buffer& buffer, vk::DeviceSize offset, uint32_t draw_count, uint32_t stride) {
+        if (!info_p->draw || draw_count == 0) return;
+        if (info_p->multi_draw_indirect) {
+            info_p->recording.drawIndexedIndirect(buffer, offset, draw_count, stride);
+            return;
+        }
+        for (uint32_t i = 0; i < draw_count; i++) {
+            info_p->recording.drawIndexedIndirect(buffer, offset + static_cast<vk::DeviceSize>(i) * stride, 1, stride);
+        }
+    }
+    // Same as draw_indexed_indirect except that the number of commands is read by the GPU, see draw_indirect_count
+    void draw_indexed_indirect_count(const vk::Buffer& buffer, vk::DeviceSize offset, const vk::Buffer& count_buffer, vk::DeviceSize count_offset, uint32_t max_draw_count, uint32_t stride) {
+        if (!info_p->draw || max_draw_count == 0 || !info_p->draw_indirect_count) return;
+        info_p->recording.drawIndexedIndirectCountKHR(buffer, offset, count_buffer, count_offset, max_draw_count, stride, info_p->dldi);
     }
 
-    // Used if the swapchain no longer matches up correctly
+    /**
+     * reload_swapchain - Reload Swapchain function rebuilds the swapchain when it no longer matches the surface or the
+     * present policy, without waiting for the GPU. The old swapchain is handed to the new one and it, its image views and
+     * framebuffers are queued for destruction once the frames which may use them have finished (see defer_destroy). The
+     * depth, colour and offscreen images and the render pass are only replaced if the size, format, sample count or
+     * dynamic resolution settings changed
+     * @return - successful or not, fails while the window has no area and is left marked for rebuilding
+     */
     bool reload_swapchain() {
-        destroy_swapchain();
-        return create_swapchain();
+        uint64_t value = info_p->frame_value;
+        vk::SwapchainKHR old_swapchain = info_p->swapchain;
+        vk::Extent2D old_extent = info_p->target_extent;
+        vk::Format old_format = info_p->swapchain_image_format;
+        bool old_supported = info_p->resolution_supported;
+        std::vector<vk::ImageView> old_image_views = info_p->swapchain_image_views;
+        if (!create_swapchain_images(old_swapchain)) {
+            info_p->swapchain = old_swapchain;
+            info_p->swapchain_image_views = old_image_views;
+            info_p->swapchain_dirty = true;
+            return false;
+        }
+        // Framebuffers go first as they reference the views, the swapchain goes last as it owns the images
+        for (const vk::Framebuffer& framebuffer : info_p->swapchain_framebuffers) {
+            defer(value, framebuffer);
+        }
+        for (const vk::ImageView& image_view : old_image_views) {
+            defer(value, image_view);
+        }
+        // The new surface format may not support the blit dynamic resolution needs
+        if (info_p->resolution_supported != old_supported) {
+            info_p->resolution.enabled = info_p->resolution.enabled && info_p->resolution_supported;
+            info_p->attachments_dirty = true;
+        }
+        choose_target_extent();
+        if (info_p->target_extent != old_extent || info_p->attachments_dirty) {
+            for (const attachment* a : {&info_p->depth, &info_p->colour, &info_p->offscreen_image}) {
+                if (a->image) {
+                    defer(value, a->view);
+                    defer(value, a->image);
+                    defer(value, a->memory);
+                }
+            }
+            create_depth_image();
+            create_colour_image();
+            create_offscreen_image();
+        }
+        if (info_p->swapchain_image_format != old_format || info_p->attachments_dirty) {
+            defer(value, info_p->render_pass);
+            create_render_pass();
+        }
+        info_p->attachments_dirty = false;
+        defer(value, old_swapchain);
+        create_framebuffers();
+        info_p->image_values.assign(info_p->swapchain_images.size(), 0);
+        info_p->swapchain_dirty = false;
+        return true;
     }
 
-    // Destroy all objects associated with the swapchain
+    // Destroy all objects associated with the swapchain, and anything still waiting in the deferred destruction queue
     void destroy_swapchain() {
         info_p->device.waitIdle();
+        collect_deferred(true);
         for (const vk::Framebuffer& framebuffer : info_p->swapchain_framebuffers) {
             info_p->device.destroyFramebuffer(framebuffer);
         }
@@ -768,9 +2270,335 @@ namespace vulkan_wrapper {
         for (const vk::ImageView& image_view : info_p->swapchain_image_views) {
             info_p->device.destroyImageView(image_view);
         }
+        for (const attachment* a : {&info_p->depth, &info_p->colour, &info_p->offscreen_image}) {
+            if (a->image) {
+                info_p->device.destroyImageView(a->view);
+                info_p->device.destroyImage(a->image);
+                info_p->device.freeMemory(a->memory.memory);
+            }
+        }
+        for (const attachment_memory& memory : info_p->attachment_pool) {
+            info_p->device.freeMemory(memory.memory);
+        }
+        info_p->attachment_pool.clear();
         info_p->device.destroySwapchainKHR(info_p->swapchain);
     }
 
+    /**
+     * ring_allocate - Ring Allocate function hands out part of the current frame's region of the ring buffer, it stays
+     * valid (and mapped) until the frame has finished on the GPU. Nothing has to be freed, the region is reset when the
+     * slot is reused
+     * @param size - size (in bytes) needed
+     * @param alignment - offset alignment needed, 0 for the default which suits vertex, index, uniform, storage and
+     * indirect use
+     * @param allocation - returns the buffer, offset and mapped pointer of the allocation
+     * @return - successful or not, fails when the region is full in which case the ring grows at the next frame (see
+     * ring_reserve to grow it straight away)
+     */
+    bool ring_allocate(vk::DeviceSize size, vk::DeviceSize alignment, ring_allocation& allocation) {
+        alignment = std::max(alignment, info_p->ring_alignment);
+        vk::DeviceSize offset = (info_p->ring_offset + alignment - 1) / alignment * alignment;
+        if (info_p->ring_region_size == 0 || offset + size > info_p->ring_region_size) {
+            info_p->ring_required = std::max(info_p->ring_required, offset + size);
+            return false;
+        }
+        info_p->ring_offset = offset + size;
+        info_p->ring_high_water = std::max(info_p->ring_high_water, info_p->ring_offset);
+        vk::DeviceSize base = info_p->ring_region_size * info_p->current_frame;
+        allocation.buffer = info_p->ring;
+        allocation.offset = base + offset;
+        allocation.size = size;
+        allocation.data = info_p->ring_mapped + base + offset;
+        return true;
+    }
+    /**
+     * ring_reserve - Ring Reserve function makes sure the given allocations (with the default alignment) all fit in what
+     * is left of the current frame's region, growing the ring straight away if they do not. Allocations made before
+     * stay valid in the old ring, the reserved ones then come from the new one
+     * @param count - number of allocations
+     * @param sizes - size (in bytes) of each allocation, in the order they will be made
+     * @return - successful or not, fails only if a larger ring could not be created
+     */
+    bool ring_reserve(uint32_t count, const vk::DeviceSize* sizes) {
+        auto needed = [&](vk::DeviceSize offset) {
+            for (uint32_t i = 0; i < count; i++) {
+                offset = (offset + info_p->ring_alignment - 1) / info_p->ring_alignment * info_p->ring_alignment + sizes[i];
+            }
+            return offset;
+        };
+        if (info_p->ring_region_size > 0 && needed(info_p->ring_offset) <= info_p->ring_region_size) {
+            return true;
+        }
+        return grow_ring(needed(0));
+    }
+    /**
+     * ring_upload - Ring Upload function allocates from the ring and copies the given data into it
+     * @param data - data to copy
+     * @param size - size (in bytes) to copy
+     * @param allocation - returns the allocation holding the data
+     * @return - successful or not, see ring_allocate
+     */
+    bool ring_upload(const void* data, vk::DeviceSize size, ring_allocation& allocation) {
+        if (!ring_allocate(size, 0, allocation)) {
+            return false;
+        }
+        memcpy(allocation.data, data, size);
+        return true;
+    }
+    // Returns the most bytes of the ring any single frame has used
+    vk::DeviceSize get_ring_high_water() {
+        return info_p->ring_high_water;
+    }
+    // Returns the size (in bytes) of each frame's region of the ring
+    vk::DeviceSize get_ring_region_size() {
+        return info_p->ring_region_size;
+    }
+    /**
+     * defer_destroy - Defer Destroy functions destroy the given object once every frame submitted so far, and the one
+     * being recorded, has finished on the GPU. Replaces wait_idle followed by the matching destroy function for objects
+     * which may still be in use, e.g hot-swapping pipelines or streaming buffers
+     * @param object - object to destroy, must not be used by frames recorded after this call
+     */
+    void defer_destroy(const vk::Pipeline& object) { defer(info_p->frame_value + 1, object); }
+    void defer_destroy(const vk::PipelineLayout& object) { defer(info_p->frame_value + 1, object); }
+    void defer_destroy(const vk::Buffer& object) { defer(info_p->frame_value + 1, object); }
+    void defer_destroy(const vk::DeviceMemory& object) { defer(info_p->frame_value + 1, object); }
+    void defer_destroy(const vk::Image& object) { defer(info_p->frame_value + 1, object); }
+    void defer_destroy(const vk::ImageView& object) { defer(info_p->frame_value + 1, object); }
+    void defer_destroy(const vk::Framebuffer& object) { defer(info_p->frame_value + 1, object); }
+    void defer_destroy(const vk::Sampler& object) { defer(info_p->frame_value + 1, object); }
+    // Destroys everything created by create_texture_image once the frames which may use it have finished
+    void defer_destroy(const texture_image& texture) {
+        defer_destroy(texture.view);
+        defer_destroy(texture.image);
+        defer_destroy(texture.memory);
+    }
+
+    // Returns whether uploads run on a queue family of their own, alongside rendering
+    bool has_transfer_queue() {
+        return info_p->transfer_id != info_p->graphics_id;
+    }
+    /**
+     * upload_buffer - Upload Buffer function copies data into a (device local) buffer through a staging buffer on the
+     * transfer queue, so it overlaps with rendering. The buffer needs eTransferDst usage and can be used from the next
+     * frame onwards, which waits for the upload and takes ownership of the buffer
+     * @param buffer - buffer to upload into
+     * @param offset - offset (in bytes) into the buffer
+     * @param size - size (in bytes) of the data
+     * @param data - data to upload
+     * @param dst_stage - stage that will first use the buffer
+     * @param dst_access - how it will be used
+     * @return - successful or not
+     */
+    bool upload_buffer(const vk::Buffer& buffer, vk::DeviceSize offset, vk::DeviceSize size, const void* data, const vk::PipelineStageFlags& dst_stage, const vk::AccessFlags& dst_access) {
+        transfer t = {};
+        if (size == 0 || !begin_transfer(size, data, t)) {
+            return false;
+        }
+        vk::BufferCopy region = {0, offset, size};
+        t.buffer.copyBuffer(t.staging, buffer, 1, &region);
+        // Ownership is released here and acquired by the next frame with a matching barrier
+        if (has_transfer_queue()) {
+            vk::BufferMemoryBarrier release = {vk::AccessFlagBits::eTransferWrite, vk::AccessFlags(), info_p->transfer_id, info_p->graphics_id, buffer, offset, size};
+            t.buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, vk::DependencyFlags(), 0, nullptr, 1, &release, 0, nullptr);
+            info_p->acquire_buffers.push_back({vk::AccessFlags(), dst_access, info_p->transfer_id, info_p->graphics_id, buffer, offset, size});
+        }
+        info_p->acquire_stages |= dst_stage;
+        end_transfer(t);
+        return true;
+    }
+    /**
+     * upload_image - Upload Image function copies data into part of an image through a staging buffer on the transfer
+     * queue, leaving it in the given layout. As with upload_buffer the image can be used from the next frame onwards
+     * @param image - image to upload into, needs eTransferDst usage
+     * @param subresource - aspect, mip level and layers written
+     * @param extent - size of the region written
+     * @param size - size (in bytes) of the data, tightly packed
+     * @param data - data to upload
+     * @param layout - layout the image is left in
+     * @param dst_stage - stage that will first use the image
+     * @param dst_access - how it will be used
+     * @return - successful or not
+     */
+    bool upload_image(const vk::Image& image, const vk::ImageSubresourceLayers& subresource, const vk::Extent3D& extent, vk::DeviceSize size, const void* data, vk::ImageLayout layout, const vk::PipelineStageFlags& dst_stage, const vk::AccessFlags& dst_access) {
+        staging_buffer staging;
+        if (size == 0 || !acquire_staging(size, staging)) {
+            return false;
+        }
+        memcpy(staging.data, data, size);
+        vk::BufferImageCopy region = {0, 0, 0, subresource, {0, 0, 0}, extent};
+        vk::ImageSubresourceRange range = {subresource.aspectMask, subresource.mipLevel, 1, subresource.baseArrayLayer, subresource.layerCount};
+        return upload_image(image, staging, 1, &region, range, layout, dst_stage, dst_access);
+    }
+    /**
+     * upload_image - Upload Image function copies regions of a filled staging buffer (see acquire_staging) into an image
+     * on the transfer queue, leaving the given range in the given layout. The staging buffer is handed over and returned
+     * to the pool once the upload has finished, even if recording fails
+     * @param image - image to upload into, needs eTransferDst usage
+     * @param staging - staging buffer holding the data
+     * @param region_count - number of regions
+     * @param regions - regions copied from the staging buffer
+     * @param range - every subresource written, transitioned to the layout
+     * @param layout - layout the range is left in
+     * @param dst_stage - stage that will first use the image
+     * @param dst_access - how it will be used
+     * @return - successful or not
+     */
+    bool upload_image(const vk::Image& image, const staging_buffer& staging, uint32_t region_count, const vk::BufferImageCopy* regions, const vk::ImageSubresourceRange& range, vk::ImageLayout layout, const vk::PipelineStageFlags& dst_stage, const vk::AccessFlags& dst_access) {
+        if (region_count == 0) {
+            release_staging(staging);
+            return false;
+        }
+        transfer t = {};
+        t.staging = staging;
+        record_transfer(t);
+        vk::ImageMemoryBarrier to_transfer = {vk::AccessFlags(), vk::AccessFlagBits::eTransferWrite, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, image, range};
+        t.buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags(), 0, nullptr, 0, nullptr, 1, &to_transfer);
+        t.buffer.copyBufferToImage(t.staging.buffer, image, vk::ImageLayout::eTransferDstOptimal, region_count, regions);
+        // The layout change happens as part of the ownership transfer, so the release and acquire barriers match
+        if (has_transfer_queue()) {
+            vk::ImageMemoryBarrier release = {vk::AccessFlagBits::eTransferWrite, vk::AccessFlags(), vk::ImageLayout::eTransferDstOptimal, layout, info_p->transfer_id, info_p->graphics_id, image, range};
+            t.buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, vk::DependencyFlags(), 0, nullptr, 0, nullptr, 1, &release);
+            info_p->acquire_images.push_back({vk::AccessFlags(), dst_access, vk::ImageLayout::eTransferDstOptimal, layout, info_p->transfer_id, info_p->graphics_id, image, range});
+        }
+        else {
+            vk::ImageMemoryBarrier to_layout = {vk::AccessFlagBits::eTransferWrite, vk::AccessFlags(), vk::ImageLayout::eTransferDstOptimal, layout, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, image, range};
+            t.buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, vk::DependencyFlags(), 0, nullptr, 0, nullptr, 1, &to_layout);
+        }
+        info_p->acquire_stages |= dst_stage;
+        end_transfer(t);
+        return true;
+    }
+    /**
+     * acquire_staging - Acquire Staging function hands out a persistently mapped staging buffer of at least the given
+     * size, reusing a released one where possible. Safe to call from any thread, so data can be written (e.g decoded)
+     * straight into it before it is passed to upload_image or given back with release_staging
+     * @param size - size (in bytes) needed
+     * @param staging - returns the buffer, memory, its full size and the mapped pointer
+     * @return - successful or not
+     */
+    bool acquire_staging(vk::DeviceSize size, staging_buffer& staging) {
+        {
+            std::lock_guard<std::mutex> lock(info_p->staging_mutex);
+            auto best = info_p->staging_pool.end();
+            for (auto it = info_p->staging_pool.begin(); it != info_p->staging_pool.end(); ++it) {
+                if (it->size >= size && (best == info_p->staging_pool.end() || it->size < best->size)) {
+                    best = it;
+                }
+            }
+            if (best != info_p->staging_pool.end()) {
+                staging = *best;
+                info_p->staging_pooled -= best->size;
+                info_p->staging_pool.erase(best);
+                return true;
+            }
+        }
+        vk::DeviceSize capacity = STAGING_MIN_SIZE;
+        while (capacity < size) {
+            capacity *= 2;
+        }
+        if (!create_buffer(staging.buffer, staging.memory, capacity, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent)) {
+            return false;
+        }
+        staging.size = capacity;
+        staging.data = info_p->device.mapMemory(staging.memory, 0, VK_WHOLE_SIZE);
+        return true;
+    }
+    /**
+     * release_staging - Release Staging function gives back a staging buffer which is not in use by the GPU, it is kept
+     * for reuse unless the pool is already full. Safe to call from any thread
+     * @param staging - staging buffer from acquire_staging
+     */
+    void release_staging(const staging_buffer& staging) {
+        if (!staging.buffer) return;
+        {
+            std::lock_guard<std::mutex> lock(info_p->staging_mutex);
+            if (info_p->staging_pooled + staging.size <= STAGING_POOL_LIMIT) {
+                info_p->staging_pool.push_back(staging);
+                info_p->staging_pooled += staging.size;
+                return;
+            }
+        }
+        info_p->device.unmapMemory(staging.memory);
+        destroy_buffer(staging.buffer, staging.memory);
+    }
+    /**
+     * create_texture_image - Create Texture Image function creates a device local, optimal tiled RGBA image which can be
+     * uploaded to, sampled and have its mips generated with generate_mipmaps. Mips are dropped if the device cannot
+     * linearly filter the format in a blit
+     * @param texture - returns the image, memory, view and size
+     * @param width - width of the largest mip
+     * @param height - height of the largest mip
+     * @param levels - number of mip levels wanted
+     * @return - successful or not
+     */
+    bool create_texture_image(texture_image& texture, uint32_t width, uint32_t height, uint32_t levels) {
+        const vk::Format format = vk::Format::eR8G8B8A8Unorm;
+        vk::FormatProperties properties;
+        info_p->physical_device.getFormatProperties(format, &properties);
+        const vk::FormatFeatureFlags blit = vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst | vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+        if ((properties.optimalTilingFeatures & blit) != blit) {
+            levels = 1;
+        }
+        vk::ImageCreateInfo image_create_info = {vk::ImageCreateFlags(), vk::ImageType::e2D, format, vk::Extent3D(width, height, 1), levels, 1, vk::SampleCountFlagBits::e1,
+                                                 vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled, vk::SharingMode::eExclusive};
+        texture.image = info_p->device.createImage(image_create_info);
+        vk::MemoryRequirements memory_requirements = info_p->device.getImageMemoryRequirements(texture.image);
+        uint32_t chosen = find_memory_type(memory_requirements.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal);
+        if (chosen == std::numeric_limits<uint32_t>::max()) {
+            info_p->device.destroyImage(texture.image);
+            return false;
+        }
+        vk::MemoryAllocateInfo memory_allocate_info = {memory_requirements.size, chosen};
+        if (!(texture.memory = info_p->device.allocateMemory(memory_allocate_info))) {
+            info_p->device.destroyImage(texture.image);
+            return false;
+        }
+        info_p->device.bindImageMemory(texture.image, texture.memory, 0);
+        vk::ImageViewCreateInfo view_create_info = {vk::ImageViewCreateFlags(), texture.image, vk::ImageViewType::e2D, format, vk::ComponentMapping(), vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, levels, 0, 1)};
+        texture.view = info_p->device.createImageView(view_create_info);
+        texture.width = width;
+        texture.height = height;
+        texture.levels = levels;
+        texture.size = memory_requirements.size;
+        return true;
+    }
+    // Destroys everything created by create_texture_image straight away, the GPU must no longer be using it
+    void destroy_texture_image(const texture_image& texture) {
+        info_p->device.destroyImageView(texture.view);
+        info_p->device.destroyImage(texture.image);
+        info_p->device.freeMemory(texture.memory);
+    }
+    /**
+     * generate_mipmaps - Generate Mipmaps function fills every mip of a texture by blitting each level down from the one
+     * above, then leaves the whole image ready to be sampled by fragment shaders. Recorded into the current frame before
+     * the render pass, the first level must already be in eTransferSrcOptimal (e.g uploaded in an earlier frame)
+     * @param texture - texture from create_texture_image
+     */
+    void generate_mipmaps(const texture_image& texture) {
+        if (!info_p->draw || info_p->in_render_pass) return;
+        int32_t width = static_cast<int32_t>(texture.width);
+        int32_t height = static_cast<int32_t>(texture.height);
+        for (uint32_t level = 1; level < texture.levels; level++) {
+            int32_t next_width = std::max(width / 2, 1);
+            int32_t next_height = std::max(height / 2, 1);
+            vk::ImageSubresourceRange range = {vk::ImageAspectFlagBits::eColor, level, 1, 0, 1};
+            vk::ImageMemoryBarrier to_dst = {vk::AccessFlags(), vk::AccessFlagBits::eTransferWrite, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, texture.image, range};
+            info_p->recording.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags(), 0, nullptr, 0, nullptr, 1, &to_dst);
+            vk::ImageBlit blit = {{vk::ImageAspectFlagBits::eColor, level - 1, 0, 1}, {vk::Offset3D(0, 0, 0), vk::Offset3D(width, height, 1)},
+                                  {vk::ImageAspectFlagBits::eColor, level, 0, 1}, {vk::Offset3D(0, 0, 0), vk::Offset3D(next_width, next_height, 1)}};
+            info_p->recording.blitImage(texture.image, vk::ImageLayout::eTransferSrcOptimal, texture.image, vk::ImageLayout::eTransferDstOptimal, 1, &blit, vk::Filter::eLinear);
+            // The new level is the source of the next blit
+            vk::ImageMemoryBarrier to_src = {vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eTransferRead, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eTransferSrcOptimal, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, texture.image, range};
+            info_p->recording.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags(), 0, nullptr, 0, nullptr, 1, &to_src);
+            width = next_width;
+            height = next_height;
+        }
+        vk::ImageMemoryBarrier to_read = {vk::AccessFlagBits::eTransferWrite | vk::AccessFlagBits::eTransferRead, vk::AccessFlagBits::eShaderRead, vk::ImageLayout::eTransferSrcOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+                                          VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, texture.image, vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, texture.levels, 0, 1)};
+        info_p->recording.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, vk::DependencyFlags(), 0, nullptr, 0, nullptr, 1, &to_read);
+    }
+
     // Wait for the device to become idle (stop rendering)
     void wait_idle() {
         info_p->device.waitIdle();
@@ -779,17 +2607,45 @@ namespace vulkan_wrapper {
     // Destroys all Vulkan associated objects in the correct order
     void terminate() {
         destroy_swapchain();
+        if (info_p->ring) {
+            info_p->device.unmapMemory(info_p->ring_memory);
+            destroy_buffer(info_p->ring, info_p->ring_memory);
+        }
+        if (info_p->depth_render_pass) {
+            info_p->device.destroyRenderPass(info_p->depth_render_pass);
+        }
 
         for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
             info_p->device.destroySemaphore(info_p->image_available_semaphores[i]);
             info_p->device.destroySemaphore(info_p->render_finished_semaphores[i]);
-            info_p->device.destroyFence(info_p->in_flight_fences[i]);
+        }
+        info_p->device.destroySemaphore(info_p->frame_timeline);
+        collect_transfers(true);
+        for (const staging_buffer& staging : info_p->staging_pool) {
+            info_p->device.unmapMemory(staging.memory);
+            destroy_buffer(staging.buffer, staging.memory);
+        }
+        info_p->device.destroySemaphore(info_p->transfer_timeline);
+        info_p->device.destroyCommandPool(info_p->transfer_pool);
+        info_p->device.destroySemaphore(info_p->compute_timeline);
+        for (const Command& cmd : info_p->compute_commands) {
+            if (!cmd.buffers.empty()) {
+                info_p->device.freeCommandBuffers(cmd.pool, cmd.buffers);
+            }
+            info_p->device.destroyCommandPool(cmd.pool);
+        }
+        for (const vk::QueryPool& pool : info_p->timestamp_pools) {
+            info_p->device.destroyQueryPool(pool);
         }
 
         for (const Command& cmd : info_p->commands) {
             info_p->device.freeCommandBuffers(cmd.pool, cmd.buffers);
+            if (!cmd.secondary.empty()) {
+                info_p->device.freeCommandBuffers(cmd.pool, cmd.secondary);
+            }
             info_p->device.destroyCommandPool(cmd.pool);
         }
+        info_p->device.destroyCommandPool(info_p->cached_pool);
 
         info_p->device.destroy();
 
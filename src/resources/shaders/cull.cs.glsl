@@ -0,0 +1,93 @@
+#version 450
+#pragma shader_stage(compute)
+#extension GL_ARB_separate_shader_objects : enable
+
+// One workgroup culls one batch, looping over its commands 256 at a time
+layout(local_size_x = 256) in;
+
+layout(push_constant) uniform Cull {
+    vec4 planes[6];
+    uint firstCommand;
+    uint commandCount;
+    uint countIndex;
+} cull;
+
+// Must match render::draw_data
+struct DrawData {
+    mat4 m;
+    mat4 colourMult;
+    vec4 flags;
+    vec4 bounds;
+    uint textureSlot;
+};
+// Must match VkDrawIndexedIndirectCommand
+struct DrawCommand {
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint firstInstance;
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer Draws {
+    DrawData draws[];
+};
+layout(std430, set = 0, binding = 1) readonly buffer Commands {
+    DrawCommand commands[];
+};
+layout(std430, set = 0, binding = 2) writeonly buffer Culled {
+    DrawCommand culled[];
+};
+layout(std430, set = 0, binding = 3) writeonly buffer Counts {
+    uint counts[];
+};
+
+shared uint offsets[256];
+
+// Same test as vml::intersects_sphere, the sphere is only rejected when it is fully outside a plane
+bool is_visible(vec4 sphere) {
+    for (int i = 0; i < 6; i++) {
+        if (dot(cull.planes[i].xyz, sphere.xyz) + cull.planes[i].w < -sphere.w) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void main() {
+    uint local = gl_LocalInvocationID.x;
+    uint base = 0;
+    for (uint start = 0; start < cull.commandCount; start += 256) {
+        uint index = start + local;
+        bool visible = false;
+        DrawCommand command;
+        if (index < cull.commandCount) {
+            command = commands[cull.firstCommand + index];
+            visible = is_visible(draws[command.firstInstance].bounds);
+        }
+
+        // Inclusive prefix sum of the visible flags, this keeps the visible commands in submission order which the
+        // blended shadows rely on
+        offsets[local] = visible ? 1 : 0;
+        memoryBarrierShared();
+        barrier();
+        for (uint stride = 1; stride < 256; stride <<= 1) {
+            uint value = local >= stride ? offsets[local - stride] : 0;
+            memoryBarrierShared();
+            barrier();
+            offsets[local] += value;
+            memoryBarrierShared();
+            barrier();
+        }
+
+        if (visible) {
+            culled[cull.firstCommand + base + offsets[local] - 1] = command;
+        }
+        base += offsets[255];
+        memoryBarrierShared();
+        barrier();
+    }
+    if (local == 0) {
+        counts[cull.countIndex] = base;
+    }
+}
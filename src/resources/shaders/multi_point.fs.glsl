@@ -3,37 +3,93 @@
 #extension GL_ARB_separate_shader_objects : enable
 
 layout(push_constant) uniform Info {
-    mat4 p;
-    mat4 v;
+// Dir Light
+    vec4 lightDir;
+// Camera of this batch, its index in the frame's cameras
+    uint camera;
+// Point Lights, the range of the light list used by this batch
+    uint firstLight;
+    uint lightCount;
+// Shadow maps, the first layer used by this batch and whether they are sampled (0 = projected shadows instead)
+    uint firstShadowLayer;
+    uint useShadowMaps;
+} info;
+
+// Per-draw data written by render_manager, indexed by the instance index of the draw
+struct DrawData {
     mat4 m;
     mat4 colourMult;
-// Dir Light
-    vec3 lightDir;
-// Single Light
-    vec3 light0;
-// Multi Light
-    vec3 light1;
+// x = is shadow
+    vec4 flags;
+// World space bounding sphere, used for culling
+    vec4 bounds;
+// Texture slot sampled by the draw, 0 is plain white
+    uint textureSlot;
+};
+layout(std430, set = 0, binding = 0) readonly buffer Draws {
+    DrawData draws[];
+};
+// Point lights written by render_manager, xyz = position
+layout(std430, set = 0, binding = 1) readonly buffer Lights {
+    vec4 lights[];
+};
 
-    bool isShadow;
-} info;
+// Shadow maps written by render_manager, one layer per directional light or six per point light (+x, -x, +y, -y, +z,
+// -z) with the projection * view matrix each layer was rendered with
+layout(set = 0, binding = 2) uniform sampler2DArray shadowMaps;
+layout(std430, set = 0, binding = 3) readonly buffer ShadowViews {
+    mat4 shadowViews[];
+};
+// Textures streamed in by texture_manager, bound once per frame and indexed by each draw's texture slot. The array is
+// sized by render_manager, a slot is the same for every instance of a draw command so the index is dynamically uniform
+layout(constant_id = 0) const uint TEXTURE_COUNT = 64;
+layout(set = 1, binding = 0) uniform sampler2D textures[TEXTURE_COUNT];
 
 layout(location = 0) in vec2 uvIn;
 layout(location = 1) in vec3 normalIn;
 layout(location = 2) in vec3 posIn;
+layout(location = 3) flat in uint drawIn;
 
 layout(location = 0) out vec4 outColour;
 
+// Whether the given world position is seen from the given shadow map layer, anything outside of it is lit
+float lit(uint layer, vec3 pos) {
+    vec4 clip = shadowViews[layer] * vec4(pos, 1.0);
+    vec3 ndc = clip.xyz / clip.w;
+    float depth = texture(shadowMaps, vec3(ndc.xy * 0.5 + 0.5, float(layer))).r;
+    return ndc.z - 0.0005 > depth ? 0.0 : 1.0;
+}
+
+// Picks the cube face layer of a point light by the major axis of the direction from the light
+uint cubeFace(vec3 d) {
+    vec3 a = abs(d);
+    if (a.x >= a.y && a.x >= a.z) {
+        return d.x > 0.0 ? 0u : 1u;
+    }
+    if (a.y >= a.z) {
+        return d.y > 0.0 ? 2u : 3u;
+    }
+    return d.z > 0.0 ? 4u : 5u;
+}
+
 void main() {
 
     float diff = 1.0;
-    if (!info.isShadow) {
-        vec3 Li0 = info.light0 - posIn;
-        vec3 Li1 = info.light1 - posIn;
+    if (draws[drawIn].flags.x == 0.0) {
         vec3 N = normalize(normalIn);
-        vec3 L0 = normalize(Li0);
-        vec3 L1 = normalize(Li1);
-        diff = max(dot(N, L0), 0.0) / length(Li0) + max(dot(N, L1), 0.0) / length(Li1);
+        diff = 0.0;
+        float shadow = 1.0;
+        for (uint i = info.firstLight; i < info.firstLight + info.lightCount; i++) {
+            vec3 Li = lights[i].xyz - posIn;
+            diff += max(dot(N, normalize(Li)), 0.0) / length(Li);
+            if (info.useShadowMaps != 0u) {
+                shadow *= mix(0.1, 1.0, lit(info.firstShadowLayer + 6u * (i - info.firstLight) + cubeFace(-Li), posIn));
+            }
+        }
+        diff *= shadow;
     }
 
-    outColour = info.colourMult * vec4(diff, diff, diff, 1.0);
+    // Shadows are never textured, they only darken their receiver
+    vec4 albedo = draws[drawIn].flags.x == 0.0 ? texture(textures[draws[drawIn].textureSlot], uvIn) : vec4(1.0);
+    outColour = draws[drawIn].colourMult * (albedo * vec4(diff, diff, diff, 1.0));
 }
\ No newline at end of file
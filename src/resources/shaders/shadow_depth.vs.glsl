@@ -0,0 +1,29 @@
+#version 450
+#pragma shader_stage(vertex)
+#extension GL_ARB_separate_shader_objects : enable
+
+// Projection * view matrix of the shadow map layer being rendered
+layout(push_constant) uniform Info {
+    mat4 vp;
+} info;
+
+// Per-draw data written by render_manager, indexed by the instance index of the draw
+struct DrawData {
+    mat4 m;
+    mat4 colourMult;
+// x = is shadow
+    vec4 flags;
+// World space bounding sphere, used for culling
+    vec4 bounds;
+// Texture slot sampled by the draw, 0 is plain white
+    uint textureSlot;
+};
+layout(std430, set = 0, binding = 0) readonly buffer Draws {
+    DrawData draws[];
+};
+
+layout(location = 0) in vec3 posIn;
+
+void main() {
+    gl_Position = info.vp * draws[gl_InstanceIndex].m * vec4(posIn, 1.0);
+}
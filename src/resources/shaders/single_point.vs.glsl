@@ -3,35 +3,62 @@
 #extension GL_ARB_separate_shader_objects : enable
 
 layout(push_constant) uniform Info {
-    mat4 p;
-    mat4 v;
-    mat4 m;
-    mat4 colourMult;
 // Dir Light
-    vec3 lightDir;
-// Single Light
-    vec3 light0;
-// Multi Light
-    vec3 light1;
-
-    bool isShadow;
+    vec4 lightDir;
+// Camera of this batch, its index in the frame's cameras
+    uint camera;
+// Point Lights, the range of the light list used by this batch
+    uint firstLight;
+    uint lightCount;
+// Shadow maps, the first layer used by this batch and whether they are sampled (0 = projected shadows instead)
+    uint firstShadowLayer;
+    uint useShadowMaps;
 } info;
 
-layout(location = 0) in vec2 posIn;
+// Per-draw data written by render_manager, indexed by the instance index of the draw
+struct DrawData {
+    mat4 m;
+    mat4 colourMult;
+// x = is shadow
+    vec4 flags;
+// World space bounding sphere, used for culling
+    vec4 bounds;
+// Texture slot sampled by the draw, 0 is plain white
+    uint textureSlot;
+};
+layout(std430, set = 0, binding = 0) readonly buffer Draws {
+    DrawData draws[];
+};
+// Projection and view matrices of every camera used this frame, written by render_manager
+struct Camera {
+    mat4 p;
+    mat4 v;
+};
+layout(std430, set = 0, binding = 4) readonly buffer Cameras {
+    Camera cameras[];
+};
+
+// Flat meshes store two components of position, the vertex fetch fills in z = 0
+layout(location = 0) in vec3 posIn;
 layout(location = 1) in vec2 uvIn;
+layout(location = 2) in vec3 normalIn;
 
 layout(location = 0) out vec2 uvOut;
 layout(location = 1) out vec3 normalOut;
 layout(location = 2) out vec3 posOut;
+layout(location = 3) flat out uint drawOut;
 
 void main() {
     uvOut = uvIn;
+    drawOut = uint(gl_InstanceIndex);
+    mat4 m = draws[gl_InstanceIndex].m;
 
-    vec4 pos = info.m * vec4(posIn, 0.0, 1.0);
+    vec4 pos = m * vec4(posIn, 1.0);
     pos /= pos.w;
     posOut = pos.xyz;
 
-    mat4 mv = info.v * info.m;
-    normalOut = mat3(mv) * vec3(0.0, 0.0, 1.0);
-    gl_Position = info.p * info.v * pos;
+    Camera camera = cameras[info.camera];
+    mat4 mv = camera.v * m;
+    normalOut = mat3(mv) * normalIn;
+    gl_Position = camera.p * camera.v * pos;
 }
\ No newline at end of file
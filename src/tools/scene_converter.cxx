@@ -0,0 +1,225 @@
+#include "scene/scene_file.hxx"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+
+/**
+ * Scene converter, turns a text scene into a binary scene file (see scene::scene_file) which the game maps and uses in
+ * place. Usage: scene_converter <input text file> <output scene file>
+ *
+ * The text is one statement per line, # starts a comment. Components belong to the last entity:
+ *   module <name>                                   module which drives the scene, e.g directional
+ *   bounds <min x y z> <max x y z>                  region shadows can fall in and the player can move in
+ *   entity <name>                                   starts a new entity, names are unique
+ *   transform [parent <name>] [translate <x y z>] [rotate <axis x y z> <degrees>] [scale <x y z>]
+ *                                                   local transform, the parent's transform must come first
+ *   light point <x y z>                             point light at x, y, z
+ *   light directional <x y z>                       directional light shining along x, y, z
+ *   plane <a b c d>                                 receives planar shadows, ax + by + cz + d = 0 facing into the scene
+ *   mesh <name> [static] [colour <r g b a>]         draws a mesh (e.g rect_2D), static ones never move
+ *   caster <min x y z> <max x y z>                  casts shadows, the bounds of its mesh
+ */
+namespace {
+    const float PI = 3.1415926535897932384F;
+
+    // Reads count floats into out, returns whether there were enough
+    bool read_floats(std::istringstream& line, float* out, int count) {
+        for (int i = 0; i < count; i++) {
+            if (!(line >> out[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * convert - Convert function parses the text scene into the writer, reporting the first error
+     * @param input - text scene
+     * @param writer - writer to fill
+     * @param module - set to the scene's module
+     * @param bounds - set to the scene's bounds, min then max
+     * @param error - set to the error
+     * @return - successful or not
+     */
+    bool convert(std::istream& input, scene::scene_file_writer& writer, std::string& module, float* bounds, std::string& error) {
+        std::map<std::string, uint32_t> names;
+        std::vector<bool> has_transform;
+        uint32_t current = scene::NO_ENTITY;
+        std::string text;
+        for (uint32_t line_number = 1; std::getline(input, text); line_number++) {
+            std::istringstream line(text.substr(0, text.find('#')));
+            std::string keyword;
+            if (!(line >> keyword)) {
+                continue;
+            }
+            error = "line " + std::to_string(line_number) + ": ";
+            if (keyword == "module") {
+                if (!(line >> module)) {
+                    error += "module needs a name";
+                    return false;
+                }
+                continue;
+            }
+            if (keyword == "bounds") {
+                if (!read_floats(line, bounds, 6)) {
+                    error += "bounds needs 6 numbers";
+                    return false;
+                }
+                continue;
+            }
+            if (keyword == "entity") {
+                std::string name;
+                if (!(line >> name) || names.count(name)) {
+                    error += "entity needs a new name";
+                    return false;
+                }
+                current = writer.add_entity(name);
+                names[name] = current;
+                has_transform.push_back(false);
+                continue;
+            }
+            if (current == scene::NO_ENTITY) {
+                error += keyword + " before any entity";
+                return false;
+            }
+
+            if (keyword == "transform") {
+                scene::transform_record r = {current, scene::NO_ENTITY, {}, {0.0F, 0.0F, 0.0F, 1.0F}, {1.0F, 0.0F, 0.0F, 0.0F}, {1.0F, 1.0F, 1.0F, 0.0F}};
+                std::string part;
+                while (line >> part) {
+                    if (part == "parent") {
+                        std::string parent;
+                        line >> parent;
+                        if (!names.count(parent) || !has_transform[names[parent]] || names[parent] == current) {
+                            error += "parent " + parent + " has no transform yet";
+                            return false;
+                        }
+                        r.parent = names[parent];
+                    }
+                    else if (part == "translate") {
+                        if (!read_floats(line, r.translation, 3)) {
+                            error += "translate needs 3 numbers";
+                            return false;
+                        }
+                    }
+                    else if (part == "rotate") {
+                        float axis[4];
+                        if (!read_floats(line, axis, 4)) {
+                            error += "rotate needs an axis and an angle";
+                            return false;
+                        }
+                        float length = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+                        if (length == 0.0F) {
+                            error += "rotate needs a non zero axis";
+                            return false;
+                        }
+                        // The quaternion is stored as vml::quaternion holds it, the real part first
+                        float half = axis[3] * PI / 360.0F;
+                        r.rotation[0] = std::cos(half);
+                        for (int c = 0; c < 3; c++) {
+                            r.rotation[c + 1] = std::sin(half) * axis[c] / length;
+                        }
+                    }
+                    else if (part == "scale") {
+                        if (!read_floats(line, r.scale, 3)) {
+                            error += "scale needs 3 numbers";
+                            return false;
+                        }
+                    }
+                    else {
+                        error += "unknown transform part " + part;
+                        return false;
+                    }
+                }
+                writer.transforms.push_back(r);
+                has_transform[current] = true;
+            }
+            else if (keyword == "light") {
+                std::string type;
+                scene::light_record r = {current, {}, {}};
+                line >> type;
+                if ((type != "point" && type != "directional") || !read_floats(line, r.l, 3)) {
+                    error += "light needs point or directional and 3 numbers";
+                    return false;
+                }
+                r.l[3] = type == "point" ? 1.0F : 0.0F;
+                writer.lights.push_back(r);
+            }
+            else if (keyword == "plane") {
+                scene::plane_record r = {current, {}, {}};
+                if (!read_floats(line, r.plane, 4)) {
+                    error += "plane needs 4 numbers";
+                    return false;
+                }
+                writer.planes.push_back(r);
+            }
+            else if (keyword == "mesh") {
+                std::string name;
+                if (!(line >> name)) {
+                    error += "mesh needs a name";
+                    return false;
+                }
+                scene::mesh_record r = {current, writer.add_string(name), 0, 0, {1.0F, 1.0F, 1.0F, 1.0F}};
+                std::string part;
+                while (line >> part) {
+                    if (part == "static") {
+                        r.flags |= scene::MESH_STATIC;
+                    }
+                    else if (part != "colour" || !read_floats(line, r.colour, 4)) {
+                        error += "mesh takes static and colour with 4 numbers";
+                        return false;
+                    }
+                }
+                writer.meshes.push_back(r);
+            }
+            else if (keyword == "caster") {
+                scene::caster_record r = {current, {}, {}, {}};
+                if (!read_floats(line, r.bounds_min, 3) || !read_floats(line, r.bounds_max, 3)) {
+                    error += "caster needs 6 numbers";
+                    return false;
+                }
+                writer.casters.push_back(r);
+            }
+            else {
+                error += "unknown statement " + keyword;
+                return false;
+            }
+        }
+        if (module.empty()) {
+            error = "no module given";
+            return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char** args) {
+    if (argc != 3) {
+        std::fprintf(stderr, "usage: scene_converter <input text file> <output scene file>\n");
+        return 1;
+    }
+    std::ifstream input(args[1]);
+    if (!input.is_open()) {
+        std::fprintf(stderr, "%s: could not be opened\n", args[1]);
+        return 1;
+    }
+    scene::scene_file_writer writer;
+    std::string module, error;
+    float bounds[6] = {};
+    if (!convert(input, writer, module, bounds, error)) {
+        std::fprintf(stderr, "%s: %s\n", args[1], error.c_str());
+        return 1;
+    }
+    std::vector<uint8_t> out = writer.write(module, vml::vec3(bounds[0], bounds[1], bounds[2]), vml::vec3(bounds[3], bounds[4], bounds[5]));
+    std::ofstream output(args[2], std::ios::binary);
+    if (!output.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size()))) {
+        std::fprintf(stderr, "%s: could not be written\n", args[2]);
+        return 1;
+    }
+    std::printf("%s: %zu entities, %zu bytes\n", args[2], writer.entities.size(), out.size());
+    return 0;
+}